@@ -1,5 +1,6 @@
 #include "plugin.h"
 #include "authenticationrequest.h"
+#include "batchrequest.h"
 #include "resourcesmodel.h"
 #include "streamsmodel.h"
 #include "subtitlesmodel.h"
@@ -15,6 +16,7 @@ void Plugin::registerTypes(const char *uri) {
     Q_ASSERT(uri == QLatin1String("QYouTube"));
 
     qmlRegisterType<AuthenticationRequest>(uri, 1, 0, "AuthenticationRequest");
+    qmlRegisterType<BatchRequest>(uri, 1, 0, "BatchRequest");
     qmlRegisterType<ResourcesModel>(uri, 1, 0, "ResourcesModel");
     qmlRegisterType<ResourcesRequest>(uri, 1, 0, "ResourcesRequest");
     qmlRegisterType<StreamsModel>(uri, 1, 0, "StreamsModel");
@@ -26,6 +28,7 @@ void Plugin::registerTypes(const char *uri) {
 }
 
 QML_DECLARE_TYPE(QYouTube::AuthenticationRequest)
+QML_DECLARE_TYPE(QYouTube::BatchRequest)
 QML_DECLARE_TYPE(QYouTube::ResourcesModel)
 QML_DECLARE_TYPE(QYouTube::ResourcesRequest)
 QML_DECLARE_TYPE(QYouTube::StreamsModel)
@@ -16,6 +16,7 @@
 
 #include "authenticationrequest.h"
 #include "request_p.h"
+#include "tokenmanager.h"
 #include "urls.h"
 #include <QNetworkReply>
 #include <QStringList>
@@ -41,6 +42,10 @@ public:
         deviceExpiry(0),
         deviceInterval(5000)
     {
+        // Replies are handled by _q_onReplyFinished(), so they cannot be shared with other requests.
+        shareReplies = false;
+        // The responses are read by _q_onReplyFinished(), so they are not parsed as they arrive.
+        parseIncrementally = false;
     }
     
     void _q_pollForDeviceToken() {
@@ -53,25 +58,22 @@ public:
         q->post();
     }
     
-    void _q_onAccessTokenRefreshed() {
-        if (!reply) {
-            return;
-        }
-        
+    void setTokenExpiry(const QVariantMap &token) {
+        // The access token is renewed by TokenManager before it expires.
+        TokenManager::instance()->setAccessTokenExpiry(clientId, clientSecret,
+                                                       token.value("refresh_token").toString(),
+                                                       token.value("expires_in").toInt());
+    }
+    
+    void accessTokenRefreshed(const QVariant &response, Request::Error e, const QString &es) {
         Q_Q(AuthenticationRequest);
         
-        bool ok;
-        setResult(QtJson::Json::parse(reply->readAll(), ok));
-        
-        const QNetworkReply::NetworkError e = reply->error();
-        const QString es = reply->errorString();
-        reply->deleteLater();
-        reply = 0;
+        setResult(response);
         
         switch (e) {
-        case QNetworkReply::NoError:
+        case Request::NoError:
             break;
-        case QNetworkReply::OperationCanceledError:
+        case Request::OperationCanceledError:
             setStatus(Request::Canceled);
             setError(Request::NoError);
             setErrorString(QString());
@@ -79,34 +81,14 @@ public:
             return;
         default:
             setStatus(Request::Failed);
-            setError(Request::Error(e));
+            setError(e);
             setErrorString(es);
             emit q->finished();
             return;
         }
         
-        if (ok) {
-            const QString token = result.toMap().value("access_token").toString();
-            
-            if (token.isEmpty()) {
-                setStatus(Request::Failed);
-                setError(Request::ContentAccessDenied);
-                setErrorString(Request::tr("Unable to refresh access token"));
-                emit q->finished();
-            }
-            else {
-                q->setAccessToken(token);
-                
-                if (authRequest == RevokeToken) {
-                    q->revokeAccessToken();
-                }
-            }
-        }
-        else {
-            setStatus(Request::Failed);
-            setError(Request::ParseError);
-            setErrorString(Request::tr("Unable to parse response"));
-            emit q->finished();
+        if (authRequest == RevokeToken) {
+            q->revokeAccessToken();
         }
     }
     
@@ -120,8 +102,8 @@ public:
         bool ok;
         setResult(QtJson::Json::parse(reply->readAll(), ok));
         
-        const QNetworkReply::NetworkError e = reply->error();
-        const QString es = reply->errorString();
+        const QNetworkReply::NetworkError e = replyError(reply);
+        const QString es = replyErrorString(reply);
         reply->deleteLater();
         reply = 0;
     
@@ -159,12 +141,14 @@ public:
             
             switch (authRequest) {
             case WebToken:
+                setTokenExpiry(map);
                 setStatus(Request::Ready);
                 setError(Request::NoError);
                 setErrorString(QString());
                 break;
             case DeviceToken:
                 if (map.value("error").isNull()) {
+                    setTokenExpiry(map);
                     setStatus(Request::Ready);
                     setError(Request::NoError);
                     setErrorString(QString());
@@ -210,6 +194,7 @@ public:
             }
         }
         else if (authRequest == RevokeToken) {
+            TokenManager::instance()->clearAccessTokenExpiry(clientId, refreshToken);
             setStatus(Request::Ready);
             setError(Request::NoError);
             setErrorString(QString());
@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batchrequest.h"
+#include "request_p.h"
+#include <QTimer>
+#include <QDebug>
+
+namespace QYouTube {
+
+static const int MAX_BATCH_SIZE = 50;
+
+typedef QPair<int, QString> BatchLookup;
+
+class PendingBatch
+{
+
+public:
+    QString resourcePath;
+
+    QStringList part;
+
+    QVariantMap params;
+
+    QList<BatchLookup> lookups;
+};
+
+class BatchRequestPrivate : public RequestPrivate
+{
+
+public:
+    BatchRequestPrivate(BatchRequest *parent) :
+        RequestPrivate(parent),
+        timer(0),
+        maximumBatchSize(MAX_BATCH_SIZE)
+    {
+        concurrent = true;
+    }
+
+    static QStringList lookupIds(const QList<BatchLookup> &lookups) {
+        QStringList ids;
+
+        foreach (const BatchLookup &lookup, lookups) {
+            if (!ids.contains(lookup.second)) {
+                ids << lookup.second;
+            }
+        }
+
+        return ids;
+    }
+
+    void flushBatch(const QString &key) {
+        Q_Q(BatchRequest);
+
+        PendingBatch batch = batches.take(key);
+        QList<BatchLookup> lookups;
+
+        foreach (const BatchLookup &lookup, batch.lookups) {
+            queuedLookups.remove(lookup.first);
+
+            if ((operations.contains(lookup.first)) && (operations.value(lookup.first).status == Request::Loading)) {
+                lookups << lookup;
+            }
+        }
+
+        emit q->pendingCountChanged();
+
+        if (lookups.isEmpty()) {
+            return;
+        }
+
+        QVariantMap filters;
+        filters["id"] = lookupIds(lookups).join(",");
+        q->setUrl(resourcesUrl(batch.resourcePath, batch.part, filters, batch.params));
+        q->setData(QVariant());
+        const int id = admitRequest(Request::GetOperation, batch.resourcePath);
+        sentBatches.insert(id, lookups);
+
+        foreach (const BatchLookup &lookup, lookups) {
+            lookupBatches.insert(lookup.first, id);
+        }
+#ifdef QYOUTUBE_DEBUG
+        qDebug() << "QYouTube::BatchRequestPrivate::flushBatch" << id << url << lookups.size();
+#endif
+    }
+
+    void cancelOperation(int id) {
+        if (queuedLookups.contains(id)) {
+            Q_Q(BatchRequest);
+
+            const QString key = queuedLookups.take(id);
+            PendingBatch &batch = batches[key];
+
+            for (int i = 0; i < batch.lookups.size(); i++) {
+                if (batch.lookups.at(i).first == id) {
+                    batch.lookups.removeAt(i);
+                    break;
+                }
+            }
+
+            if (batch.lookups.isEmpty()) {
+                batches.remove(key);
+            }
+
+            finishOperation(id, Request::Canceled);
+            emit q->pendingCountChanged();
+            return;
+        }
+
+        if (lookupBatches.contains(id)) {
+            const int batchId = lookupBatches.take(id);
+            finishOperation(id, Request::Canceled);
+
+            // The batch is only canceled when none of its lookups are still waiting for it.
+            foreach (const BatchLookup &lookup, sentBatches.value(batchId)) {
+                if (lookupBatches.contains(lookup.first)) {
+                    return;
+                }
+            }
+
+            RequestPrivate::cancelOperation(batchId);
+            return;
+        }
+
+        RequestPrivate::cancelOperation(id);
+    }
+
+    void operationFinished(int id) {
+        if (!sentBatches.contains(id)) {
+            RequestPrivate::operationFinished(id);
+            return;
+        }
+
+        const QList<BatchLookup> lookups = sentBatches.take(id);
+        const RequestOperation batch = operations.take(id);
+        QHash<QString, QVariant> items;
+        QHash<QString, QtJson::JsonValue> values;
+
+        if (batch.status == Request::Ready) {
+            // A lazy result is not parsed, so each lookup receives its item as a lazy value.
+            if (!batch.resultValue.isUndefined()) {
+                foreach (const QtJson::JsonValue &item, batch.resultValue.value("items", 5).values()) {
+                    values.insert(item.value("id", 2).toString(), item);
+                }
+            }
+            else {
+                foreach (const QVariant &item, batch.result.toMap().value("items").toList()) {
+                    items.insert(item.toMap().value("id").toString(), item);
+                }
+            }
+        }
+
+        foreach (const BatchLookup &lookup, lookups) {
+            lookupBatches.remove(lookup.first);
+
+            if ((!operations.contains(lookup.first))
+                || (operations.value(lookup.first).status != Request::Loading)) {
+                continue;
+            }
+
+            switch (batch.status) {
+            case Request::Ready:
+                if (items.contains(lookup.second)) {
+                    operations[lookup.first].result = items.value(lookup.second);
+                    finishOperation(lookup.first, Request::Ready);
+                }
+                else if (values.contains(lookup.second)) {
+                    operations[lookup.first].resultValue = values.value(lookup.second);
+                    finishOperation(lookup.first, Request::Ready);
+                }
+                else {
+                    finishOperation(lookup.first, Request::Failed, Request::ContentNotFoundError,
+                                    Request::tr("Resource not found"));
+                }
+
+                break;
+            case Request::Canceled:
+                finishOperation(lookup.first, Request::Canceled);
+                break;
+            default:
+                finishOperation(lookup.first, Request::Failed, batch.error, batch.errorString);
+                break;
+            }
+        }
+    }
+
+    void _q_flush() {
+        foreach (const QString &key, batches.keys()) {
+            flushBatch(key);
+        }
+    }
+
+    QTimer *timer;
+
+    int maximumBatchSize;
+
+    QHash<QString, PendingBatch> batches;
+
+    QHash<int, QString> queuedLookups;
+
+    QHash<int, QList<BatchLookup> > sentBatches;
+
+    QHash<int, int> lookupBatches;
+
+    Q_DECLARE_PUBLIC(BatchRequest)
+};
+
+/*!
+    \class BatchRequest
+    \brief Combines lookups of single YouTube resources by id into batched requests.
+
+    \ingroup requests
+
+    The YouTube Data API allows up to 50 comma-separated ids to be requested from resources such as /videos,
+    /channels and /playlists, for the same quota cost as a single id. BatchRequest collects the lookups made using
+    lookup() during batchInterval, or until maximumBatchSize distinct ids are waiting, and then retrieves them using
+    a single request. Only lookups with the same resource path, parts and parameters are combined.
+
+    Each lookup is a separate operation, so BatchRequest is always concurrent. When the combined request is
+    completed, the item with the matching id is set as the result of each lookup and operationFinished() is emitted.
+    If no item is returned for an id, the lookup fails with ContentNotFoundError.
+
+    \code
+    using namespace QYouTube;
+
+    ...
+
+    BatchRequest *request = new BatchRequest(this);
+    request->setApiKey(MY_API_KEY);
+    connect(request, SIGNAL(operationFinished(int)), this, SLOT(onVideoLoaded(int)));
+
+    foreach (const QString &videoId, videoIds) {
+        lookups[request->lookup("/videos", videoId, QStringList() << "snippet")] = videoId;
+    }
+
+    ...
+
+    void MyClass::onVideoLoaded(int id) {
+        if (request->operationStatus(id) == BatchRequest::Ready) {
+            qDebug() << lookups.value(id) << request->operationResult(id).toMap().value("snippet");
+        }
+        else {
+            qDebug() << lookups.value(id) << request->operationErrorString(id);
+        }
+
+        request->releaseOperation(id);
+    }
+    \endcode
+
+    \sa Request::concurrent
+*/
+BatchRequest::BatchRequest(QObject *parent) :
+    ResourcesRequest(*new BatchRequestPrivate(this), parent)
+{
+    Q_D(BatchRequest);
+
+    d->timer = new QTimer(this);
+    d->timer->setInterval(50);
+    d->timer->setSingleShot(true);
+    connect(d->timer, SIGNAL(timeout()), this, SLOT(_q_flush()));
+}
+
+/*!
+    \property int BatchRequest::batchInterval
+    \brief The time in milliseconds for which lookups are collected before a request is made.
+
+    The default value is 50.
+*/
+
+/*!
+    \fn void BatchRequest::batchIntervalChanged()
+    \brief Emitted when the batchInterval changes.
+*/
+int BatchRequest::batchInterval() const {
+    Q_D(const BatchRequest);
+
+    return d->timer->interval();
+}
+
+void BatchRequest::setBatchInterval(int interval) {
+    Q_D(BatchRequest);
+
+    interval = qMax(0, interval);
+
+    if (interval != d->timer->interval()) {
+        d->timer->setInterval(interval);
+        emit batchIntervalChanged();
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::BatchRequest::setBatchInterval" << interval;
+#endif
+}
+
+/*!
+    \property int BatchRequest::maximumBatchSize
+    \brief The maximum number of distinct ids retrieved in a single request.
+
+    The value must be between 1 and 50. The default value is 50.
+*/
+
+/*!
+    \fn void BatchRequest::maximumBatchSizeChanged()
+    \brief Emitted when the maximumBatchSize changes.
+*/
+int BatchRequest::maximumBatchSize() const {
+    Q_D(const BatchRequest);
+
+    return d->maximumBatchSize;
+}
+
+void BatchRequest::setMaximumBatchSize(int size) {
+    Q_D(BatchRequest);
+
+    size = qBound(1, size, MAX_BATCH_SIZE);
+
+    if (size != d->maximumBatchSize) {
+        d->maximumBatchSize = size;
+        emit maximumBatchSizeChanged();
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::BatchRequest::setMaximumBatchSize" << size;
+#endif
+}
+
+/*!
+    \property int BatchRequest::pendingCount
+    \brief The number of lookups waiting to be sent.
+*/
+
+/*!
+    \fn void BatchRequest::pendingCountChanged()
+    \brief Emitted when the pendingCount changes.
+*/
+int BatchRequest::pendingCount() const {
+    Q_D(const BatchRequest);
+
+    return d->queuedLookups.size();
+}
+
+/*!
+    \brief Looks up the resource with \a id from \a resourcePath.
+
+    The lookup is combined with other lookups having the same \a resourcePath, \a part and \a params.
+
+    Returns the id of the operation, or 0 if \a id is empty.
+
+    \sa batchInterval, maximumBatchSize
+*/
+int BatchRequest::lookup(const QString &resourcePath, const QString &id, const QStringList &part,
+                         const QVariantMap &params) {
+    if (id.isEmpty()) {
+        qDebug() << "QYouTube::BatchRequest::lookup(): id is empty";
+        return 0;
+    }
+
+    Q_D(BatchRequest);
+
+    QVariantMap filters;
+    filters["id"] = id;
+
+    RequestOperation o;
+    o.id = ++d->lastOperationId;
+    o.operation = GetOperation;
+    o.status = Loading;
+    o.url = resourcesUrl(resourcePath, part, filters, params);
+    d->operations.insert(o.id, o);
+    d->activeOperations++;
+    d->setOperation(GetOperation);
+    d->setStatus(Loading);
+
+    const QString key = QString("%1\n%2\n%3").arg(resourcePath).arg(part.join(","))
+                                             .arg(QString(QtJson::Json::serialize(params)));
+    PendingBatch &batch = d->batches[key];
+
+    if (batch.lookups.isEmpty()) {
+        batch.resourcePath = resourcePath;
+        batch.part = part;
+        batch.params = params;
+    }
+
+    batch.lookups << BatchLookup(o.id, id);
+    d->queuedLookups.insert(o.id, key);
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::BatchRequest::lookup" << o.id << resourcePath << id;
+#endif
+    emit pendingCountChanged();
+
+    if (d->lookupIds(batch.lookups).size() >= d->maximumBatchSize) {
+        d->flushBatch(key);
+    }
+    else if (!d->timer->isActive()) {
+        d->timer->start();
+    }
+
+    return o.id;
+}
+
+/*!
+    \brief Sends all waiting lookups immediately.
+*/
+void BatchRequest::flush() {
+    Q_D(BatchRequest);
+
+    d->timer->stop();
+    d->_q_flush();
+}
+
+}
+
+#include "moc_batchrequest.cpp"
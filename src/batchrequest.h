@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_BATCHREQUEST_H
+#define QYOUTUBE_BATCHREQUEST_H
+
+#include "resourcesrequest.h"
+#include <QStringList>
+
+namespace QYouTube {
+
+class BatchRequestPrivate;
+
+class QYOUTUBESHARED_EXPORT BatchRequest : public ResourcesRequest
+{
+    Q_OBJECT
+
+    Q_PROPERTY(int batchInterval READ batchInterval WRITE setBatchInterval NOTIFY batchIntervalChanged)
+    Q_PROPERTY(int maximumBatchSize READ maximumBatchSize WRITE setMaximumBatchSize NOTIFY maximumBatchSizeChanged)
+    Q_PROPERTY(int pendingCount READ pendingCount NOTIFY pendingCountChanged)
+
+public:
+    explicit BatchRequest(QObject *parent = 0);
+
+    int batchInterval() const;
+    void setBatchInterval(int interval);
+
+    int maximumBatchSize() const;
+    void setMaximumBatchSize(int size);
+
+    int pendingCount() const;
+
+public Q_SLOTS:
+    int lookup(const QString &resourcePath, const QString &id, const QStringList &part,
+               const QVariantMap &params = QVariantMap());
+
+    void flush();
+
+Q_SIGNALS:
+    void batchIntervalChanged();
+    void maximumBatchSizeChanged();
+    void pendingCountChanged();
+
+private:
+    Q_DECLARE_PRIVATE(BatchRequest)
+    Q_DISABLE_COPY(BatchRequest)
+
+    Q_PRIVATE_SLOT(d_func(), void _q_flush())
+};
+
+}
+
+#endif // QYOUTUBE_BATCHREQUEST_H
@@ -0,0 +1,735 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "diskresponsecache_p.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QMutexLocker>
+#include <string.h>
+#ifdef QYOUTUBE_DEBUG
+#include <QDebug>
+#endif
+
+namespace QYouTube {
+
+static bool entryOffsetGreaterThan(const DiskCacheIndexEntry &e1, const DiskCacheIndexEntry &e2) {
+    return e1.offset > e2.offset;
+}
+
+static bool entryOffsetLessThan(const DiskCacheIndexEntry &e1, const DiskCacheIndexEntry &e2) {
+    return e1.offset < e2.offset;
+}
+
+static DiskCacheIndexEntry* probe(DiskCacheIndexEntry *entries, quint32 bucketCount, quint64 hash) {
+    const quint32 mask = bucketCount - 1;
+    DiskCacheIndexEntry *target = 0;
+    quint32 i = quint32(hash) & mask;
+
+    for (quint32 n = 0; n < bucketCount; n++) {
+        DiskCacheIndexEntry *e = &entries[i];
+
+        if (e->hash == 0) {
+            return target ? target : e;
+        }
+
+        if (e->hash == hash) {
+            return e;
+        }
+
+        if ((!target) && (e->offset == 0)) {
+            target = e;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    return target;
+}
+
+/*!
+    \class DiskResponseCache
+    \brief A ResponseCache that is stored on disk and can be shared between processes.
+
+    \ingroup requests
+
+    DiskResponseCache keeps the parsed result of each HTTP GET request in an append-only data file in directory,
+    using the binary QDataStream format, so that a cached result can be used without parsing the response again. The
+    URL hash, data offset, ETag and expiry time of each entry are stored in a hash table in a separate index file,
+    which is memory-mapped when the cache is first used, so opening the cache costs almost nothing regardless of its
+    size. Responses of requests with Request::lazyResult enabled have not been parsed, so they are stored as raw JSON
+    instead.
+
+    Recently used results are also kept in memory, subject to the limits of ResponseCache.
+
+    When the data file would exceed maximumDiskSize, the cache is compacted, keeping only the most recently added
+    entries. Entries older than maximumAge are ignored and removed when the cache is compacted.
+
+    Only one process should write to the cache directory at a time, but any number of processes can use the same
+    directory if readOnly is true. A read-only cache detects when the index has been rebuilt by the writer and
+    reopens it automatically. Entries that a read-only cache cannot read, or that are removed, are ignored by that
+    instance until the writer replaces them.
+
+    \code
+    DiskResponseCache *cache = new DiskResponseCache(QDir::homePath() + "/.cache/myapp/youtube");
+    cache->setMaximumDiskSize(100 * 1024 * 1024);
+
+    ResourcesRequest *request = new ResourcesRequest(this);
+    request->setResponseCache(cache);
+    \endcode
+
+    \sa ResponseCache
+*/
+DiskResponseCache::DiskResponseCache(const QString &directory, bool readOnly) :
+    ResponseCache(*new DiskResponseCachePrivate(this, directory, readOnly))
+{
+}
+
+DiskResponseCache::~DiskResponseCache() {}
+
+/*!
+    \brief Returns the directory in which the cache files are stored.
+*/
+QString DiskResponseCache::directory() const {
+    Q_D(const DiskResponseCache);
+
+    return d->directory;
+}
+
+/*!
+    \brief Returns true if the cache files are only read.
+
+    A read-only cache still stores results in memory.
+*/
+bool DiskResponseCache::isReadOnly() const {
+    Q_D(const DiskResponseCache);
+
+    return d->readOnly;
+}
+
+/*!
+    \brief Returns the maximum size of the data file in bytes.
+
+    The default value is 52428800 (50MB).
+*/
+qint64 DiskResponseCache::maximumDiskSize() const {
+    Q_D(const DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->maximumDiskSize;
+}
+
+/*!
+    \brief Sets the maximum size of the data file in bytes to \a size.
+
+    The new maximum is applied when the next entry is added.
+*/
+void DiskResponseCache::setMaximumDiskSize(qint64 size) {
+    Q_D(DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->maximumDiskSize = qMax(qint64(0), size);
+}
+
+/*!
+    \brief Returns the maximum age of a cached entry in seconds.
+
+    A value of 0 means that entries do not expire.
+
+    The default value is 604800 (one week).
+*/
+int DiskResponseCache::maximumAge() const {
+    Q_D(const DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->maximumAge;
+}
+
+/*!
+    \brief Sets the maximum age of a cached entry in seconds to \a age.
+
+    The new maximum is applied to entries added after it is set.
+*/
+void DiskResponseCache::setMaximumAge(int age) {
+    Q_D(DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->maximumAge = qMax(0, age);
+}
+
+/*!
+    \brief Returns the current size of the data file in bytes.
+*/
+qint64 DiskResponseCache::diskSize() const {
+    Q_D(const DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    return const_cast<DiskResponseCachePrivate*>(d)->open() ? d->dataFile.size() : 0;
+}
+
+/*!
+    \brief Returns the number of entries stored on disk.
+*/
+int DiskResponseCache::diskCount() const {
+    Q_D(const DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    return const_cast<DiskResponseCachePrivate*>(d)->open() ? d->header()->count : 0;
+}
+
+/*!
+    \reimp
+*/
+QByteArray DiskResponseCache::etag(const QUrl &url) {
+    Q_D(DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    const QString key = cacheKey(url);
+
+    if (ResponseCacheNode *n = d->node(key)) {
+        return n->etag;
+    }
+
+    if (DiskCacheIndexEntry *e = d->entry(key)) {
+        return QByteArray(e->etag);
+    }
+
+    return QByteArray();
+}
+
+/*!
+    \reimp
+*/
+bool DiskResponseCache::find(const QUrl &url, QVariant &result) {
+    Q_D(DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    const QString key = cacheKey(url);
+
+    if (d->nodes.contains(key)) {
+        return d->findResult(key, result, locker);
+    }
+
+    if (DiskCacheIndexEntry *e = d->entry(key)) {
+        const QByteArray etag(e->etag);
+        QVariant record;
+
+        // A record that cannot be read is removed, so that its ETag is no longer sent.
+        if (!d->readRecord(e, key, record)) {
+            d->removeRecord(key);
+            return false;
+        }
+
+        // Responses that were not parsed are stored as raw JSON, which is parsed when it is first used.
+        if (record.type() == QVariant::ByteArray) {
+            d->insertNode(key, etag, QVariant(), record.toByteArray());
+            return d->findResult(key, result, locker);
+        }
+
+        d->insertNode(key, etag, record);
+        result = record;
+        d->hits++;
+        return true;
+    }
+
+    return false;
+}
+
+/*!
+    \reimp
+*/
+bool DiskResponseCache::findResponse(const QUrl &url, QByteArray &response) {
+    Q_D(DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    const QString key = cacheKey(url);
+
+    if (d->nodes.contains(key)) {
+        return d->findResponse(key, response);
+    }
+
+    if (DiskCacheIndexEntry *e = d->entry(key)) {
+        const QByteArray etag(e->etag);
+        QVariant record;
+
+        if (!d->readRecord(e, key, record)) {
+            d->removeRecord(key);
+        }
+        else if (record.type() == QVariant::ByteArray) {
+            d->insertNode(key, etag, QVariant(), record.toByteArray());
+            return d->findResponse(key, response);
+        }
+    }
+
+    return false;
+}
+
+/*!
+    \reimp
+*/
+void DiskResponseCache::insert(const QUrl &url, const QByteArray &etag, const QVariant &result) {
+    Q_D(DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    const QString key = cacheKey(url);
+    d->insertNode(key, etag, result);
+    d->writeRecord(key, etag, result);
+    d->misses++;
+}
+
+/*!
+    \reimp
+*/
+void DiskResponseCache::insertResponse(const QUrl &url, const QByteArray &etag, const QVariant &result,
+                                       const QByteArray &response) {
+    Q_D(DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    const QString key = cacheKey(url);
+    d->insertNode(key, etag, result, response);
+    // A response that has not been parsed is written as raw JSON.
+    d->writeRecord(key, etag, result.isValid() ? result : QVariant(response));
+    d->misses++;
+}
+
+/*!
+    \reimp
+*/
+void DiskResponseCache::remove(const QUrl &url) {
+    Q_D(DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    const QString key = cacheKey(url);
+
+    if (ResponseCacheNode *n = d->nodes.value(key)) {
+        d->removeNode(n);
+    }
+
+    d->removeRecord(key);
+}
+
+/*!
+    \reimp
+*/
+void DiskResponseCache::clear() {
+    Q_D(DiskResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->clearNodes();
+
+    if (!d->readOnly) {
+        d->rebuild(DISK_CACHE_INITIAL_BUCKETS, 0);
+    }
+}
+
+DiskResponseCachePrivate::DiskResponseCachePrivate(DiskResponseCache *parent, const QString &dir, bool ro) :
+    ResponseCachePrivate(parent),
+    directory(dir),
+    readOnly(ro),
+    map(0),
+    maximumDiskSize(52428800),
+    maximumAge(604800)
+{
+}
+
+DiskResponseCachePrivate::~DiskResponseCachePrivate() {
+    close();
+}
+
+/*!
+    \internal
+    \brief Returns the 64-bit FNV-1a hash of \a key.
+
+    qHash() cannot be used, since its value is not guaranteed to be the same in different processes.
+*/
+quint64 DiskResponseCachePrivate::keyHash(const QString &key) {
+    const QByteArray utf8 = key.toUtf8();
+    quint64 h = Q_UINT64_C(14695981039346656037);
+
+    for (int i = 0; i < utf8.size(); i++) {
+        h ^= uchar(utf8.at(i));
+        h *= Q_UINT64_C(1099511628211);
+    }
+
+    return h ? h : 1;
+}
+
+DiskCacheIndexHeader* DiskResponseCachePrivate::header() const {
+    return reinterpret_cast<DiskCacheIndexHeader*>(map);
+}
+
+DiskCacheIndexEntry* DiskResponseCachePrivate::entries() const {
+    return reinterpret_cast<DiskCacheIndexEntry*>(map + sizeof(DiskCacheIndexHeader));
+}
+
+/*!
+    \internal
+    \brief Opens and maps the cache files if they are not already open.
+
+    If the index has been replaced by another process, the cache files are reopened. If the files do not exist or
+    are invalid, new files are created unless the cache is read-only.
+*/
+bool DiskResponseCachePrivate::open() {
+    if (map) {
+        if (header()->valid) {
+            return true;
+        }
+
+        close();
+    }
+
+    indexFile.setFileName(directory + "/index");
+    dataFile.setFileName(directory + "/data");
+
+    if ((indexFile.exists()) && (dataFile.exists())) {
+        const QIODevice::OpenMode mode = readOnly ? QIODevice::ReadOnly : QIODevice::ReadWrite;
+
+        if ((indexFile.open(mode)) && (dataFile.open(mode))
+            && (indexFile.size() >= qint64(sizeof(DiskCacheIndexHeader)))) {
+            map = indexFile.map(0, indexFile.size());
+
+            if (map) {
+                const DiskCacheIndexHeader *h = header();
+
+                if ((h->magic == DISK_CACHE_MAGIC) && (h->version == DISK_CACHE_VERSION) && (h->valid)
+                    && (h->bucketCount > 0) && ((h->bucketCount & (h->bucketCount - 1)) == 0)
+                    && (indexFile.size() == qint64(sizeof(DiskCacheIndexHeader)
+                                                   + h->bucketCount * sizeof(DiskCacheIndexEntry)))) {
+                    return true;
+                }
+            }
+        }
+
+        close();
+    }
+
+    if (readOnly) {
+        return false;
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::DiskResponseCachePrivate::open: Creating new cache in" << directory;
+#endif
+    return rebuild(DISK_CACHE_INITIAL_BUCKETS, 0);
+}
+
+void DiskResponseCachePrivate::close() {
+    if (map) {
+        indexFile.unmap(map);
+        map = 0;
+    }
+
+    indexFile.close();
+    dataFile.close();
+    unreadable.clear();
+}
+
+/*!
+    \internal
+    \brief Returns the index entry for \a key, or 0 if there is no current entry.
+*/
+DiskCacheIndexEntry* DiskResponseCachePrivate::entry(const QString &key) {
+    if (!open()) {
+        return 0;
+    }
+
+    const quint64 hash = keyHash(key);
+    DiskCacheIndexEntry *e = probe(entries(), header()->bucketCount, hash);
+
+    if ((!e) || (e->hash != hash) || (e->offset == 0)) {
+        return 0;
+    }
+
+    if ((readOnly) && (!unreadable.isEmpty())) {
+        const QHash<QString, quint64>::const_iterator iterator = unreadable.constFind(key);
+
+        if ((iterator != unreadable.constEnd()) && (iterator.value() == e->offset)) {
+            return 0;
+        }
+    }
+
+    if ((e->expiry > 0) && (e->expiry < QDateTime::currentMSecsSinceEpoch())) {
+        return 0;
+    }
+
+    return e;
+}
+
+bool DiskResponseCachePrivate::readRecord(const DiskCacheIndexEntry *e, const QString &key, QVariant &result) {
+    if (!dataFile.seek(e->offset)) {
+        return false;
+    }
+
+    const QByteArray record = dataFile.read(e->length);
+
+    if (record.size() != int(e->length)) {
+        return false;
+    }
+
+    QDataStream stream(record);
+    stream.setVersion(QDataStream::Qt_4_7);
+    quint32 magic;
+    QString k;
+    stream >> magic >> k;
+
+    // Different keys may have the same hash, so the key is checked before the result is read.
+    if ((magic != DISK_CACHE_RECORD_MAGIC) || (k != key)) {
+        return false;
+    }
+
+    stream >> result;
+
+    return stream.status() == QDataStream::Ok;
+}
+
+void DiskResponseCachePrivate::writeRecord(const QString &key, const QByteArray &etag, const QVariant &result) {
+    if ((readOnly) || (etag.size() >= DISK_CACHE_ETAG_SIZE) || (!open())) {
+        return;
+    }
+
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << DISK_CACHE_RECORD_MAGIC << key << result;
+
+    if (record.size() > maximumDiskSize / 2) {
+        return;
+    }
+
+    if (dataFile.size() + record.size() > maximumDiskSize) {
+        if (!rebuild(header()->bucketCount, maximumDiskSize / 2)) {
+            return;
+        }
+    }
+
+    const DiskCacheIndexHeader *h = header();
+
+    if ((h->count + h->removed + 1) * 4 > h->bucketCount * 3) {
+        if (!rebuild((h->count + 1) * 2 > h->bucketCount ? h->bucketCount * 2 : h->bucketCount,
+                     maximumDiskSize)) {
+            return;
+        }
+    }
+
+    const qint64 offset = dataFile.size();
+
+    if ((!dataFile.seek(offset)) || (dataFile.write(record) != record.size())) {
+        return;
+    }
+
+    dataFile.flush();
+
+    DiskCacheIndexHeader *hdr = header();
+    const quint64 hash = keyHash(key);
+    DiskCacheIndexEntry *e = probe(entries(), hdr->bucketCount, hash);
+
+    if (!e) {
+        return;
+    }
+
+    if (e->hash == 0) {
+        hdr->count++;
+    }
+    else if (e->offset == 0) {
+        hdr->count++;
+        hdr->removed--;
+    }
+
+    // The hash is written last, so that other processes do not use a partially written entry.
+    e->offset = offset;
+    e->length = record.size();
+    e->expiry = maximumAge > 0 ? QDateTime::currentMSecsSinceEpoch() + qint64(maximumAge) * 1000 : 0;
+    memset(e->etag, 0, DISK_CACHE_ETAG_SIZE);
+    memcpy(e->etag, etag.constData(), etag.size());
+    e->hash = hash;
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::DiskResponseCachePrivate::writeRecord" << key << etag << offset << record.size();
+#endif
+}
+
+/*!
+    \internal
+    \brief Removes the index entry for \a key.
+
+    A read-only cache cannot change the index, so the entry is ignored by this instance instead. Otherwise etag()
+    would continue to return the ETag of a record that cannot be used.
+*/
+void DiskResponseCachePrivate::removeRecord(const QString &key) {
+    if (readOnly) {
+        if (const DiskCacheIndexEntry *e = entry(key)) {
+            unreadable.insert(key, e->offset);
+        }
+
+        return;
+    }
+
+    if (DiskCacheIndexEntry *e = entry(key)) {
+        e->offset = 0;
+        header()->count--;
+        header()->removed++;
+    }
+}
+
+/*!
+    \internal
+    \brief Writes new cache files with \a bucketCount buckets, keeping the most recently added entries up to a
+    total of \a maximumDataSize bytes.
+
+    The index of the existing files is marked as invalid before they are replaced.
+*/
+bool DiskResponseCachePrivate::rebuild(quint32 bucketCount, qint64 maximumDataSize) {
+    QList<DiskCacheIndexEntry> keep;
+
+    if ((map) && (header()->valid)) {
+        const DiskCacheIndexHeader *h = header();
+        const DiskCacheIndexEntry *e = entries();
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        QList<DiskCacheIndexEntry> current;
+
+        for (quint32 i = 0; i < h->bucketCount; i++) {
+            if ((e[i].hash != 0) && (e[i].offset != 0) && ((e[i].expiry == 0) || (e[i].expiry >= now))) {
+                current << e[i];
+            }
+        }
+
+        qSort(current.begin(), current.end(), entryOffsetGreaterThan);
+        qint64 total = 0;
+
+        foreach (const DiskCacheIndexEntry &ce, current) {
+            total += ce.length;
+
+            if (total > maximumDataSize) {
+                break;
+            }
+
+            keep << ce;
+        }
+
+        qSort(keep.begin(), keep.end(), entryOffsetLessThan);
+    }
+
+    quint32 buckets = DISK_CACHE_INITIAL_BUCKETS;
+
+    while ((buckets < bucketCount) || (buckets < quint32(keep.size()) * 2)) {
+        buckets *= 2;
+    }
+
+    bucketCount = buckets;
+
+    if (!QDir().mkpath(directory)) {
+        return false;
+    }
+
+    QFile data(directory + "/data.tmp");
+
+    if (!data.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    QByteArray index(sizeof(DiskCacheIndexHeader) + bucketCount * sizeof(DiskCacheIndexEntry), '\0');
+    DiskCacheIndexHeader *h = reinterpret_cast<DiskCacheIndexHeader*>(index.data());
+    DiskCacheIndexEntry *table = reinterpret_cast<DiskCacheIndexEntry*>(index.data()
+                                                                            + sizeof(DiskCacheIndexHeader));
+    h->magic = DISK_CACHE_MAGIC;
+    h->version = DISK_CACHE_VERSION;
+    h->valid = 1;
+    h->bucketCount = bucketCount;
+
+    // The data file begins with the magic number and version, so that no record has an offset of 0.
+    QDataStream stream(&data);
+    stream << DISK_CACHE_MAGIC << DISK_CACHE_VERSION;
+
+    foreach (DiskCacheIndexEntry e, keep) {
+        if (!dataFile.seek(e.offset)) {
+            continue;
+        }
+
+        const QByteArray record = dataFile.read(e.length);
+
+        if (record.size() != int(e.length)) {
+            continue;
+        }
+
+        e.offset = data.pos();
+
+        if (data.write(record) != record.size()) {
+            data.close();
+            data.remove();
+            return false;
+        }
+
+        *probe(table, bucketCount, e.hash) = e;
+        h->count++;
+    }
+
+    data.close();
+
+    QFile idx(directory + "/index.tmp");
+
+    if ((!idx.open(QIODevice::WriteOnly | QIODevice::Truncate)) || (idx.write(index) != index.size())) {
+        idx.remove();
+        data.remove();
+        return false;
+    }
+
+    idx.close();
+
+    if (map) {
+        header()->valid = 0;
+    }
+
+    close();
+    QFile::remove(directory + "/index");
+    QFile::remove(directory + "/data");
+
+    if ((!idx.rename(directory + "/index")) || (!data.rename(directory + "/data"))) {
+        return false;
+    }
+
+    indexFile.setFileName(directory + "/index");
+    dataFile.setFileName(directory + "/data");
+
+    if ((!indexFile.open(QIODevice::ReadWrite)) || (!dataFile.open(QIODevice::ReadWrite))) {
+        close();
+        return false;
+    }
+
+    map = indexFile.map(0, indexFile.size());
+
+    if (!map) {
+        close();
+        return false;
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::DiskResponseCachePrivate::rebuild" << directory << bucketCount << keep.size()
+             << dataFile.size();
+#endif
+    return true;
+}
+
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_DISKRESPONSECACHE_H
+#define QYOUTUBE_DISKRESPONSECACHE_H
+
+#include "responsecache.h"
+
+namespace QYouTube {
+
+class DiskResponseCachePrivate;
+
+class QYOUTUBESHARED_EXPORT DiskResponseCache : public ResponseCache
+{
+
+public:
+    explicit DiskResponseCache(const QString &directory, bool readOnly = false);
+    ~DiskResponseCache();
+
+    QString directory() const;
+
+    bool isReadOnly() const;
+
+    qint64 maximumDiskSize() const;
+    void setMaximumDiskSize(qint64 size);
+
+    int maximumAge() const;
+    void setMaximumAge(int age);
+
+    qint64 diskSize() const;
+    int diskCount() const;
+
+    virtual QByteArray etag(const QUrl &url);
+    virtual bool find(const QUrl &url, QVariant &result);
+    virtual bool findResponse(const QUrl &url, QByteArray &response);
+    virtual void insert(const QUrl &url, const QByteArray &etag, const QVariant &result);
+    virtual void insertResponse(const QUrl &url, const QByteArray &etag, const QVariant &result,
+                                const QByteArray &response);
+    virtual void remove(const QUrl &url);
+    virtual void clear();
+
+private:
+    Q_DECLARE_PRIVATE(DiskResponseCache)
+
+    Q_DISABLE_COPY(DiskResponseCache)
+};
+
+}
+
+#endif // QYOUTUBE_DISKRESPONSECACHE_H
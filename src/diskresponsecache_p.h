@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_DISKRESPONSECACHE_P_H
+#define QYOUTUBE_DISKRESPONSECACHE_P_H
+
+#include "diskresponsecache.h"
+#include "responsecache_p.h"
+#include <QFile>
+#include <QHash>
+
+namespace QYouTube {
+
+static const quint32 DISK_CACHE_MAGIC = 0x51595443; // "QYTC"
+static const quint32 DISK_CACHE_VERSION = 1;
+static const quint32 DISK_CACHE_RECORD_MAGIC = 0x51595452; // "QYTR"
+static const int DISK_CACHE_ETAG_SIZE = 96;
+static const quint32 DISK_CACHE_INITIAL_BUCKETS = 1024;
+
+/*!
+    \internal
+    \brief The header at the start of the index file.
+*/
+struct DiskCacheIndexHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 valid; // Set to 0 when the index is replaced, so that other processes reopen the cache.
+    quint32 bucketCount;
+    quint32 count;
+    quint32 removed;
+    quint64 reserved;
+};
+
+/*!
+    \internal
+    \brief A bucket in the open addressing hash table that follows the index header.
+
+    An empty bucket has a hash of 0. A removed entry keeps its hash and has an offset of 0.
+*/
+struct DiskCacheIndexEntry
+{
+    quint64 hash;
+    quint64 offset;
+    quint32 length;
+    quint32 reserved;
+    qint64 expiry;
+    char etag[DISK_CACHE_ETAG_SIZE];
+};
+
+class DiskResponseCachePrivate : public ResponseCachePrivate
+{
+
+public:
+    DiskResponseCachePrivate(DiskResponseCache *parent, const QString &dir, bool ro);
+    ~DiskResponseCachePrivate();
+
+    static quint64 keyHash(const QString &key);
+
+    DiskCacheIndexHeader* header() const;
+    DiskCacheIndexEntry* entries() const;
+
+    bool open();
+    void close();
+
+    DiskCacheIndexEntry* entry(const QString &key);
+
+    bool readRecord(const DiskCacheIndexEntry *e, const QString &key, QVariant &result);
+    void writeRecord(const QString &key, const QByteArray &etag, const QVariant &result);
+    void removeRecord(const QString &key);
+
+    bool rebuild(quint32 bucketCount, qint64 maximumDataSize);
+
+    QString directory;
+
+    bool readOnly;
+
+    // The data offsets of records that a read-only cache could not read or was asked to remove. These entries are
+    // ignored until the record is replaced by the writer, or the cache files are reopened.
+    QHash<QString, quint64> unreadable;
+
+    QFile indexFile;
+    QFile dataFile;
+
+    uchar *map;
+
+    qint64 maximumDiskSize;
+
+    int maximumAge;
+
+    Q_DECLARE_PUBLIC(DiskResponseCache)
+};
+
+}
+
+#endif // QYOUTUBE_DISKRESPONSECACHE_P_H
@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "inflightrequests_p.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QNetworkAccessManager>
+#include <QStringList>
+#include <QThreadStorage>
+#ifdef QYOUTUBE_DEBUG
+#include <QDebug>
+#endif
+
+namespace QYouTube {
+
+class InFlightRequestsData
+{
+
+public:
+    InFlightRequestsData() :
+        enabled(true),
+        shared(0),
+        saved(0),
+        maximumSaved(0)
+    {
+    }
+
+    QMutex mutex;
+
+    bool enabled;
+
+    qint64 shared;
+    qint64 saved;
+
+    int maximumSaved;
+};
+
+Q_GLOBAL_STATIC(InFlightRequestsData, flightData)
+
+typedef QHash<QString, InFlightReply*> InFlightTable;
+
+static QThreadStorage<InFlightTable*> tables;
+
+static InFlightTable* table() {
+    if (!tables.hasLocalData()) {
+        tables.setLocalData(new InFlightTable);
+    }
+
+    return tables.localData();
+}
+
+/*!
+    \class InFlightRequests
+    \brief Shares the replies of identical HTTP GET requests that are in progress at the same time.
+
+    \ingroup requests
+
+    When a request performs a HTTP GET request with the same URL, headers and QNetworkAccessManager as another GET
+    request that is still in progress, no new HTTP request is made. Instead, both requests wait for the existing
+    reply, which is parsed once, and receive the same result. This is useful when several models or components load
+    the same resource at the same time.
+
+    The URL is compared after sorting its query items, and includes the access token, so requests made on behalf of
+    different users are never shared. Since network replies cannot be used in a different thread, only requests made in
+    the same thread are shared.
+
+    Replies are shared by Request, ResourcesRequest and the models that use them. Sharing is enabled by default.
+
+    The number of requests saved can be checked using the statistics:
+
+    \code
+    qDebug() << "Shared replies:" << InFlightRequests::sharedReplyCount();
+    qDebug() << "Requests saved:" << InFlightRequests::savedRequestCount();
+    qDebug() << "Most requests saved by a single reply:" << InFlightRequests::maximumSavedRequestCount();
+    \endcode
+*/
+
+/*!
+    \brief Returns true if identical HTTP GET requests share the same reply.
+
+    The default value is true.
+*/
+bool InFlightRequests::isEnabled() {
+    QMutexLocker locker(&flightData()->mutex);
+
+    return flightData()->enabled;
+}
+
+/*!
+    \brief Sets whether identical HTTP GET requests share the same reply to \a enabled.
+
+    Requests that are already in progress are not affected.
+*/
+void InFlightRequests::setEnabled(bool enabled) {
+    QMutexLocker locker(&flightData()->mutex);
+
+    flightData()->enabled = enabled;
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::InFlightRequests::setEnabled" << enabled;
+#endif
+}
+
+/*!
+    \brief Returns the number of HTTP GET requests in progress in the current thread.
+*/
+int InFlightRequests::count() {
+    return table()->size();
+}
+
+/*!
+    \brief Returns the number of replies that were shared by more than one request.
+*/
+qint64 InFlightRequests::sharedReplyCount() {
+    QMutexLocker locker(&flightData()->mutex);
+
+    return flightData()->shared;
+}
+
+/*!
+    \brief Returns the total number of HTTP GET requests that were not made because an existing reply was shared.
+*/
+qint64 InFlightRequests::savedRequestCount() {
+    QMutexLocker locker(&flightData()->mutex);
+
+    return flightData()->saved;
+}
+
+/*!
+    \brief Returns the largest number of HTTP GET requests saved by sharing a single reply.
+*/
+int InFlightRequests::maximumSavedRequestCount() {
+    QMutexLocker locker(&flightData()->mutex);
+
+    return flightData()->maximumSaved;
+}
+
+/*!
+    \brief Resets the statistics to zero.
+*/
+void InFlightRequests::resetStatistics() {
+    QMutexLocker locker(&flightData()->mutex);
+
+    flightData()->shared = 0;
+    flightData()->saved = 0;
+    flightData()->maximumSaved = 0;
+}
+
+InFlightReply::InFlightReply(const QString &k, QNetworkReply *rep) :
+    QObject(),
+    key(k),
+    reply(rep),
+    waiters(1),
+    attached(1),
+    complete(false)
+{
+    connect(reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+}
+
+InFlightReply::~InFlightReply() {
+    remove();
+
+    if (reply) {
+        delete reply;
+        reply = 0;
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the in-flight reply for \a request, starting a new HTTP GET request using \a manager if there is
+    none.
+
+    A new HTTP GET request is aborted with TimeoutError if it exceeds \a timeout or \a inactivityTimeout
+    milliseconds. Its JSON response is parsed as the data arrives, or indexed when it is finished if \a lazy is true.
+    The raw response of a parsed reply is only kept if \a keepData is true, such as when it will be cached. Replies
+    are only shared between requests that use the same options.
+
+    Each call must be balanced by a call to release(), unless the finished() signal has been emitted.
+*/
+InFlightReply* InFlightReply::get(QNetworkAccessManager *manager, const QNetworkRequest &request, int timeout,
+                                  int inactivityTimeout, bool lazy, bool keepData) {
+    const QString key = flightKey(manager, request, lazy, keepData);
+    const bool enabled = InFlightRequests::isEnabled();
+    InFlightTable *flights = table();
+
+    if (InFlightReply *flight = enabled ? flights->value(key) : 0) {
+        flight->waiters++;
+        flight->attached++;
+
+        QMutexLocker locker(&flightData()->mutex);
+
+        if (flight->attached == 2) {
+            flightData()->shared++;
+        }
+
+        flightData()->saved++;
+        flightData()->maximumSaved = qMax(flightData()->maximumSaved, flight->attached - 1);
+#ifdef QYOUTUBE_DEBUG
+        qDebug() << "QYouTube::InFlightReply::get: Sharing reply" << request.url() << flight->attached;
+#endif
+        return flight;
+    }
+
+    QNetworkReply *reply = manager->get(request);
+    // A shared reply uses the timeouts of the request that started it.
+    ReplyTimeout::watch(reply, timeout, inactivityTimeout);
+
+    if (lazy) {
+        setLazyReply(reply);
+    }
+    else {
+        ReplyParser::watch(reply, keepData);
+    }
+
+    InFlightReply *flight = new InFlightReply(key, reply);
+
+    if (enabled) {
+        flights->insert(key, flight);
+    }
+
+    return flight;
+}
+
+/*!
+    \internal
+    \brief Returns true if get() would share a reply that is already in flight, rather than start a new request.
+
+    This is used to avoid charging a QuotaTracker for calls that are not made.
+*/
+bool InFlightReply::isInFlight(QNetworkAccessManager *manager, const QNetworkRequest &request, bool lazy,
+                               bool keepData) {
+    return (InFlightRequests::isEnabled()) && (table()->contains(flightKey(manager, request, lazy, keepData)));
+}
+
+/*!
+    \internal
+    \brief Returns the key used to identify identical requests.
+
+    The key consists of \a manager, the URL with its query items sorted, and the sorted request headers.
+*/
+QString InFlightReply::requestKey(QNetworkAccessManager *manager, const QNetworkRequest &request) {
+    const QUrl url = request.url();
+#if QT_VERSION >= 0x050000
+    QList< QPair<QString, QString> > items = QUrlQuery(url).queryItems(QUrl::FullyDecoded);
+    QUrl u(url);
+    u.setQuery(QString());
+#else
+    QList< QPair<QString, QString> > items = url.queryItems();
+    QUrl u(url);
+    u.setEncodedQuery(QByteArray());
+#endif
+    qSort(items);
+
+    QString key = QString::number(quintptr(manager), 16);
+    key.append(' ');
+    key.append(u.toString());
+    QChar separator('?');
+
+    for (int i = 0; i < items.size(); i++) {
+        key.append(separator);
+        key.append(items.at(i).first);
+        key.append('=');
+        key.append(items.at(i).second);
+        separator = '&';
+    }
+
+    QList<QByteArray> headers = request.rawHeaderList();
+    qSort(headers);
+
+    foreach (const QByteArray &header, headers) {
+        key.append('\n');
+        key.append(QString::fromUtf8(header));
+        key.append(": ");
+        key.append(QString::fromUtf8(request.rawHeader(header)));
+    }
+
+    return key;
+}
+
+/*!
+    \internal
+    \brief Returns the key of the in-flight reply for \a request, which also identifies the options of the reply.
+*/
+QString InFlightReply::flightKey(QNetworkAccessManager *manager, const QNetworkRequest &request, bool lazy,
+                                 bool keepData) {
+    // A lazy reply always keeps its raw response, which is indexed instead of parsed.
+    QString key = requestKey(manager, request);
+
+    if (lazy) {
+        key.append("\nlazy");
+    }
+    else if (keepData) {
+        key.append("\ndata");
+    }
+
+    return key;
+}
+
+const ReplyResult& InFlightReply::result() const {
+    return r;
+}
+
+/*!
+    \internal
+    \brief Releases the reply on behalf of a request that no longer requires it.
+
+    If no requests are waiting for the reply, it is aborted.
+*/
+void InFlightReply::release() {
+    waiters--;
+
+    if ((waiters > 0) || (complete)) {
+        return;
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::InFlightReply::release: Aborting reply" << key;
+#endif
+    complete = true;
+    remove();
+
+    if (reply) {
+        reply->disconnect(this);
+        reply->abort();
+    }
+
+    deleteLater();
+}
+
+void InFlightReply::remove() {
+    InFlightTable *flights = table();
+
+    if (flights->value(key) == this) {
+        flights->remove(key);
+    }
+}
+
+void InFlightReply::_q_onReplyFinished() {
+    if ((complete) || (!reply)) {
+        return;
+    }
+
+    complete = true;
+    // The reply is removed from the table before finished() is emitted, so that any new request made in response
+    // starts a new reply.
+    remove();
+    r = ReplyResult::fromReply(reply);
+    reply->deleteLater();
+    reply = 0;
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::InFlightReply::_q_onReplyFinished" << key << attached;
+#endif
+    emit finished();
+    deleteLater();
+}
+
+}
+
+#include "moc_inflightrequests_p.cpp"
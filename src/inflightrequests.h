@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_INFLIGHTREQUESTS_H
+#define QYOUTUBE_INFLIGHTREQUESTS_H
+
+#include "qyoutube_global.h"
+
+namespace QYouTube {
+
+class QYOUTUBESHARED_EXPORT InFlightRequests
+{
+
+public:
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    static int count();
+
+    static qint64 sharedReplyCount();
+    static qint64 savedRequestCount();
+    static int maximumSavedRequestCount();
+    static void resetStatistics();
+
+private:
+    InFlightRequests();
+
+    Q_DISABLE_COPY(InFlightRequests)
+};
+
+}
+
+#endif // QYOUTUBE_INFLIGHTREQUESTS_H
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_INFLIGHTREQUESTS_P_H
+#define QYOUTUBE_INFLIGHTREQUESTS_P_H
+
+#include "inflightrequests.h"
+#include "request_p.h"
+
+class QNetworkAccessManager;
+
+namespace QYouTube {
+
+/*!
+    \internal
+    \brief A HTTP GET request that is shared by all identical requests made while it is in progress.
+
+    The response is parsed once, and the finished() signal is emitted for all requests. The reply is aborted when
+    every request has released it.
+*/
+class InFlightReply : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~InFlightReply();
+
+    static InFlightReply* get(QNetworkAccessManager *manager, const QNetworkRequest &request, int timeout = 0,
+                              int inactivityTimeout = 0, bool lazy = false, bool keepData = false);
+
+    static bool isInFlight(QNetworkAccessManager *manager, const QNetworkRequest &request, bool lazy = false,
+                           bool keepData = false);
+
+    static QString requestKey(QNetworkAccessManager *manager, const QNetworkRequest &request);
+
+    const ReplyResult& result() const;
+
+    void release();
+
+Q_SIGNALS:
+    void finished();
+
+private Q_SLOTS:
+    void _q_onReplyFinished();
+
+private:
+    InFlightReply(const QString &key, QNetworkReply *reply);
+
+    static QString flightKey(QNetworkAccessManager *manager, const QNetworkRequest &request, bool lazy, bool keepData);
+
+    void remove();
+
+    QString key;
+
+    QNetworkReply *reply;
+
+    ReplyResult r;
+
+    int waiters;
+
+    int attached;
+
+    bool complete;
+};
+
+}
+
+#endif // QYOUTUBE_INFLIGHTREQUESTS_P_H
@@ -31,558 +31,3134 @@
  */
 
 #include "json.h"
+#include <QIODevice>
+#include <QMutex>
+#include <QThreadStorage>
+#include <QVector>
 #include <iostream>
+#include <string.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QTJSON_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace QtJson
 {
 
 
-static QString sanitizeString(QString str)
+//Character classes of the lexer. The low bits hold the JsonToken
+//that a character starts, and the high bits its character classes.
+static const unsigned char CharTokenMask = 0x0f;
+static const unsigned char CharWhitespace = 0x10;
+static const unsigned char CharNumber = 0x20;
+
+static const unsigned char charClasses[256] =
+{
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x00, 0x00, 0x10, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x10, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x06, 0x28, 0x20, 0x00,
+        0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x04, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0b, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static const int tokenLengths[] =
+{
+        0, 1, 1, 1, 1, 1, 1, 1, 1, 4, 5, 4
+};
+
+static inline unsigned char charClass(const QChar &c)
+{
+        const ushort u = c.unicode();
+        return u < 256 ? charClasses[u] : 0;
+}
+
+/**
+ * The value of a hexadecimal digit, or -1 if c is not one
+ */
+static inline int hexValue(ushort c)
+{
+        if((c >= '0') && (c <= '9'))
+        {
+                return c - '0';
+        }
+
+        if((c >= 'a') && (c <= 'f'))
+        {
+                return c - 'a' + 10;
+        }
+
+        if((c >= 'A') && (c <= 'F'))
+        {
+                return c - 'A' + 10;
+        }
+
+        return -1;
+}
+
+static inline ushort codeUnit(const QChar &c)
+{
+        return c.unicode();
+}
+
+static inline ushort codeUnit(char c)
+{
+        return uchar(c);
+}
+
+/**
+ * Convert the integer in data without copying it, returning false
+ * if it is not a plain integer or does not fit in 64 bits
+ */
+template<typename Char>
+static inline bool convertInteger(const Char *data, int size, QVariant &number)
+{
+        const bool negative = (size > 0) && (codeUnit(data[0]) == '-');
+        int i = negative ? 1 : 0;
+        quint64 value = 0;
+
+        if(i == size)
+        {
+                return false;
+        }
+
+        for(; i < size; i++)
+        {
+                const ushort digit = codeUnit(data[i]) - '0';
+
+                if((digit > 9) || (value > (Q_UINT64_C(0xffffffffffffffff) - digit) / 10))
+                {
+                        return false;
+                }
+
+                value = value * 10 + digit;
+        }
+
+        if(!negative)
+        {
+                number = QVariant(qulonglong(value));
+                return true;
+        }
+
+        if(value <= Q_UINT64_C(0x8000000000000000))
+        {
+                number = QVariant(value == 0 ? qlonglong(0) : -qlonglong(value - 1) - 1);
+                return true;
+        }
+
+        return false;
+}
+
+/**
+ * Convert the UTF-8 number in data, returning false if it is invalid
+ */
+static bool convertNumber(const char *data, int size, QVariant &number)
+{
+        bool real = false;
+
+        for(int i = 0; i < size; i++)
+        {
+                if(!(charClasses[uchar(data[i])] & CharNumber))
+                {
+                        return false;
+                }
+
+                if((data[i] == '.') || (data[i] == 'e') || (data[i] == 'E'))
+                {
+                        real = true;
+                }
+        }
+
+        if((!real) && (convertInteger(data, size, number)))
+        {
+                return true;
+        }
+
+        bool ok = false;
+        const QByteArray raw = QByteArray::fromRawData(data, size);
+
+        if(real)
+        {
+                number = QVariant(raw.toDouble(&ok));
+        }
+        else if(raw.startsWith('-'))
+        {
+                number = QVariant(raw.toLongLong(&ok));
+        }
+        else
+        {
+                number = QVariant(raw.toULongLong(&ok));
+        }
+
+        return ok;
+}
+
+/**
+ * Append codePoint to data as UTF-8
+ */
+static void appendUtf8(QByteArray &data, uint codePoint)
+{
+        if(codePoint < 0x80)
+        {
+                data.append(char(codePoint));
+        }
+        else if(codePoint < 0x800)
+        {
+                data.append(char(0xc0 | (codePoint >> 6)));
+                data.append(char(0x80 | (codePoint & 0x3f)));
+        }
+        else if(codePoint < 0x10000)
+        {
+                data.append(char(0xe0 | (codePoint >> 12)));
+                data.append(char(0x80 | ((codePoint >> 6) & 0x3f)));
+                data.append(char(0x80 | (codePoint & 0x3f)));
+        }
+        else
+        {
+                data.append(char(0xf0 | (codePoint >> 18)));
+                data.append(char(0x80 | ((codePoint >> 12) & 0x3f)));
+                data.append(char(0x80 | ((codePoint >> 6) & 0x3f)));
+                data.append(char(0x80 | (codePoint & 0x3f)));
+        }
+}
+
+static inline int countTrailingZeros64(quint64 mask)
+{
+#if defined(__GNUC__)
+        return __builtin_ctzll(mask);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, mask);
+        return int(index);
+#else
+        int count = 0;
+
+        while(!(mask & 1))
+        {
+                mask >>= 1;
+                count++;
+        }
+
+        return count;
+#endif
+}
+
+#ifdef QTJSON_SSE2
+static inline int countTrailingZeros(uint mask)
+{
+#if defined(__GNUC__)
+        return __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return int(index);
+#else
+        int count = 0;
+
+        while(!(mask & 1))
+        {
+                mask >>= 1;
+                count++;
+        }
+
+        return count;
+#endif
+}
+#endif
+
+/**
+ * The index of the first quote or backslash in the UTF-16 data
+ * from index, or size if there is none
+ */
+static inline int indexOfStringEnd(const QChar *data, int index, int size)
+{
+        const ushort *units = reinterpret_cast<const ushort*>(data);
+#ifdef QTJSON_SSE2
+        //Compare 8 code units at a time
+        const __m128i quote = _mm_set1_epi16('"');
+        const __m128i backslash = _mm_set1_epi16('\\');
+
+        for(; index + 8 <= size; index += 8)
+        {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(units + index));
+                const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(chunk, quote),
+                                                                _mm_cmpeq_epi16(chunk, backslash)));
+
+                if(mask)
+                {
+                        return index + countTrailingZeros(mask) / 2;
+                }
+        }
+#endif
+        for(; index < size; index++)
+        {
+                if((units[index] == '"') || (units[index] == '\\'))
+                {
+                        break;
+                }
+        }
+
+        return index;
+}
+
+/**
+ * The index of the first quote or backslash in the UTF-8 data
+ * from index, or size if there is none
+ */
+static inline int indexOfStringEnd(const char *data, int index, int size)
+{
+#ifdef QTJSON_SSE2
+        //Compare 16 bytes at a time
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+
+        for(; index + 16 <= size; index += 16)
+        {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+                const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                                                _mm_cmpeq_epi8(chunk, backslash)));
+
+                if(mask)
+                {
+                        return index + countTrailingZeros(mask);
+                }
+        }
+#endif
+        for(; index < size; index++)
+        {
+                if((data[index] == '"') || (data[index] == '\\'))
+                {
+                        break;
+                }
+        }
+
+        return index;
+}
+
+/**
+ * Parse the four hexadecimal digits of a \\u escape in the UTF-8 data
+ * from index, returning the UTF-16 code unit or -1 if they are invalid
+ */
+static inline int parseHex4(const char *data, int size, int &index)
+{
+        if(size - index < 4)
+        {
+                return -1;
+        }
+
+        int unit = 0;
+
+        for(int i = 0; i < 4; i++)
+        {
+                const int digit = hexValue(uchar(data[index + i]));
+
+                if(digit < 0)
+                {
+                        return -1;
+                }
+
+                unit = (unit << 4) | digit;
+        }
+
+        index += 4;
+        return unit;
+}
+
+/**
+ * Append the UTF-8 content of an escaped string to out
+ */
+static bool unescapeString(const char *data, int size, QByteArray &out)
+{
+        int index = 0;
+
+        while(true)
+        {
+                const int end = indexOfStringEnd(data, index, size);
+                out.append(data + index, end - index);
+
+                if(end == size)
+                {
+                        return true;
+                }
+
+                index = end + 1;
+
+                if(index == size)
+                {
+                        return false;
+                }
+
+                const char c = data[index++];
+
+                switch(c)
+                {
+                        case 'b': out.append('\b'); break;
+                        case 'f': out.append('\f'); break;
+                        case 'n': out.append('\n'); break;
+                        case 'r': out.append('\r'); break;
+                        case 't': out.append('\t'); break;
+                        case 'u':
+                        {
+                                const int unit = parseHex4(data, size, index);
+
+                                if(unit < 0)
+                                {
+                                        return false;
+                                }
+
+                                uint codePoint = unit;
+
+                                if((codePoint >= 0xd800) && (codePoint <= 0xdbff))
+                                {
+                                        //A high surrogate must be followed by an escaped low surrogate
+                                        int next = index + 2;
+                                        const int low = ((size - index >= 2) && (data[index] == '\\')
+                                                         && (data[index + 1] == 'u'))
+                                                        ? parseHex4(data, size, next) : -1;
+
+                                        if((low >= 0xdc00) && (low <= 0xdfff))
+                                        {
+                                                codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+                                                index = next;
+                                        }
+                                        else
+                                        {
+                                                codePoint = 0xfffd;
+                                        }
+                                }
+                                else if((codePoint >= 0xdc00) && (codePoint <= 0xdfff))
+                                {
+                                        codePoint = 0xfffd;
+                                }
+
+                                appendUtf8(out, codePoint);
+                                break;
+                        }
+                        default:
+                                out.append(c);
+                                break;
+                }
+        }
+}
+
+/**
+ * \class StructuralParser
+ * \brief A two-stage parser for large UTF-8 JSON data
+ *
+ * The first stage builds an index of the positions of the structural
+ * characters ({}[]:, and unescaped quotes) outside strings, 64 bytes at a
+ * time using bitmasks. The second stage walks the index to build the
+ * values, so strings are never scanned character by character.
+ */
+class StructuralParser
+{
+        public:
+                StructuralParser(const char *json, int length);
+                StructuralParser(const char *json, int length, const QVector<int> &structurals);
+
+                QVariant parse(bool &success);
+
+                bool validate(QVector<int> &structurals, QVector<int> &containerCloses);
+
+                QVariant parseAt(int position, int start, bool &success);
+
+                static bool parseScalar(const char *scalar, int length, QVariant &value);
+
+                static bool decodeString(const char *data, int size, QString &value);
+                static bool decodeKey(const char *data, int size, QString &value);
+
+        private:
+                bool buildIndex();
+
+                bool parseValue(QVariant &value);
+                bool parseObject(QVariant &value);
+                bool parseArray(QVariant &value);
+                bool parseString(QString &value, bool key = false);
+
+                bool peek(char c) const;
+                bool expect(char c);
+                int skipWhitespace(int i) const;
+
+                const char *data;
+                int size;
+
+                QVector<int> index;
+                int count;
+
+                int pos;
+                int cursor;
+
+                //Values are only checked, not built, when validating
+                bool materialize;
+                QVector<int> *closes;
+};
+
+//Keys longer than this are not pooled
+static const int KEY_POOL_MAXIMUM_KEY_SIZE = 64;
+//The maximum number of keys in each table of a thread's pool
+static const int KEY_POOL_MAXIMUM_COUNT = 4096;
+
+//Statistics are added to the totals after this many lookups
+static const int KEY_POOL_STATISTICS_INTERVAL = 1024;
+
+struct KeyPoolEntry
+{
+        uint hash;
+        bool unicode;
+        QByteArray key;
+        QString value;
+};
+
+/**
+ * \class KeyPool
+ * \brief An open addressing hash table of the keys pooled by a thread
+ *
+ * Keys are looked up by their encoded bytes, so that finding a key
+ * needs no allocation. The statistics are kept per thread and added to
+ * the totals from time to time, so that a lookup needs no lock.
+ */
+class KeyPool
+{
+        public:
+                KeyPool();
+                ~KeyPool();
+
+                QString intern(const char *key, int size, bool unicode);
+                void clear();
+                void flushStatistics();
+
+        private:
+                static uint hash(const char *key, int size, bool unicode);
+
+                void insert(const KeyPoolEntry &entry);
+                void place(const KeyPoolEntry &entry);
+
+                QVector<KeyPoolEntry> entries;
+                int count;
+
+                int lookups;
+                int countDelta;
+                qint64 hits;
+                qint64 misses;
+                qint64 savedBytes;
+};
+
+struct KeyPoolStatistics
+{
+        KeyPoolStatistics() :
+                count(0),
+                hits(0),
+                misses(0),
+                savedBytes(0)
+        {
+        }
+
+        QMutex mutex;
+        int count;
+        qint64 hits;
+        qint64 misses;
+        qint64 savedBytes;
+};
+
+Q_GLOBAL_STATIC(KeyPoolStatistics, keyPoolStatistics)
+
+static QThreadStorage<KeyPool*> keyPools;
+
+static KeyPool* keyPool()
+{
+        if(!keyPools.hasLocalData())
+        {
+                keyPools.setLocalData(new KeyPool);
+        }
+
+        return keyPools.localData();
+}
+
+//Data of at least this size is parsed with a StructuralParser
+static const int STRUCTURAL_PARSER_THRESHOLD = 65536;
+
+//A JsonWriter with a device writes its buffer once it reaches this size
+static const int WRITER_CHUNK_SIZE = 16384;
+//Strings are escaped into the buffer this many characters at a time
+static const int WRITER_STRING_CHUNK = 1024;
+
+static const char hexDigits[] = "0123456789abcdef";
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QString &json)
+{
+        bool success = true;
+        return Json::parse(json, success);
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QString &json, bool &success)
+{
+        success = true;
+
+        //Return an empty QVariant if the JSON data is either null or empty
+        if(!json.isNull() || !json.isEmpty())
+        {
+                QString data = json;
+                //We'll start from index 0
+                int index = 0;
+
+                //Parse the first value
+                QVariant value = Json::parseValue(data, index, success);
+
+                //Return the parsed value
+                return value;
+        }
+        else
+        {
+                //Return the empty QVariant
+                return QVariant();
+        }
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QByteArray &json)
+{
+        bool success = true;
+        return Json::parse(json, success);
+}
+
+/**
+ * parse
+ */
+QVariant Json::parse(const QByteArray &json, bool &success)
+{
+        //The data is parsed as UTF-8 bytes, so only string values are decoded
+        if(json.size() >= STRUCTURAL_PARSER_THRESHOLD)
+        {
+                StructuralParser parser(json.constData(), json.size());
+                return parser.parse(success);
+        }
+
+        JsonStreamParser parser;
+        parser.feed(json);
+        return parser.finish(success);
+}
+
+/**
+ * serialize
+ */
+QByteArray Json::serialize(const QVariant &data)
+{
+        bool success = true;
+        return Json::serialize(data, success);
+}
+
+/**
+ * serialize
+ */
+QByteArray Json::serialize(const QVariant &data, bool &success)
+{
+        JsonWriter writer;
+        success = writer.write(data);
+
+        if(success)
+        {
+                return writer.data();
+        }
+        else
+        {
+                return QByteArray();
+        }
+}
+
+/**
+ * parseValue
+ */
+QVariant Json::parseValue(const QString &json, int &index, bool &success)
+{
+        //Determine what kind of data we should parse by
+        //checking out the upcoming token
+        switch(Json::lookAhead(json, index))
+        {
+                case JsonTokenString:
+                        return Json::parseString(json, index, success);
+                case JsonTokenNumber:
+                        return Json::parseNumber(json, index);
+                case JsonTokenCurlyOpen:
+                        return Json::parseObject(json, index, success);
+                case JsonTokenSquaredOpen:
+                        return Json::parseArray(json, index, success);
+                case JsonTokenTrue:
+                        Json::nextToken(json, index);
+                        return QVariant(true);
+                case JsonTokenFalse:
+                        Json::nextToken(json, index);
+                        return QVariant(false);
+                case JsonTokenNull:
+                        Json::nextToken(json, index);
+                        return QVariant();
+                case JsonTokenNone:
+                        break;
+        }
+
+        //If there were no tokens, flag the failure and return an empty QVariant
+        success = false;
+        return QVariant();
+}
+
+/**
+ * parseObject
+ */
+QVariant Json::parseObject(const QString &json, int &index, bool &success)
+{
+        QVariantMap map;
+        int token;
+
+        //Get rid of the whitespace and increment index
+        Json::nextToken(json, index);
+
+        //Loop through all of the key/value pairs of the object
+        bool done = false;
+        while(!done)
+        {
+                //Get the upcoming token
+                token = Json::lookAhead(json, index);
+
+                if(token == JsonTokenNone)
+                {
+                         success = false;
+                         return QVariantMap();
+                }
+                else if(token == JsonTokenComma)
+                {
+                        Json::nextToken(json, index);
+                }
+                else if(token == JsonTokenCurlyClose)
+                {
+                        Json::nextToken(json, index);
+                        return map;
+                }
+                else
+                {
+                        //Parse the key/value pair's name. Keys without escapes are pooled
+                        QString name;
+                        Json::eatWhitespace(json, index);
+                        const int end = indexOfStringEnd(json.constData(), index + 1, json.size());
+
+                        if((end < json.size()) && (json.at(end) == '\"'))
+                        {
+                                name = JsonKeyPool::intern(json.constData() + index + 1, end - index - 1);
+                                index = end + 1;
+                        }
+                        else
+                        {
+                                name = Json::parseString(json, index, success).toString();
+
+                                if(!success)
+                                {
+                                        return QVariantMap();
+                                }
+                        }
+
+                        //Get the next token
+                        token = Json::nextToken(json, index);
+
+                        //If the next token is not a colon, flag the failure
+                        //return an empty QVariant
+                        if(token != JsonTokenColon)
+                        {
+                                success = false;
+                                return QVariant(QVariantMap());
+                        }
+
+                        //Parse the key/value pair's value
+                        QVariant value = Json::parseValue(json, index, success);
+
+                        if(!success)
+                        {
+                                return QVariantMap();
+                        }
+
+                        //Assign the value to the key in the map
+                        map[name] = value;
+                }
+        }
+
+        //Return the map successfully
+        return QVariant(map);
+}
+
+/**
+ * parseArray
+ */
+QVariant Json::parseArray(const QString &json, int &index, bool &success)
+{
+        QVariantList list;
+
+        Json::nextToken(json, index);
+
+        bool done = false;
+        while(!done)
+        {
+                int token = Json::lookAhead(json, index);
+
+                if(token == JsonTokenNone)
+                {
+                        success = false;
+                        return QVariantList();
+                }
+                else if(token == JsonTokenComma)
+                {
+                        Json::nextToken(json, index);
+                }
+                else if(token == JsonTokenSquaredClose)
+                {
+                        Json::nextToken(json, index);
+                        break;
+                }
+                else
+                {
+                        QVariant value = Json::parseValue(json, index, success);
+
+                        if(!success)
+                        {
+                                return QVariantList();
+                        }
+
+                        list.push_back(value);
+                }
+        }
+
+        return QVariant(list);
+}
+
+/**
+ * parseString
+ */
+QVariant Json::parseString(const QString &json, int &index, bool &success)
+{
+        QString s;
+        const QChar *data = json.constData();
+        const int size = json.size();
+
+        Json::eatWhitespace(json, index);
+
+        //Skip the opening quote
+        index++;
+
+        while(true)
+        {
+                //Copy the whole run of unescaped characters at once
+                const int end = indexOfStringEnd(data, index, size);
+
+                if(end == size)
+                {
+                        break;
+                }
+
+                if(end > index)
+                {
+                        s.append(QStringRef(&json, index, end - index));
+                }
+
+                index = end + 1;
+
+                if(data[end] == '\"')
+                {
+                        return QVariant(s);
+                }
+
+                if(index == size)
+                {
+                        break;
+                }
+
+                const ushort c = data[index++].unicode();
+
+                switch(c)
+                {
+                        case 'b': s.append(QChar('\b')); break;
+                        case 'f': s.append(QChar('\f')); break;
+                        case 'n': s.append(QChar('\n')); break;
+                        case 'r': s.append(QChar('\r')); break;
+                        case 't': s.append(QChar('\t')); break;
+                        case 'u':
+                        {
+                                int unit = Json::parseUnicodeEscape(json, index);
+
+                                if(unit < 0)
+                                {
+                                        success = false;
+                                        return QVariant();
+                                }
+
+                                if((unit >= 0xd800) && (unit <= 0xdbff))
+                                {
+                                        //A high surrogate must be followed by an escaped low surrogate
+                                        int next = index + 1;
+                                        const int low = ((index < size) && (data[index] == '\\')
+                                                         && (next < size) && (data[next] == 'u'))
+                                                        ? Json::parseUnicodeEscape(json, ++next) : -1;
+
+                                        if((low >= 0xdc00) && (low <= 0xdfff))
+                                        {
+                                                s.append(QChar(ushort(unit)));
+                                                unit = low;
+                                                index = next;
+                                        }
+                                        else
+                                        {
+                                                unit = 0xfffd;
+                                        }
+                                }
+                                else if((unit >= 0xdc00) && (unit <= 0xdfff))
+                                {
+                                        unit = 0xfffd;
+                                }
+
+                                s.append(QChar(ushort(unit)));
+                                break;
+                        }
+                        default:
+                                s.append(QChar(c));
+                                break;
+                }
+        }
+
+        //The string is not terminated
+        success = false;
+        return QVariant();
+}
+
+/**
+ * parseUnicodeEscape
+ */
+int Json::parseUnicodeEscape(const QString &json, int &index)
+{
+        if(json.size() - index < 4)
+        {
+                return -1;
+        }
+
+        int unit = 0;
+
+        for(int i = 0; i < 4; i++)
+        {
+                const int digit = hexValue(json.at(index + i).unicode());
+
+                if(digit < 0)
+                {
+                        return -1;
+                }
+
+                unit = (unit << 4) | digit;
+        }
+
+        index += 4;
+        return unit;
+}
+
+/**
+ * parseNumber
+ */
+QVariant Json::parseNumber(const QString &json, int &index)
+{
+        Json::eatWhitespace(json, index);
+
+        const QChar *data = json.constData();
+        const int start = index;
+        bool real = false;
+
+        for(; index < json.size(); index++)
+        {
+                const ushort c = data[index].unicode();
+
+                if(!(charClass(data[index]) & CharNumber))
+                {
+                        break;
+                }
+
+                if((c == '.') || (c == 'e') || (c == 'E'))
+                {
+                        real = true;
+                }
+        }
+
+        QVariant number;
+
+        //Convert integers in place
+        if((!real) && (convertInteger(data + start, index - start, number)))
+        {
+                return number;
+        }
+
+        //The number is converted without copying it
+        const QString raw = QString::fromRawData(data + start, index - start);
+
+        if(real)
+        {
+                return QVariant(raw.toDouble(NULL));
+        }
+        else if(raw.startsWith(QLatin1Char('-')))
+        {
+                return QVariant(raw.toLongLong(NULL));
+        }
+        else
+        {
+                return QVariant(raw.toULongLong(NULL));
+        }
+}
+
+/**
+ * eatWhitespace
+ */
+void Json::eatWhitespace(const QString &json, int &index)
+{
+        const QChar *data = json.constData();
+        const int size = json.size();
+
+        while((index < size) && (charClass(data[index]) & CharWhitespace))
+        {
+                index++;
+        }
+}
+
+/**
+ * lookAhead
+ */
+int Json::lookAhead(const QString &json, int &index)
+{
+        Json::eatWhitespace(json, index);
+
+        if(index == json.size())
+        {
+                return JsonTokenNone;
+        }
+
+        const int token = charClass(json.at(index)) & CharTokenMask;
+        const int length = tokenLengths[token];
+
+        if(length == 1)
+        {
+                return token;
+        }
+
+        //Literals are only matched in full
+        static const char * const literals[] = { "true", "false", "null" };
+
+        if((token < JsonTokenTrue) || (json.size() - index < length))
+        {
+                return JsonTokenNone;
+        }
+
+        const char *literal = literals[token - JsonTokenTrue];
+
+        for(int i = 1; i < length; i++)
+        {
+                if(json.at(index + i) != QLatin1Char(literal[i]))
+                {
+                        return JsonTokenNone;
+                }
+        }
+
+        return token;
+}
+
+/**
+ * nextToken
+ */
+int Json::nextToken(const QString &json, int &index)
+{
+        const int token = Json::lookAhead(json, index);
+        index += tokenLengths[token];
+        return token;
+}
+
+/**
+ * KeyPool
+ */
+KeyPool::KeyPool() :
+        count(0),
+        lookups(0),
+        countDelta(0),
+        hits(0),
+        misses(0),
+        savedBytes(0)
+{
+}
+
+/**
+ * ~KeyPool
+ */
+KeyPool::~KeyPool()
+{
+        clear();
+        flushStatistics();
+}
+
+/**
+ * hash
+ */
+uint KeyPool::hash(const char *key, int size, bool unicode)
+{
+        //FNV-1a, with a different seed for UTF-16 keys
+        uint h = unicode ? 2166136261u ^ 0xff : 2166136261u;
+
+        for(int i = 0; i < size; i++)
+        {
+                h = (h ^ uchar(key[i])) * 16777619u;
+        }
+
+        return h;
+}
+
+/**
+ * intern
+ */
+QString KeyPool::intern(const char *key, int size, bool unicode)
+{
+        if(++lookups >= KEY_POOL_STATISTICS_INTERVAL)
+        {
+                flushStatistics();
+        }
+
+        const uint h = hash(key, size, unicode);
+        const int mask = entries.size() - 1;
+
+        for(int i = h & mask; (mask > 0) && (!entries.at(i).key.isNull()); i = (i + 1) & mask)
+        {
+                const KeyPoolEntry &entry = entries.at(i);
+
+                if((entry.hash == h) && (entry.unicode == unicode) && (entry.key.size() == size)
+                   && (!memcmp(entry.key.constData(), key, size)))
+                {
+                        //Sharing the pooled key saves a string header and its characters
+                        hits++;
+                        savedBytes += int(3 * sizeof(void*)) + entry.value.size() * 2;
+                        return entry.value;
+                }
+        }
+
+        misses++;
+
+        KeyPoolEntry entry;
+        entry.hash = h;
+        entry.unicode = unicode;
+        entry.value = unicode ? QString(reinterpret_cast<const QChar*>(key), size / 2)
+                              : QString::fromUtf8(key, size);
+
+        if(count < KEY_POOL_MAXIMUM_COUNT)
+        {
+                entry.key = QByteArray(key, size);
+                insert(entry);
+        }
+
+        return entry.value;
+}
+
+/**
+ * insert
+ */
+void KeyPool::insert(const KeyPoolEntry &entry)
+{
+        //Keep the table at most half full
+        if((count + 1) * 2 > entries.size())
+        {
+                const QVector<KeyPoolEntry> old = entries;
+                entries = QVector<KeyPoolEntry>(qMax(64, entries.size() * 2));
+
+                foreach(const KeyPoolEntry &e, old)
+                {
+                        if(!e.key.isNull())
+                        {
+                                place(e);
+                        }
+                }
+        }
+
+        place(entry);
+        count++;
+        countDelta++;
+}
+
+/**
+ * place
+ */
+void KeyPool::place(const KeyPoolEntry &entry)
+{
+        const int mask = entries.size() - 1;
+        int i = entry.hash & mask;
+
+        while(!entries.at(i).key.isNull())
+        {
+                i = (i + 1) & mask;
+        }
+
+        entries[i] = entry;
+}
+
+/**
+ * clear
+ */
+void KeyPool::clear()
+{
+        entries.clear();
+        countDelta -= count;
+        count = 0;
+}
+
+/**
+ * flushStatistics
+ */
+void KeyPool::flushStatistics()
+{
+        KeyPoolStatistics *statistics = keyPoolStatistics();
+
+        if(statistics)
+        {
+                QMutexLocker locker(&statistics->mutex);
+                statistics->count += countDelta;
+                statistics->hits += hits;
+                statistics->misses += misses;
+                statistics->savedBytes += savedBytes;
+        }
+
+        lookups = 0;
+        countDelta = 0;
+        hits = 0;
+        misses = 0;
+        savedBytes = 0;
+}
+
+/**
+ * intern
+ */
+QString JsonKeyPool::intern(const char *utf8, int size)
+{
+        if((size == 0) || (size > KEY_POOL_MAXIMUM_KEY_SIZE))
+        {
+                return QString::fromUtf8(utf8, size);
+        }
+
+        return keyPool()->intern(utf8, size, false);
+}
+
+/**
+ * intern
+ */
+QString JsonKeyPool::intern(const QChar *unicode, int size)
+{
+        if((size == 0) || (size > KEY_POOL_MAXIMUM_KEY_SIZE))
+        {
+                return QString(unicode, size);
+        }
+
+        return keyPool()->intern(reinterpret_cast<const char*>(unicode), size * 2, true);
+}
+
+/**
+ * count
+ */
+int JsonKeyPool::count()
+{
+        JsonKeyPool::flushStatistics();
+        KeyPoolStatistics *statistics = keyPoolStatistics();
+        QMutexLocker locker(&statistics->mutex);
+        return statistics->count;
+}
+
+/**
+ * hitCount
+ */
+qint64 JsonKeyPool::hitCount()
+{
+        JsonKeyPool::flushStatistics();
+        KeyPoolStatistics *statistics = keyPoolStatistics();
+        QMutexLocker locker(&statistics->mutex);
+        return statistics->hits;
+}
+
+/**
+ * missCount
+ */
+qint64 JsonKeyPool::missCount()
+{
+        JsonKeyPool::flushStatistics();
+        KeyPoolStatistics *statistics = keyPoolStatistics();
+        QMutexLocker locker(&statistics->mutex);
+        return statistics->misses;
+}
+
+/**
+ * savedBytes
+ */
+qint64 JsonKeyPool::savedBytes()
+{
+        JsonKeyPool::flushStatistics();
+        KeyPoolStatistics *statistics = keyPoolStatistics();
+        QMutexLocker locker(&statistics->mutex);
+        return statistics->savedBytes;
+}
+
+/**
+ * resetStatistics
+ */
+void JsonKeyPool::resetStatistics()
+{
+        JsonKeyPool::flushStatistics();
+        KeyPoolStatistics *statistics = keyPoolStatistics();
+        QMutexLocker locker(&statistics->mutex);
+        statistics->hits = 0;
+        statistics->misses = 0;
+        statistics->savedBytes = 0;
+}
+
+/**
+ * clear
+ */
+void JsonKeyPool::clear()
+{
+        if(keyPools.hasLocalData())
+        {
+                keyPools.localData()->clear();
+        }
+}
+
+/**
+ * flushStatistics
+ */
+void JsonKeyPool::flushStatistics()
+{
+        if(keyPools.hasLocalData())
+        {
+                keyPools.localData()->flushStatistics();
+        }
+}
+
+/**
+ * JsonWriter
+ */
+JsonWriter::JsonWriter() :
+        device(0),
+        error(false)
+{
+}
+
+/**
+ * JsonWriter
+ */
+JsonWriter::JsonWriter(QIODevice *device) :
+        device(device),
+        error(false)
+{
+        //Reserving keeps the capacity when the buffer is emptied
+        buffer.reserve(WRITER_CHUNK_SIZE * 2);
+}
+
+/**
+ * ~JsonWriter
+ */
+JsonWriter::~JsonWriter()
+{
+        flush();
+}
+
+/**
+ * write
+ */
+bool JsonWriter::write(const QVariant &data)
+{
+        if((!device) && (buffer.isEmpty()))
+        {
+                buffer.reserve(JsonWriter::sizeHint(data));
+        }
+
+        if(!writeValue(data))
+        {
+                error = true;
+        }
+
+        if(device)
+        {
+                flush();
+        }
+
+        return !error;
+}
+
+/**
+ * flush
+ */
+bool JsonWriter::flush()
+{
+        if((device) && (!buffer.isEmpty()))
+        {
+                if(device->write(buffer) != buffer.size())
+                {
+                        error = true;
+                }
+
+                buffer.resize(0);
+        }
+
+        return !error;
+}
+
+/**
+ * data
+ */
+QByteArray JsonWriter::data() const
+{
+        return buffer;
+}
+
+/**
+ * hasError
+ */
+bool JsonWriter::hasError() const
+{
+        return error;
+}
+
+/**
+ * sizeHint
+ */
+int JsonWriter::sizeHint(const QVariant &data)
+{
+        switch(data.type())
+        {
+                case QVariant::Invalid:
+                        return 4;
+                case QVariant::List:
+                {
+                        const QVariantList list = data.toList();
+                        int size = 4;
+
+                        foreach(const QVariant &v, list)
+                        {
+                                size += JsonWriter::sizeHint(v) + 2;
+                        }
+
+                        return size;
+                }
+                case QVariant::StringList:
+                {
+                        const QStringList list = data.toStringList();
+                        int size = 4;
+
+                        foreach(const QString &str, list)
+                        {
+                                size += str.size() + 4;
+                        }
+
+                        return size;
+                }
+                case QVariant::Map:
+                {
+                        const QVariantMap map = data.toMap();
+                        int size = 4;
+
+                        for(QVariantMap::const_iterator it = map.constBegin(); it != map.constEnd(); ++it)
+                        {
+                                size += it.key().size() + JsonWriter::sizeHint(it.value()) + 6;
+                        }
+
+                        return size;
+                }
+                case QVariant::String:
+                        return data.toString().size() + 2;
+                case QVariant::ByteArray:
+                        return data.toByteArray().size() + 2;
+                case QVariant::Bool:
+                        return 5;
+                case QVariant::Double:
+                        return 24;
+                default:
+                        return 20;
+        }
+}
+
+/**
+ * writeValue
+ */
+bool JsonWriter::writeValue(const QVariant &data)
+{
+        if((device) && (buffer.size() >= WRITER_CHUNK_SIZE) && (!flush()))
+        {
+                return false;
+        }
+
+        if(!data.isValid()) // invalid or null?
+        {
+                buffer.append("null", 4);
+        }
+        else if(data.type() == QVariant::List) // variant is a list?
+        {
+                const QVariantList list = data.toList();
+                buffer.append("[ ", 2);
+
+                for(int i = 0; i < list.size(); i++)
+                {
+                        if(i > 0)
+                        {
+                                buffer.append(", ", 2);
+                        }
+
+                        if(!writeValue(list.at(i)))
+                        {
+                                return false;
+                        }
+                }
+
+                buffer.append(" ]", 2);
+        }
+        else if(data.type() == QVariant::StringList) // variant is a string list?
+        {
+                const QStringList list = data.toStringList();
+                buffer.append("[ ", 2);
+
+                for(int i = 0; i < list.size(); i++)
+                {
+                        if(i > 0)
+                        {
+                                buffer.append(", ", 2);
+                        }
+
+                        writeString(list.at(i));
+                }
+
+                buffer.append(" ]", 2);
+        }
+        else if(data.type() == QVariant::Map) // variant is a map?
+        {
+                const QVariantMap map = data.toMap();
+                buffer.append("{ ", 2);
+
+                for(QVariantMap::const_iterator it = map.constBegin(); it != map.constEnd(); ++it)
+                {
+                        if(it != map.constBegin())
+                        {
+                                buffer.append(", ", 2);
+                        }
+
+                        writeString(it.key());
+                        buffer.append(": ", 2);
+
+                        if(!writeValue(it.value()))
+                        {
+                                return false;
+                        }
+                }
+
+                buffer.append(" }", 2);
+        }
+        else if((data.type() == QVariant::String) || (data.type() == QVariant::ByteArray)) // a string or a byte array?
+        {
+                writeString(data.toString());
+        }
+        else if(data.type() == QVariant::Double) // double?
+        {
+                const QByteArray str = QByteArray::number(data.toDouble());
+                buffer.append(str);
+
+                if(!str.contains(".") && ! str.contains("e"))
+                {
+                        buffer.append(".0", 2);
+                }
+        }
+        else if (data.type() == QVariant::Bool) // boolean value?
+        {
+                if(data.toBool())
+                {
+                        buffer.append("true", 4);
+                }
+                else
+                {
+                        buffer.append("false", 5);
+                }
+        }
+        else if (data.type() == QVariant::ULongLong) // large unsigned number?
+        {
+                writeInteger(data.value<qulonglong>(), false);
+        }
+        else if ( data.canConvert<qlonglong>() ) // any signed number?
+        {
+                const qlonglong value = data.value<qlonglong>();
+                writeInteger(value < 0 ? 0 - qulonglong(value) : qulonglong(value), value < 0);
+        }
+        else if (data.canConvert<long>())
+        {
+                const long value = data.value<long>();
+                writeInteger(value < 0 ? 0 - qulonglong(value) : qulonglong(value), value < 0);
+        }
+        else if (data.canConvert<QString>()) // can value be converted to string?
+        {
+                // this will catch QDate, QDateTime, QUrl, ...
+                writeString(data.toString());
+        }
+        else
+        {
+                return false;
+        }
+
+        return true;
+}
+
+/**
+ * writeString
+ */
+void JsonWriter::writeString(const QString &str)
+{
+        const ushort *data = str.utf16();
+        const int size = str.size();
+        int i = 0;
+
+        buffer.append('\"');
+
+        while(i < size)
+        {
+                //Reserve the worst case of six bytes per character for each chunk,
+                //and encode the characters as UTF-8 directly into the buffer
+                const int chunkEnd = qMin(size, i + WRITER_STRING_CHUNK);
+                const int start = buffer.size();
+                buffer.resize(start + (chunkEnd - i) * 6 + 6);
+                char *out = buffer.data() + start;
+
+                while(i < chunkEnd)
+                {
+                        const ushort c = data[i++];
+
+                        if(c < 0x80)
+                        {
+                                switch(c)
+                                {
+                                        case '\"': *out++ = '\\'; *out++ = '\"'; break;
+                                        case '\\': *out++ = '\\'; *out++ = '\\'; break;
+                                        case '\b': *out++ = '\\'; *out++ = 'b'; break;
+                                        case '\f': *out++ = '\\'; *out++ = 'f'; break;
+                                        case '\n': *out++ = '\\'; *out++ = 'n'; break;
+                                        case '\r': *out++ = '\\'; *out++ = 'r'; break;
+                                        case '\t': *out++ = '\\'; *out++ = 't'; break;
+                                        default:
+                                                if(c < 0x20)
+                                                {
+                                                        //Other control characters must be escaped
+                                                        *out++ = '\\';
+                                                        *out++ = 'u';
+                                                        *out++ = '0';
+                                                        *out++ = '0';
+                                                        *out++ = hexDigits[c >> 4];
+                                                        *out++ = hexDigits[c & 0xf];
+                                                }
+                                                else
+                                                {
+                                                        *out++ = char(c);
+                                                }
+
+                                                break;
+                                }
+                        }
+                        else if(c < 0x800)
+                        {
+                                *out++ = char(0xc0 | (c >> 6));
+                                *out++ = char(0x80 | (c & 0x3f));
+                        }
+                        else
+                        {
+                                uint codePoint = c;
+
+                                if((c >= 0xd800) && (c <= 0xdfff))
+                                {
+                                        //A pair may span two chunks, which the extra six bytes allow for
+                                        if((c <= 0xdbff) && (i < size) && (data[i] >= 0xdc00) && (data[i] <= 0xdfff))
+                                        {
+                                                codePoint = 0x10000 + ((c - 0xd800) << 10) + (data[i++] - 0xdc00);
+                                        }
+                                        else
+                                        {
+                                                codePoint = 0xfffd;
+                                        }
+                                }
+
+                                if(codePoint >= 0x10000)
+                                {
+                                        *out++ = char(0xf0 | (codePoint >> 18));
+                                        *out++ = char(0x80 | ((codePoint >> 12) & 0x3f));
+                                        *out++ = char(0x80 | ((codePoint >> 6) & 0x3f));
+                                        *out++ = char(0x80 | (codePoint & 0x3f));
+                                }
+                                else
+                                {
+                                        *out++ = char(0xe0 | (codePoint >> 12));
+                                        *out++ = char(0x80 | ((codePoint >> 6) & 0x3f));
+                                        *out++ = char(0x80 | (codePoint & 0x3f));
+                                }
+                        }
+                }
+
+                buffer.resize(out - buffer.constData());
+        }
+
+        buffer.append('\"');
+}
+
+/**
+ * writeInteger
+ */
+void JsonWriter::writeInteger(qulonglong value, bool negative)
+{
+        char digits[21];
+        int i = sizeof(digits);
+
+        do
+        {
+                digits[--i] = char('0' + (value % 10));
+                value /= 10;
+        }
+        while(value);
+
+        if(negative)
+        {
+                digits[--i] = '-';
+        }
+
+        buffer.append(digits + i, sizeof(digits) - i);
+}
+
+/**
+ * JsonStreamParser
+ */
+JsonStreamParser::JsonStreamParser()
+{
+        reset();
+}
+
+/**
+ * reset
+ */
+void JsonStreamParser::reset()
+{
+        state = StateValue;
+        allowClose = false;
+        stringIsKey = false;
+        stack.clear();
+        root = QVariant();
+        buffer.clear();
+        highSurrogate = 0;
+        unicode = 0;
+        unicodeDigits = 0;
+        literal = 0;
+        literalIndex = 0;
+        literalValue = QVariant();
+        fed = 0;
+}
+
+/**
+ * hasError
+ */
+bool JsonStreamParser::hasError() const
+{
+        return state == StateError;
+}
+
+/**
+ * bytesFed
+ */
+qint64 JsonStreamParser::bytesFed() const
+{
+        return fed;
+}
+
+/**
+ * feed
+ */
+void JsonStreamParser::feed(const QByteArray &data)
+{
+        feed(data.constData(), data.size());
+}
+
+/**
+ * feed
+ */
+void JsonStreamParser::feed(const char *data, int size)
+{
+        fed += size;
+
+        for(int i = 0; i < size; i++)
+        {
+                const char c = data[i];
+
+                switch(state)
+                {
+                        case StateString:
+                                if(c == '"')
+                                {
+                                        endString();
+                                }
+                                else if(c == '\\')
+                                {
+                                        state = StateEscape;
+                                }
+                                else
+                                {
+                                        //Copy the whole run of unescaped bytes at once
+                                        const int end = indexOfStringEnd(data, i + 1, size);
+
+                                        flushSurrogate();
+                                        buffer.append(data + i, end - i);
+                                        i = end - 1;
+                                }
+
+                                break;
+                        case StateEscape:
+                                state = StateString;
+
+                                switch(c)
+                                {
+                                        case 'b': flushSurrogate(); buffer.append('\b'); break;
+                                        case 'f': flushSurrogate(); buffer.append('\f'); break;
+                                        case 'n': flushSurrogate(); buffer.append('\n'); break;
+                                        case 'r': flushSurrogate(); buffer.append('\r'); break;
+                                        case 't': flushSurrogate(); buffer.append('\t'); break;
+                                        case 'u':
+                                                unicode = 0;
+                                                unicodeDigits = 0;
+                                                state = StateUnicode;
+                                                break;
+                                        default:
+                                                flushSurrogate();
+                                                buffer.append(c);
+                                                break;
+                                }
+
+                                break;
+                        case StateUnicode:
+                        {
+                                const int digit = hexValue(uchar(c));
+
+                                if(digit < 0)
+                                {
+                                        state = StateError;
+                                        return;
+                                }
+
+                                unicode = (unicode << 4) | digit;
+
+                                if(++unicodeDigits == 4)
+                                {
+                                        appendCodeUnit(unicode);
+                                        state = StateString;
+                                }
+
+                                break;
+                        }
+                        case StateNumber:
+                                if(charClasses[uchar(c)] & CharNumber)
+                                {
+                                        buffer.append(c);
+                                }
+                                else
+                                {
+                                        if(!endNumber())
+                                        {
+                                                return;
+                                        }
+
+                                        //The delimiter is parsed in the new state
+                                        i--;
+                                }
+
+                                break;
+                        case StateLiteral:
+                                if(c != literal[literalIndex])
+                                {
+                                        state = StateError;
+                                        return;
+                                }
+
+                                if(literal[++literalIndex] == '\0')
+                                {
+                                        addValue(literalValue);
+                                }
+
+                                break;
+                        case StateDone:
+                        case StateError:
+                                //Trailing data is ignored, as by Json::parse()
+                                return;
+                        default:
+                                if(charClasses[uchar(c)] & CharWhitespace)
+                                {
+                                        break;
+                                }
+
+                                if(!beginValue(c))
+                                {
+                                        state = StateError;
+                                        return;
+                                }
+
+                                break;
+                }
+        }
+}
+
+/**
+ * finish
+ */
+QVariant JsonStreamParser::finish(bool &success)
+{
+        //A number at the top level has no delimiter
+        if((state == StateNumber) && (stack.isEmpty()))
+        {
+                endNumber();
+        }
+
+        success = (state == StateDone);
+        return success ? root : QVariant();
+}
+
+/**
+ * beginValue
+ */
+bool JsonStreamParser::beginValue(char c)
+{
+        switch(state)
+        {
+                case StateKey:
+                        if(c == '"')
+                        {
+                                stringIsKey = true;
+                                state = StateString;
+                                return true;
+                        }
+
+                        return (c == '}') && (allowClose) && (closeContainer(true));
+                case StateColon:
+                        if(c == ':')
+                        {
+                                state = StateValue;
+                                allowClose = false;
+                                return true;
+                        }
+
+                        return false;
+                case StateCommaOrClose:
+                        if(c == ',')
+                        {
+                                state = stack.last().object ? StateKey : StateValue;
+                                allowClose = false;
+                                return true;
+                        }
+
+                        if(c == '}')
+                        {
+                                return closeContainer(true);
+                        }
+
+                        return (c == ']') && (closeContainer(false));
+                default:
+                        break;
+        }
+
+        switch(c)
+        {
+                case '{':
+                        stack.append(Frame());
+                        stack.last().object = true;
+                        state = StateKey;
+                        allowClose = true;
+                        return true;
+                case '[':
+                        stack.append(Frame());
+                        stack.last().object = false;
+                        state = StateValue;
+                        allowClose = true;
+                        return true;
+                case ']':
+                        return (allowClose) && (closeContainer(false));
+                case '"':
+                        stringIsKey = false;
+                        state = StateString;
+                        return true;
+                case '0': case '1': case '2': case '3': case '4':
+                case '5': case '6': case '7': case '8': case '9':
+                case '-':
+                        buffer.append(c);
+                        state = StateNumber;
+                        return true;
+                case 't':
+                        literal = "true";
+                        literalValue = QVariant(true);
+                        break;
+                case 'f':
+                        literal = "false";
+                        literalValue = QVariant(false);
+                        break;
+                case 'n':
+                        literal = "null";
+                        literalValue = QVariant();
+                        break;
+                default:
+                        return false;
+        }
+
+        literalIndex = 1;
+        state = StateLiteral;
+        return true;
+}
+
+/**
+ * addValue
+ */
+void JsonStreamParser::addValue(const QVariant &value)
+{
+        if(stack.isEmpty())
+        {
+                root = value;
+                state = StateDone;
+                return;
+        }
+
+        Frame &frame = stack.last();
+
+        if(frame.object)
+        {
+                frame.map.insert(frame.key, value);
+        }
+        else
+        {
+                frame.list.append(value);
+        }
+
+        state = StateCommaOrClose;
+}
+
+/**
+ * closeContainer
+ */
+bool JsonStreamParser::closeContainer(bool object)
+{
+        if((stack.isEmpty()) || (stack.last().object != object))
+        {
+                return false;
+        }
+
+        const Frame frame = stack.takeLast();
+        addValue(object ? QVariant(frame.map) : QVariant(frame.list));
+        return true;
+}
+
+/**
+ * endString
+ */
+void JsonStreamParser::endString()
+{
+        flushSurrogate();
+        if(stringIsKey)
+        {
+                stack.last().key = JsonKeyPool::intern(buffer.constData(), buffer.size());
+                buffer.clear();
+                state = StateColon;
+        }
+        else
+        {
+                const QString s = QString::fromUtf8(buffer.constData(), buffer.size());
+                buffer.clear();
+                addValue(s);
+        }
+}
+
+/**
+ * endNumber
+ */
+bool JsonStreamParser::endNumber()
+{
+        QVariant value;
+        const bool ok = convertNumber(buffer.constData(), buffer.size(), value);
+        buffer.clear();
+
+        if(!ok)
+        {
+                state = StateError;
+                return false;
+        }
+
+        addValue(value);
+        return true;
+}
+
+/**
+ * appendCodeUnit
+ */
+void JsonStreamParser::appendCodeUnit(ushort unit)
+{
+        if((unit >= 0xdc00) && (unit <= 0xdfff) && (highSurrogate))
+        {
+                appendCodePoint(0x10000 + ((uint(highSurrogate) - 0xd800) << 10) + (unit - 0xdc00));
+                highSurrogate = 0;
+                return;
+        }
+
+        flushSurrogate();
+
+        if((unit >= 0xd800) && (unit <= 0xdbff))
+        {
+                //Wait for the low surrogate in the next escape
+                highSurrogate = unit;
+        }
+        else if((unit >= 0xdc00) && (unit <= 0xdfff))
+        {
+                appendCodePoint(0xfffd);
+        }
+        else
+        {
+                appendCodePoint(unit);
+        }
+}
+
+/**
+ * appendCodePoint
+ */
+void JsonStreamParser::appendCodePoint(uint codePoint)
+{
+        appendUtf8(buffer, codePoint);
+}
+
+/**
+ * flushSurrogate
+ */
+void JsonStreamParser::flushSurrogate()
+{
+        //A high surrogate that is not followed by a low surrogate is invalid
+        if(highSurrogate)
+        {
+                highSurrogate = 0;
+                appendCodePoint(0xfffd);
+        }
+}
+
+/**
+ * StructuralParser
+ */
+StructuralParser::StructuralParser(const char *json, int length) :
+        data(json),
+        size(length),
+        count(0),
+        pos(0),
+        cursor(0),
+        materialize(true),
+        closes(0)
+{
+}
+
+/**
+ * StructuralParser
+ */
+StructuralParser::StructuralParser(const char *json, int length, const QVector<int> &structurals) :
+        data(json),
+        size(length),
+        index(structurals),
+        count(structurals.size()),
+        pos(0),
+        cursor(0),
+        materialize(true),
+        closes(0)
+{
+}
+
+/**
+ * parse
+ */
+QVariant StructuralParser::parse(bool &success)
 {
-        str.replace(QLatin1String("\\"), QLatin1String("\\\\"));
-        str.replace(QLatin1String("\""), QLatin1String("\\\""));
-        str.replace(QLatin1String("\b"), QLatin1String("\\b"));
-        str.replace(QLatin1String("\f"), QLatin1String("\\f"));
-        str.replace(QLatin1String("\n"), QLatin1String("\\n"));
-        str.replace(QLatin1String("\r"), QLatin1String("\\r"));
-        str.replace(QLatin1String("\t"), QLatin1String("\\t"));
-        return QString(QLatin1String("\"%1\"")).arg(str);
+        QVariant value;
+
+        //Trailing data is ignored, as by Json::parse()
+        success = (buildIndex()) && (parseValue(value));
+        return success ? value : QVariant();
 }
 
-static QByteArray join(const QList<QByteArray> &list, const QByteArray &sep)
-{
-        QByteArray res;
-        Q_FOREACH(const QByteArray &i, list)
+/**
+ * validate
+ */
+bool StructuralParser::validate(QVector<int> &structurals, QVector<int> &containerCloses)
+{
+        QVariant value;
+        materialize = false;
+        closes = &containerCloses;
+
+        if(!buildIndex())
+        {
+                return false;
+        }
+
+        //Structural characters after the root value are not kept
+        index.resize(count);
+        containerCloses.fill(0, count);
+
+        if(!parseValue(value))
         {
-                if(!res.isEmpty())
-                {
-                        res += sep;
-                }
-                res += i;
+                return false;
         }
-        return res;
+
+        index.resize(pos);
+        index.squeeze();
+        containerCloses.resize(pos);
+        containerCloses.squeeze();
+        structurals = index;
+        return true;
 }
 
 /**
- * parse
+ * parseAt
  */
-QVariant Json::parse(const QString &json)
+QVariant StructuralParser::parseAt(int position, int start, bool &success)
 {
-        bool success = true;
-        return Json::parse(json, success);
+        QVariant value;
+        pos = position;
+        cursor = start;
+        success = parseValue(value);
+        return value;
 }
 
 /**
- * parse
+ * buildIndex
  */
-QVariant Json::parse(const QString &json, bool &success)
+bool StructuralParser::buildIndex()
 {
-        success = true;
+        quint64 escapeCarry = 0;
+        quint64 stringCarry = 0;
+        char tail[64];
 
-        //Return an empty QVariant if the JSON data is either null or empty
-        if(!json.isNull() || !json.isEmpty())
+        index.resize(qMax(64, size / 8));
+        count = 0;
+
+        for(int offset = 0; offset < size; offset += 64)
         {
-                QString data = json;
-                //We'll start from index 0
-                int index = 0;
+                const char *block = data + offset;
 
-                //Parse the first value
-                QVariant value = Json::parseValue(data, index, success);
+                //The last block is padded with whitespace
+                if(size - offset < 64)
+                {
+                        memset(tail, ' ', sizeof(tail));
+                        memcpy(tail, block, size - offset);
+                        block = tail;
+                }
 
-                //Return the parsed value
-                return value;
-        }
-        else
-        {
-                //Return the empty QVariant
-                return QVariant();
+                quint64 quotes = 0;
+                quint64 backslashes = 0;
+                quint64 structurals = 0;
+#ifdef QTJSON_SSE2
+                const __m128i quote = _mm_set1_epi8('"');
+                const __m128i backslash = _mm_set1_epi8('\\');
+                const __m128i lowercase = _mm_set1_epi8(0x20);
+                const __m128i curlyOpen = _mm_set1_epi8('{');
+                const __m128i curlyClose = _mm_set1_epi8('}');
+                const __m128i colon = _mm_set1_epi8(':');
+                const __m128i comma = _mm_set1_epi8(',');
+
+                for(int i = 0; i < 4; i++)
+                {
+                        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+                        //'[' and ']' differ from '{' and '}' only by 0x20
+                        const __m128i folded = _mm_or_si128(chunk, lowercase);
+                        const __m128i structural = _mm_or_si128(
+                                _mm_or_si128(_mm_cmpeq_epi8(folded, curlyOpen), _mm_cmpeq_epi8(folded, curlyClose)),
+                                _mm_or_si128(_mm_cmpeq_epi8(chunk, colon), _mm_cmpeq_epi8(chunk, comma)));
+
+                        quotes |= quint64(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)) & 0xffff) << (16 * i);
+                        backslashes |= quint64(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash)) & 0xffff)
+                                       << (16 * i);
+                        structurals |= quint64(_mm_movemask_epi8(structural) & 0xffff) << (16 * i);
+                }
+#else
+                for(int i = 0; i < 64; i++)
+                {
+                        const int token = charClasses[uchar(block[i])] & CharTokenMask;
+
+                        if(token == JsonTokenString)
+                        {
+                                quotes |= Q_UINT64_C(1) << i;
+                        }
+                        else if((token >= JsonTokenCurlyOpen) && (token <= JsonTokenComma))
+                        {
+                                structurals |= Q_UINT64_C(1) << i;
+                        }
+                        else if(block[i] == '\\')
+                        {
+                                backslashes |= Q_UINT64_C(1) << i;
+                        }
+                }
+#endif
+                //Find the characters escaped by a backslash
+                quint64 escaped = escapeCarry;
+                escapeCarry = 0;
+
+                while(backslashes)
+                {
+                        const int i = countTrailingZeros64(backslashes);
+                        backslashes &= backslashes - 1;
+
+                        if(!(escaped & (Q_UINT64_C(1) << i)))
+                        {
+                                if(i == 63)
+                                {
+                                        escapeCarry = 1;
+                                }
+                                else
+                                {
+                                        escaped |= Q_UINT64_C(1) << (i + 1);
+                                }
+                        }
+                }
+
+                quotes &= ~escaped;
+
+                //The prefix XOR of the quotes masks the strings, including
+                //the opening quote but not the closing quote
+                quint64 strings = quotes;
+                strings ^= strings << 1;
+                strings ^= strings << 2;
+                strings ^= strings << 4;
+                strings ^= strings << 8;
+                strings ^= strings << 16;
+                strings ^= strings << 32;
+                strings ^= stringCarry;
+                stringCarry = (strings >> 63) ? ~Q_UINT64_C(0) : 0;
+
+                structurals = (structurals & ~strings) | quotes;
+
+                if(count + 64 > index.size())
+                {
+                        index.resize(qMax(index.size() * 2, count + 64));
+                }
+
+                int *positions = index.data();
+
+                while(structurals)
+                {
+                        positions[count++] = offset + countTrailingZeros64(structurals);
+                        structurals &= structurals - 1;
+                }
         }
-}
 
-QByteArray Json::serialize(const QVariant &data)
-{
-        bool success = true;
-        return Json::serialize(data, success);
+        //The data ends within a string
+        return stringCarry == 0;
 }
 
-QByteArray Json::serialize(const QVariant &data, bool &success)
+/**
+ * parseValue
+ */
+bool StructuralParser::parseValue(QVariant &value)
 {
-        QByteArray str;
-        success = true;
+        const int start = skipWhitespace(cursor);
 
-        if(!data.isValid()) // invalid or null?
+        if(start >= size)
         {
-                str = "null";
+                return false;
         }
-        else if((data.type() == QVariant::List) || (data.type() == QVariant::StringList)) // variant is a list?
+
+        if((pos < count) && (index.at(pos) == start))
         {
-                QList<QByteArray> values;
-                const QVariantList list = data.toList();
-                Q_FOREACH(const QVariant& v, list)
+                switch(data[start])
                 {
-                        QByteArray serializedValue = serialize(v);
-                        if(serializedValue.isNull())
+                        case '{':
+                                return parseObject(value);
+                        case '[':
+                                return parseArray(value);
+                        case '"':
                         {
-                                success = false;
-                                break;
+                                QString s;
+
+                                if(!parseString(s))
+                                {
+                                        return false;
+                                }
+
+                                if(materialize)
+                                {
+                                        value = QVariant(s);
+                                }
+
+                                return true;
                         }
-                        values << serializedValue;
+                        default:
+                                return false;
                 }
+        }
+
+        //Numbers and literals end at the next structural character
+        const int end = pos < count ? index.at(pos) : size;
+        int last = end;
 
-                str = "[ " + join( values, ", " ) + " ]";
+        while((last > start) && (charClasses[uchar(data[last - 1])] & CharWhitespace))
+        {
+                last--;
         }
-        else if(data.type() == QVariant::Map) // variant is a map?
+
+        cursor = end;
+        return parseScalar(data + start, last - start, value);
+}
+
+/**
+ * parseObject
+ */
+bool StructuralParser::parseObject(QVariant &value)
+{
+        QVariantMap map;
+        const int open = pos;
+        expect('{');
+
+        if(!expect('}'))
         {
-                const QVariantMap vmap = data.toMap();
-                QMapIterator<QString, QVariant> it( vmap );
-                str = "{ ";
-                QList<QByteArray> pairs;
-                while(it.hasNext())
+                do
                 {
-                        it.next();
-                        QByteArray serializedValue = serialize(it.value());
-                        if(serializedValue.isNull())
+                        QString key;
+                        QVariant v;
+
+                        if((!peek('"')) || (!parseString(key, true)) || (!expect(':')) || (!parseValue(v)))
                         {
-                                success = false;
-                                break;
+                                return false;
                         }
-                        pairs << sanitizeString(it.key()).toUtf8() + ": " + serializedValue;
+
+                        if(materialize)
+                        {
+                                map.insert(key, v);
+                        }
+                }
+                while(expect(','));
+
+                if(!expect('}'))
+                {
+                        return false;
                 }
-                str += join(pairs, ", ");
-                str += " }";
         }
-        else if((data.type() == QVariant::String) || (data.type() == QVariant::ByteArray)) // a string or a byte array?
+
+        if(closes)
         {
-                str = sanitizeString(data.toString()).toUtf8();
+                (*closes)[open] = pos - 1;
         }
-        else if(data.type() == QVariant::Double) // double?
+
+        if(materialize)
         {
-                str = QByteArray::number(data.toDouble());
-                if(!str.contains(".") && ! str.contains("e"))
+                value = QVariant(map);
+        }
+
+        return true;
+}
+
+/**
+ * parseArray
+ */
+bool StructuralParser::parseArray(QVariant &value)
+{
+        QVariantList list;
+        const int open = pos;
+        expect('[');
+
+        if(!expect(']'))
+        {
+                do
+                {
+                        QVariant v;
+
+                        if(!parseValue(v))
+                        {
+                                return false;
+                        }
+
+                        if(materialize)
+                        {
+                                list.append(v);
+                        }
+                }
+                while(expect(','));
+
+                if(!expect(']'))
                 {
-                        str += ".0";
+                        return false;
                 }
         }
-        else if (data.type() == QVariant::Bool) // boolean value?
+
+        if(closes)
         {
-                str = data.toBool() ? "true" : "false";
+                (*closes)[open] = pos - 1;
         }
-        else if (data.type() == QVariant::ULongLong) // large unsigned number?
+
+        if(materialize)
         {
-                str = QByteArray::number(data.value<qulonglong>());
+                value = QVariant(list);
         }
-        else if ( data.canConvert<qlonglong>() ) // any signed number?
+
+        return true;
+}
+
+/**
+ * parseString
+ */
+bool StructuralParser::parseString(QString &value, bool key)
+{
+        //The closing quote is the next structural character
+        if((pos + 1 >= count) || (data[index.at(pos + 1)] != '"'))
         {
-                str = QByteArray::number(data.value<qlonglong>());
+                return false;
         }
-        else if (data.canConvert<long>())
+
+        const int start = index.at(pos) + 1;
+        const int end = index.at(pos + 1);
+        pos += 2;
+        cursor = end + 1;
+        return (!materialize) || (key ? decodeKey(data + start, end - start, value)
+                                      : decodeString(data + start, end - start, value));
+}
+
+/**
+ * decodeString
+ */
+bool StructuralParser::decodeString(const char *data, int size, QString &value)
+{
+        if(!memchr(data, '\\', size))
         {
-                str = QString::number(data.value<long>()).toUtf8();
+                value = QString::fromUtf8(data, size);
+                return true;
         }
-        else if (data.canConvert<QString>()) // can value be converted to string?
+
+        QByteArray buffer;
+        buffer.reserve(size);
+
+        if(!unescapeString(data, size, buffer))
         {
-                // this will catch QDate, QDateTime, QUrl, ...
-                str = sanitizeString(data.toString()).toUtf8();
+                return false;
         }
-        else
+
+        value = QString::fromUtf8(buffer.constData(), buffer.size());
+        return true;
+}
+
+/**
+ * decodeKey
+ */
+bool StructuralParser::decodeKey(const char *data, int size, QString &value)
+{
+        if(memchr(data, '\\', size))
         {
-                success = false;
+                return decodeString(data, size, value);
         }
-        if (success)
+
+        value = JsonKeyPool::intern(data, size);
+        return true;
+}
+
+/**
+ * parseScalar
+ */
+bool StructuralParser::parseScalar(const char *scalar, int length, QVariant &value)
+{
+        if((length == 4) && (!memcmp(scalar, "true", 4)))
         {
-                return str;
+                value = QVariant(true);
+                return true;
         }
-        else
+
+        if((length == 5) && (!memcmp(scalar, "false", 5)))
         {
-                return QByteArray();
+                value = QVariant(false);
+                return true;
+        }
+
+        if((length == 4) && (!memcmp(scalar, "null", 4)))
+        {
+                value = QVariant();
+                return true;
         }
+
+        return (length > 0) && ((scalar[0] == '-') || ((scalar[0] >= '0') && (scalar[0] <= '9')))
+               && (convertNumber(scalar, length, value));
 }
 
 /**
- * parseValue
+ * peek
  */
-QVariant Json::parseValue(const QString &json, int &index, bool &success)
+bool StructuralParser::peek(char c) const
 {
-        //Determine what kind of data we should parse by
-        //checking out the upcoming token
-        switch(Json::lookAhead(json, index))
+        //Only whitespace may lie between the cursor and the structural character
+        return (pos < count) && (data[index.at(pos)] == c) && (skipWhitespace(cursor) == index.at(pos));
+}
+
+/**
+ * expect
+ */
+bool StructuralParser::expect(char c)
+{
+        if(!peek(c))
         {
-                case JsonTokenString:
-                        return Json::parseString(json, index, success);
-                case JsonTokenNumber:
-                        return Json::parseNumber(json, index);
-                case JsonTokenCurlyOpen:
-                        return Json::parseObject(json, index, success);
-                case JsonTokenSquaredOpen:
-                        return Json::parseArray(json, index, success);
-                case JsonTokenTrue:
-                        Json::nextToken(json, index);
-                        return QVariant(true);
-                case JsonTokenFalse:
-                        Json::nextToken(json, index);
-                        return QVariant(false);
-                case JsonTokenNull:
-                        Json::nextToken(json, index);
-                        return QVariant();
-                case JsonTokenNone:
-                        break;
+                return false;
         }
 
-        //If there were no tokens, flag the failure and return an empty QVariant
-        success = false;
-        return QVariant();
+        cursor = index.at(pos++) + 1;
+        return true;
+}
+
+/**
+ * skipWhitespace
+ */
+int StructuralParser::skipWhitespace(int i) const
+{
+        while((i < size) && (charClasses[uchar(data[i])] & CharWhitespace))
+        {
+                i++;
+        }
+
+        return i;
+}
+
+/**
+ * JsonValue
+ */
+JsonValue::JsonValue() :
+        pos(-1),
+        start(0),
+        end(0)
+{
+}
+
+/**
+ * JsonValue
+ */
+JsonValue::JsonValue(const QExplicitlySharedDataPointer<JsonDocumentData> &data, int pos, int start, int end) :
+        d(data),
+        pos(pos),
+        start(start),
+        end(end)
+{
+}
+
+/**
+ * fromPosition
+ */
+JsonValue JsonValue::fromPosition(const QExplicitlySharedDataPointer<JsonDocumentData> &data, int cursor,
+                                  int pos, int &next)
+{
+        const char *json = data->json.constData();
+        const int size = data->json.size();
+        const QVector<int> &index = data->index;
+        int start = cursor;
+
+        while((start < size) && (charClasses[uchar(json[start])] & CharWhitespace))
+        {
+                start++;
+        }
+
+        if((pos < index.size()) && (index.at(pos) == start))
+        {
+                if(json[start] == '"')
+                {
+                        next = pos + 2;
+                        return JsonValue(data, pos, start + 1, index.at(pos + 1));
+                }
+
+                next = data->closes.at(pos) + 1;
+                return JsonValue(data, pos, start, index.at(next - 1) + 1);
+        }
+
+        //Numbers and literals end at the next structural character
+        int end = pos < index.size() ? index.at(pos) : size;
+
+        while((end > start) && (charClasses[uchar(json[end - 1])] & CharWhitespace))
+        {
+                end--;
+        }
+
+        next = pos;
+        return JsonValue(data, -1, start, end);
+}
+
+/**
+ * type
+ */
+JsonValue::Type JsonValue::type() const
+{
+        if(!d)
+        {
+                return Undefined;
+        }
+
+        if(pos >= 0)
+        {
+                switch(d->json.at(d->index.at(pos)))
+                {
+                        case '{':
+                                return Object;
+                        case '[':
+                                return Array;
+                        default:
+                                return String;
+                }
+        }
+
+        switch(d->json.at(start))
+        {
+                case 't':
+                case 'f':
+                        return Bool;
+                case 'n':
+                        return Null;
+                default:
+                        return Number;
+        }
 }
 
 /**
- * parseObject
+ * isUndefined
  */
-QVariant Json::parseObject(const QString &json, int &index, bool &success)
+bool JsonValue::isUndefined() const
 {
-        QVariantMap map;
-        int token;
+        return !d;
+}
 
-        //Get rid of the whitespace and increment index
-        Json::nextToken(json, index);
+/**
+ * nextMember
+ */
+bool JsonValue::nextMember(int &next, int &key, JsonValue &value) const
+{
+        const QVector<int> &index = d->index;
+        const int close = d->closes.at(pos);
 
-        //Loop through all of the key/value pairs of the object
-        bool done = false;
-        while(!done)
+        if(next == close)
         {
-                //Get the upcoming token
-                token = Json::lookAhead(json, index);
+                return false;
+        }
 
-                if(token == JsonTokenNone)
+        int after;
+
+        if(d->json.at(index.at(pos)) == '{')
+        {
+                //The key and the colon follow the separator
+                if(next + 1 == close)
                 {
-                         success = false;
-                         return QVariantMap();
+                        return false;
                 }
-                else if(token == JsonTokenComma)
+
+                key = next + 1;
+                value = fromPosition(d, index.at(next + 3) + 1, next + 4, after);
+        }
+        else
+        {
+                const char *json = d->json.constData();
+                int i = index.at(next) + 1;
+
+                while(charClasses[uchar(json[i])] & CharWhitespace)
                 {
-                        Json::nextToken(json, index);
+                        i++;
                 }
-                else if(token == JsonTokenCurlyClose)
+
+                //The array is empty
+                if((next == pos) && (i == index.at(close)))
                 {
-                        Json::nextToken(json, index);
-                        return map;
+                        return false;
                 }
-                else
-                {
-                        //Parse the key/value pair's name
-                        QString name = Json::parseString(json, index, success).toString();
 
-                        if(!success)
-                        {
-                                return QVariantMap();
-                        }
+                key = -1;
+                value = fromPosition(d, i, next + 1, after);
+        }
 
-                        //Get the next token
-                        token = Json::nextToken(json, index);
+        next = after;
+        return true;
+}
 
-                        //If the next token is not a colon, flag the failure
-                        //return an empty QVariant
-                        if(token != JsonTokenColon)
-                        {
-                                success = false;
-                                return QVariant(QVariantMap());
-                        }
+/**
+ * isKey
+ */
+bool JsonValue::isKey(int key, const char *name, int size) const
+{
+        const char *json = d->json.constData();
+        const int keyStart = d->index.at(key) + 1;
+        const int keySize = d->index.at(key + 1) - keyStart;
 
-                        //Parse the key/value pair's value
-                        QVariant value = Json::parseValue(json, index, success);
+        if(!memchr(json + keyStart, '\\', keySize))
+        {
+                return (keySize == size) && (!memcmp(json + keyStart, name, keySize));
+        }
 
-                        if(!success)
-                        {
-                                return QVariantMap();
-                        }
+        QString decoded;
+        return (StructuralParser::decodeString(json + keyStart, keySize, decoded))
+               && (decoded.toUtf8() == QByteArray(name, size));
+}
 
-                        //Assign the value to the key in the map
-                        map[name] = value;
-                }
+/**
+ * count
+ */
+int JsonValue::count() const
+{
+        const Type t = type();
+
+        if((t != Array) && (t != Object))
+        {
+                return 0;
         }
 
-        //Return the map successfully
-        return QVariant(map);
+        int next = pos;
+        int key;
+        int n = 0;
+        JsonValue v;
+
+        while(nextMember(next, key, v))
+        {
+                n++;
+        }
+
+        return n;
 }
 
 /**
- * parseArray
+ * at
  */
-QVariant Json::parseArray(const QString &json, int &index, bool &success)
+JsonValue JsonValue::at(int i) const
 {
-        QVariantList list;
+        if((type() != Array) || (i < 0))
+        {
+                return JsonValue();
+        }
 
-        Json::nextToken(json, index);
+        int next = pos;
+        int key;
+        JsonValue v;
 
-        bool done = false;
-        while(!done)
+        while(nextMember(next, key, v))
         {
-                int token = Json::lookAhead(json, index);
-
-                if(token == JsonTokenNone)
-                {
-                        success = false;
-                        return QVariantList();
-                }
-                else if(token == JsonTokenComma)
-                {
-                        Json::nextToken(json, index);
-                }
-                else if(token == JsonTokenSquaredClose)
+                if(i-- == 0)
                 {
-                        Json::nextToken(json, index);
-                        break;
+                        return v;
                 }
-                else
-                {
-                        QVariant value = Json::parseValue(json, index, success);
+        }
 
-                        if(!success)
-                        {
-                                return QVariantList();
-                        }
+        return JsonValue();
+}
 
-                        list.push_back(value);
-                }
+/**
+ * value
+ */
+JsonValue JsonValue::value(const QString &key) const
+{
+        if(type() != Object)
+        {
+                return JsonValue();
         }
 
-        return QVariant(list);
+        const QByteArray name = key.toUtf8();
+        return value(name.constData(), name.size());
 }
 
 /**
- * parseString
+ * value
  */
-QVariant Json::parseString(const QString &json, int &index, bool &success)
+JsonValue JsonValue::value(const char *key, int size) const
 {
-        QString s;
-        QChar c;
-
-        Json::eatWhitespace(json, index);
+        if(type() != Object)
+        {
+                return JsonValue();
+        }
 
-        c = json[index++];
+        int next = pos;
+        int k;
+        JsonValue v;
 
-        bool complete = false;
-        while(!complete)
+        while(nextMember(next, k, v))
         {
-                if(index == json.size())
+                if(isKey(k, key, size))
                 {
-                        break;
+                        return v;
                 }
+        }
+
+        return JsonValue();
+}
+
+/**
+ * query
+ */
+JsonValue JsonValue::query(const QString &path) const
+{
+        JsonValue v = *this;
+        int i = 0;
 
-                c = json[index++];
+        while((i < path.size()) && (!v.isUndefined()))
+        {
+                const QChar c = path.at(i);
 
-                if(c == '\"')
+                if(c == QLatin1Char('.'))
                 {
-                        complete = true;
-                        break;
+                        i++;
                 }
-                else if(c == '\\')
+                else if(c == QLatin1Char('['))
                 {
-                        if(index == json.size())
+                        const int close = path.indexOf(QLatin1Char(']'), i);
+                        bool ok = false;
+                        const int element = close > i ? path.mid(i + 1, close - i - 1).toInt(&ok) : 0;
+
+                        if(!ok)
                         {
-                                break;
+                                return JsonValue();
                         }
 
-                        c = json[index++];
+                        v = v.at(element);
+                        i = close + 1;
+                }
+                else
+                {
+                        int e = i + 1;
 
-                        if(c == '\"')
-                        {
-                                s.append('\"');
-                        }
-                        else if(c == '\\')
-                        {
-                                s.append('\\');
-                        }
-                        else if(c == '/')
-                        {
-                                s.append('/');
-                        }
-                        else if(c == 'b')
-                        {
-                                s.append('\b');
-                        }
-                        else if(c == 'f')
-                        {
-                                s.append('\f');
-                        }
-                        else if(c == 'n')
-                        {
-                                s.append('\n');
-                        }
-                        else if(c == 'r')
-                        {
-                                s.append('\r');
-                        }
-                        else if(c == 't')
+                        while((e < path.size()) && (path.at(e) != QLatin1Char('.'))
+                              && (path.at(e) != QLatin1Char('[')))
                         {
-                                s.append('\t');
+                                e++;
                         }
-                        else if(c == 'u')
-                        {
-                                int remainingLength = json.size() - index;
 
-                                if(remainingLength >= 4)
-                                {
-                                        QString unicodeStr = json.mid(index, 4);
+                        v = v.value(path.mid(i, e - i));
+                        i = e;
+                }
+        }
 
-                                        int symbol = unicodeStr.toInt(0, 16);
+        return v;
+}
 
-                                        s.append(QChar(symbol));
+/**
+ * keys
+ */
+QStringList JsonValue::keys() const
+{
+        QStringList list;
 
-                                        index += 4;
-                                }
-                                else
-                                {
-                                        break;
-                                }
-                        }
-                }
-                else
-                {
-                        s.append(c);
-                }
+        if(type() != Object)
+        {
+                return list;
         }
 
-        if(!complete)
+        const char *json = d->json.constData();
+        int next = pos;
+        int key;
+        JsonValue v;
+
+        while(nextMember(next, key, v))
         {
-                success = false;
-                return QVariant();
+                const int keyStart = d->index.at(key) + 1;
+                QString name;
+                StructuralParser::decodeKey(json + keyStart, d->index.at(key + 1) - keyStart, name);
+                list << name;
         }
 
-        return QVariant(s);
+        return list;
 }
 
 /**
- * parseNumber
+ * values
  */
-QVariant Json::parseNumber(const QString &json, int &index)
+QList<JsonValue> JsonValue::values() const
 {
-        Json::eatWhitespace(json, index);
-
-        int lastIndex = Json::lastIndexOfNumber(json, index);
-        int charLength = (lastIndex - index) + 1;
-        QString numberStr;
+        QList<JsonValue> list;
+        const Type t = type();
 
-        numberStr = json.mid(index, charLength);
+        if((t != Array) && (t != Object))
+        {
+                return list;
+        }
 
-        index = lastIndex + 1;
+        int next = pos;
+        int key;
+        JsonValue v;
 
-        if (numberStr.contains('.')) {
-                return QVariant(numberStr.toDouble(NULL));
-        } else if (numberStr.startsWith('-')) {
-                return QVariant(numberStr.toLongLong(NULL));
-        } else {
-                return QVariant(numberStr.toULongLong(NULL));
+        while(nextMember(next, key, v))
+        {
+                list << v;
         }
+
+        return list;
 }
 
 /**
- * lastIndexOfNumber
+ * toString
  */
-int Json::lastIndexOfNumber(const QString &json, int index)
+QString JsonValue::toString() const
 {
-        int lastIndex;
+        QString s;
 
-        for(lastIndex = index; lastIndex < json.size(); lastIndex++)
+        switch(type())
         {
-                if(QString("0123456789+-.eE").indexOf(json[lastIndex]) == -1)
-                {
+                case Undefined:
+                case Array:
+                case Object:
+                        break;
+                case String:
+                        StructuralParser::decodeString(d->json.constData() + start, end - start, s);
+                        break;
+                default:
+                        s = QString::fromUtf8(d->json.constData() + start, end - start);
                         break;
-                }
         }
 
-        return lastIndex -1;
+        return s;
 }
 
 /**
- * eatWhitespace
+ * toLongLong
  */
-void Json::eatWhitespace(const QString &json, int &index)
+qint64 JsonValue::toLongLong() const
 {
-        for(; index < json.size(); index++)
+        const Type t = type();
+
+        if((t != Number) && (t != String))
+        {
+                return 0;
+        }
+
+        //Numbers such as view counts are often sent as strings
+        QVariant number;
+        return convertNumber(d->json.constData() + start, end - start, number) ? number.toLongLong() : 0;
+}
+
+/**
+ * toBool
+ */
+bool JsonValue::toBool() const
+{
+        switch(type())
+        {
+                case Bool:
+                        return d->json.at(start) == 't';
+                case String:
+                        return (end - start == 4) && (!memcmp(d->json.constData() + start, "true", 4));
+                default:
+                        return false;
+        }
+}
+
+/**
+ * toVariant
+ */
+QVariant JsonValue::toVariant() const
+{
+        QVariant v;
+        bool ok;
+
+        switch(type())
         {
-                if(QString(" \t\n\r").indexOf(json[index]) == -1)
+                case Undefined:
+                        break;
+                case String:
+                        v = QVariant(toString());
+                        break;
+                case Array:
+                case Object:
                 {
+                        StructuralParser parser(d->json.constData(), d->json.size(), d->index);
+                        v = parser.parseAt(pos, start, ok);
                         break;
                 }
+                default:
+                        StructuralParser::parseScalar(d->json.constData() + start, end - start, v);
+                        break;
         }
+
+        return v;
 }
 
 /**
- * lookAhead
+ * JsonDocument
  */
-int Json::lookAhead(const QString &json, int index)
+JsonDocument::JsonDocument()
 {
-        int saveIndex = index;
-        return Json::nextToken(json, saveIndex);
 }
 
 /**
- * nextToken
+ * fromJson
  */
-int Json::nextToken(const QString &json, int &index)
+JsonDocument JsonDocument::fromJson(const QByteArray &json, bool &success)
 {
-        Json::eatWhitespace(json, index);
+        JsonDocument document;
+        QExplicitlySharedDataPointer<JsonDocumentData> data(new JsonDocumentData);
+        data->json = json;
 
-        if(index == json.size())
+        //The values are checked, but not built
+        StructuralParser parser(data->json.constData(), data->json.size());
+        success = parser.validate(data->index, data->closes);
+
+        if(success)
         {
-                return JsonTokenNone;
+                document.d = data;
         }
 
-        QChar c = json[index];
-        index++;
-        switch(c.toLatin1())
-        {
-                case '{': return JsonTokenCurlyOpen;
-                case '}': return JsonTokenCurlyClose;
-                case '[': return JsonTokenSquaredOpen;
-                case ']': return JsonTokenSquaredClose;
-                case ',': return JsonTokenComma;
-                case '"': return JsonTokenString;
-                case '0': case '1': case '2': case '3': case '4':
-                case '5': case '6': case '7': case '8': case '9':
-                case '-': return JsonTokenNumber;
-                case ':': return JsonTokenColon;
-        }
+        return document;
+}
+
+/**
+ * isNull
+ */
+bool JsonDocument::isNull() const
+{
+        return !d;
+}
 
-        index--;
+/**
+ * toJson
+ */
+QByteArray JsonDocument::toJson() const
+{
+        return d ? d->json : QByteArray();
+}
 
-        int remainingLength = json.size() - index;
+/**
+ * root
+ */
+JsonValue JsonDocument::root() const
+{
+        int next;
+        return d ? JsonValue::fromPosition(d, 0, 0, next) : JsonValue();
+}
 
-        //True
-        if(remainingLength >= 4)
-        {
-                if (json[index] == 't' && json[index + 1] == 'r' &&
-                        json[index + 2] == 'u' && json[index + 3] == 'e')
-                {
-                        index += 4;
-                        return JsonTokenTrue;
-                }
-        }
+/**
+ * query
+ */
+JsonValue JsonDocument::query(const QString &path) const
+{
+        return root().query(path);
+}
 
-        //False
-        if (remainingLength >= 5)
-        {
-                if (json[index] == 'f' && json[index + 1] == 'a' &&
-                        json[index + 2] == 'l' && json[index + 3] == 's' &&
-                        json[index + 4] == 'e')
-                {
-                        index += 5;
-                        return JsonTokenFalse;
-                }
-        }
+/**
+ * toVariant
+ */
+QVariant JsonDocument::toVariant() const
+{
+        return root().toVariant();
+}
 
-        //Null
-        if (remainingLength >= 4)
+/**
+ * memoryUsage
+ */
+int JsonDocument::memoryUsage() const
+{
+        if(!d)
         {
-                if (json[index] == 'n' && json[index + 1] == 'u' &&
-                        json[index + 2] == 'l' && json[index + 3] == 'l')
-                {
-                        index += 4;
-                        return JsonTokenNull;
-                }
+                return 0;
         }
 
-        return JsonTokenNone;
+        return int(sizeof(JsonDocumentData)) + d->json.size()
+               + (d->index.capacity() + d->closes.capacity()) * int(sizeof(int));
 }
 
-
 } //end namespace
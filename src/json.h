@@ -33,8 +33,14 @@
 #ifndef JSON_H
 #define JSON_H
 
+#include "qyoutube_global.h"
 #include <QVariant>
 #include <QString>
+#include <QStringList>
+#include <QSharedData>
+#include <QVector>
+
+class QIODevice;
 
 namespace QtJson
 {
@@ -64,7 +70,7 @@ enum JsonToken
  *
  * Json parses a JSON data into a QVariant hierarchy.
  */
-class Json
+class QYOUTUBESHARED_EXPORT Json
 {
         public:
                 /**
@@ -82,6 +88,25 @@ class Json
                  */
                 static QVariant parse(const QString &json, bool &success);
 
+                /**
+                 * Parse UTF-8 encoded JSON data
+                 *
+                 * Only string values are decoded, so the data is
+                 * not converted to a QString first. Large data is
+                 * parsed using an index of its structural characters.
+                 *
+                 * \param json The JSON data
+                 */
+                static QVariant parse(const QByteArray &json);
+
+                /**
+                 * Parse UTF-8 encoded JSON data
+                 *
+                 * \param json The JSON data
+                 * \param success The success of the parsing
+                 */
+                static QVariant parse(const QByteArray &json, bool &success);
+
                 /**
                 * This method generates a textual JSON representation
                 *
@@ -150,24 +175,25 @@ class Json
                                                                         bool &success);
 
                 /**
-                 * Parses a number starting from index
+                 * Parses the four hexadecimal digits of a \\u escape
+                 * starting from index
                  *
                  * \param json The JSON data
                  * \param index The starting index
                  *
-                 * \return QVariant The parsed number
+                 * \return int The UTF-16 code unit, or -1 if the digits are invalid
                  */
-                static QVariant parseNumber(const QString &json, int &index);
+                static int parseUnicodeEscape(const QString &json, int &index);
 
                 /**
-                 * Get the last index of a number starting from index
+                 * Parses a number starting from index
                  *
                  * \param json The JSON data
                  * \param index The starting index
                  *
-                 * \return The last index of the number
+                 * \return QVariant The parsed number
                  */
-                static int lastIndexOfNumber(const QString &json, int index);
+                static QVariant parseNumber(const QString &json, int &index);
 
                 /**
                  * Skip unwanted whitespace symbols starting from index
@@ -178,14 +204,15 @@ class Json
                 static void eatWhitespace(const QString &json, int &index);
 
                 /**
-                 * Check what token lies ahead
+                 * Check what token lies ahead, skipping any whitespace
+                 * before it
                  *
                  * \param json The JSON data
                  * \param index The starting index
                  *
                  * \return int The upcoming token
                  */
-                static int lookAhead(const QString &json, int index);
+                static int lookAhead(const QString &json, int &index);
 
                 /**
                  * Get the next JSON token
@@ -198,7 +225,471 @@ class Json
                 static int nextToken(const QString &json, int &index);
 };
 
+/**
+ * \class JsonKeyPool
+ * \brief A pool of the object keys created by the parsers
+ *
+ * Keys such as "kind", "etag" and "snippet" repeat in every item of a
+ * response. Each thread keeps a pool of the keys it has parsed, so that
+ * a repeated key shares the QString of the first one instead of
+ * allocating a new string. Long keys and keys beyond the capacity of the
+ * pool are not pooled.
+ *
+ * The statistics are the totals of all threads.
+ */
+class QYOUTUBESHARED_EXPORT JsonKeyPool
+{
+        public:
+                /**
+                 * \param utf8 The UTF-8 encoded key
+                 * \param size The size of the key in bytes
+                 *
+                 * \return QString The pooled key
+                 */
+                static QString intern(const char *utf8, int size);
+
+                /**
+                 * \param unicode The UTF-16 encoded key
+                 * \param size The size of the key in code units
+                 *
+                 * \return QString The pooled key
+                 */
+                static QString intern(const QChar *unicode, int size);
+
+                /**
+                 * \return int The number of keys pooled by all threads
+                 */
+                static int count();
+
+                /**
+                 * \return qint64 The number of keys that were found in a pool
+                 */
+                static qint64 hitCount();
+
+                /**
+                 * \return qint64 The number of keys that were not found in a pool
+                 */
+                static qint64 missCount();
+
+                /**
+                 * \return qint64 The approximate memory in bytes saved by
+                 * sharing pooled keys
+                 */
+                static qint64 savedBytes();
+
+                /**
+                 * Reset the hit and miss counts and the saved bytes
+                 */
+                static void resetStatistics();
+
+                /**
+                 * Remove all keys from the pool of the calling thread
+                 */
+                static void clear();
+
+                /**
+                 * Add the statistics of the calling thread to the totals.
+                 * Other threads add theirs after every 1024 lookups, and
+                 * when they finish
+                 */
+                static void flushStatistics();
+};
+
+/**
+ * \class JsonWriter
+ * \brief A single pass JSON data serializer
+ *
+ * JsonWriter appends the textual JSON representation of a QVariant
+ * hierarchy to one growing buffer, escaping each string as it is
+ * encoded as UTF-8. If a device is set, the buffer is written to the
+ * device whenever it fills, so that large values are streamed rather
+ * than held in memory.
+ */
+class QYOUTUBESHARED_EXPORT JsonWriter
+{
+        public:
+                JsonWriter();
+
+                /**
+                 * \param device The device to which the data is written
+                 */
+                explicit JsonWriter(QIODevice *device);
+
+                ~JsonWriter();
+
+                /**
+                 * Append a value
+                 *
+                 * \param data The value
+                 *
+                 * \return bool True if the value was serialized
+                 */
+                bool write(const QVariant &data);
+
+                /**
+                 * Write any buffered data to the device
+                 *
+                 * \return bool True if the data was written
+                 */
+                bool flush();
+
+                /**
+                 * \return QByteArray The data that has not been written
+                 * to a device
+                 */
+                QByteArray data() const;
+
+                /**
+                 * \return bool True if a value could not be serialized, or
+                 * the data could not be written to the device
+                 */
+                bool hasError() const;
+
+                /**
+                 * \param data The value
+                 *
+                 * \return int The estimated size in bytes of the serialized
+                 * value
+                 */
+                static int sizeHint(const QVariant &data);
+
+        private:
+                Q_DISABLE_COPY(JsonWriter)
+
+                bool writeValue(const QVariant &data);
+                void writeString(const QString &str);
+                void writeInteger(qulonglong value, bool negative);
+
+                QIODevice *device;
+                QByteArray buffer;
+                bool error;
+};
+
+/**
+ * \class JsonStreamParser
+ * \brief A resumable JSON data parser
+ *
+ * JsonStreamParser parses UTF-8 encoded JSON data into a QVariant
+ * hierarchy as it arrives. The data can be split into chunks at any
+ * byte, including within a token or a multi-byte UTF-8 sequence.
+ */
+class QYOUTUBESHARED_EXPORT JsonStreamParser
+{
+        public:
+                JsonStreamParser();
+
+                /**
+                 * Parse the next chunk of JSON data
+                 *
+                 * \param data The JSON data
+                 */
+                void feed(const QByteArray &data);
+
+                /**
+                 * Parse the next chunk of JSON data
+                 *
+                 * \param data The JSON data
+                 * \param size The size of the data in bytes
+                 */
+                void feed(const char *data, int size);
+
+                /**
+                 * Complete the parse after the last chunk has been fed
+                 *
+                 * \param success The success of the parsing
+                 *
+                 * \return QVariant The parsed value
+                 */
+                QVariant finish(bool &success);
+
+                /**
+                 * Discard any parsed data so that the parser can be reused
+                 */
+                void reset();
+
+                /**
+                 * \return bool True if the data is not valid JSON
+                 */
+                bool hasError() const;
+
+                /**
+                 * \return qint64 The number of bytes fed to the parser
+                 */
+                qint64 bytesFed() const;
+
+        private:
+                enum State
+                {
+                        StateValue = 0,
+                        StateKey,
+                        StateColon,
+                        StateCommaOrClose,
+                        StateString,
+                        StateEscape,
+                        StateUnicode,
+                        StateNumber,
+                        StateLiteral,
+                        StateDone,
+                        StateError
+                };
+
+                struct Frame
+                {
+                        bool object;
+                        QVariantMap map;
+                        QVariantList list;
+                        QString key;
+                };
+
+                bool beginValue(char c);
+                void addValue(const QVariant &value);
+                bool closeContainer(bool object);
+                void endString();
+                bool endNumber();
+                void appendCodeUnit(ushort unit);
+                void appendCodePoint(uint codePoint);
+                void flushSurrogate();
+
+                State state;
+                bool allowClose;
+                bool stringIsKey;
+
+                QList<Frame> stack;
+                QVariant root;
+
+                QByteArray buffer;
+                ushort highSurrogate;
+                ushort unicode;
+                int unicodeDigits;
+
+                const char *literal;
+                int literalIndex;
+                QVariant literalValue;
+
+                qint64 fed;
+};
+
+
+/**
+ * \class JsonDocumentData
+ * \brief The raw data and structural index shared by a JsonDocument
+ * and its values
+ */
+class JsonDocumentData : public QSharedData
+{
+        public:
+                QByteArray json;
+
+                //The positions of the structural characters in json
+                QVector<int> index;
+
+                //The index of the closing character of each object and array
+                QVector<int> closes;
+};
+
+/**
+ * \class JsonValue
+ * \brief A value in a JsonDocument
+ *
+ * A JsonValue refers to the raw data of its document, and is only
+ * parsed when it is accessed. Copying a JsonValue is cheap.
+ */
+class QYOUTUBESHARED_EXPORT JsonValue
+{
+        public:
+                enum Type
+                {
+                        Undefined = 0,
+                        Null,
+                        Bool,
+                        Number,
+                        String,
+                        Array,
+                        Object
+                };
+
+                /**
+                 * Constructs an undefined value
+                 */
+                JsonValue();
+
+                /**
+                 * \return Type The type of the value
+                 */
+                Type type() const;
+
+                /**
+                 * \return bool True if the value does not exist
+                 */
+                bool isUndefined() const;
+
+                /**
+                 * \return int The number of elements of an array or
+                 * members of an object
+                 */
+                int count() const;
+
+                /**
+                 * \param i The position of the element
+                 *
+                 * \return JsonValue The element of an array at position i
+                 */
+                JsonValue at(int i) const;
+
+                /**
+                 * \param key The name of the member
+                 *
+                 * \return JsonValue The member of an object named key
+                 */
+                JsonValue value(const QString &key) const;
+
+                /**
+                 * \param key The UTF-8 encoded name of the member
+                 * \param size The size of the name in bytes
+                 *
+                 * \return JsonValue The member of an object named key
+                 */
+                JsonValue value(const char *key, int size) const;
+
+                /**
+                 * Find a value using a path such as items[3].snippet.title
+                 *
+                 * \param path The path of the value
+                 *
+                 * \return JsonValue The value, or an undefined value
+                 */
+                JsonValue query(const QString &path) const;
+
+                /**
+                 * \return QStringList The names of the members of an object
+                 */
+                QStringList keys() const;
+
+                /**
+                 * \return QList<JsonValue> The elements of an array or the
+                 * values of the members of an object
+                 */
+                QList<JsonValue> values() const;
+
+                /**
+                 * \return QString The string, or the text of any other
+                 * value that is not an object or an array
+                 */
+                QString toString() const;
+
+                /**
+                 * \return qint64 The integer value of a number, or of a
+                 * string containing a number, otherwise 0
+                 */
+                qint64 toLongLong() const;
+
+                /**
+                 * \return bool True if the value is true or "true"
+                 */
+                bool toBool() const;
+
+                /**
+                 * Parse the value and everything it contains
+                 *
+                 * \return QVariant The parsed value
+                 */
+                QVariant toVariant() const;
+
+        private:
+                JsonValue(const QExplicitlySharedDataPointer<JsonDocumentData> &data, int pos, int start,
+                          int end);
+
+                static JsonValue fromPosition(const QExplicitlySharedDataPointer<JsonDocumentData> &data,
+                                              int cursor, int pos, int &next);
+
+                //Reads the element or member after the separator at the
+                //index position next, and moves next to the following
+                //separator. Returns false when there are no more.
+                bool nextMember(int &next, int &key, JsonValue &value) const;
+
+                bool isKey(int key, const char *name, int size) const;
+
+                QExplicitlySharedDataPointer<JsonDocumentData> d;
+
+                //The index position of an object, array or string, or -1
+                int pos;
+
+                //The span of a string's contents, or of any other value
+                int start;
+                int end;
+
+                friend class JsonDocument;
+};
+
+/**
+ * \class JsonDocument
+ * \brief A JSON document that is parsed on demand
+ *
+ * JsonDocument keeps the raw UTF-8 data and an index of its structural
+ * characters, which uses much less memory than the QVariant hierarchy
+ * built by Json::parse(). Values are only parsed when they are accessed.
+ */
+class QYOUTUBESHARED_EXPORT JsonDocument
+{
+        public:
+                /**
+                 * Constructs a null document
+                 */
+                JsonDocument();
+
+                /**
+                 * Index UTF-8 encoded JSON data
+                 *
+                 * \param json The JSON data
+                 * \param success The success of the indexing
+                 *
+                 * \return JsonDocument The document, or a null document
+                 */
+                static JsonDocument fromJson(const QByteArray &json, bool &success);
+
+                /**
+                 * \return bool True if the document has no data
+                 */
+                bool isNull() const;
+
+                /**
+                 * \return QByteArray The JSON data of the document
+                 */
+                QByteArray toJson() const;
+
+                /**
+                 * \return JsonValue The root value of the document
+                 */
+                JsonValue root() const;
+
+                /**
+                 * Find a value using a path such as items[3].snippet.title
+                 *
+                 * \param path The path of the value
+                 *
+                 * \return JsonValue The value, or an undefined value
+                 */
+                JsonValue query(const QString &path) const;
+
+                /**
+                 * Parse the whole document
+                 *
+                 * \return QVariant The parsed root value
+                 */
+                QVariant toVariant() const;
+
+                /**
+                 * \return int The approximate memory used by the document in bytes
+                 */
+                int memoryUsage() const;
+
+        private:
+                QExplicitlySharedDataPointer<JsonDocumentData> d;
+};
 
 } //end namespace
 
+Q_DECLARE_METATYPE(QtJson::JsonDocument)
+Q_DECLARE_METATYPE(QtJson::JsonValue)
+
 #endif //JSON_H
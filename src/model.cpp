@@ -67,7 +67,7 @@ QHash<int, QByteArray> Model::roleNames() const {
 int Model::rowCount(const QModelIndex &) const {
     Q_D(const Model);
     
-    return d->items.size();
+    return d->count();
 }
 
 /*!
@@ -76,7 +76,7 @@ int Model::rowCount(const QModelIndex &) const {
 QVariant Model::data(const QModelIndex &index, int role) const {
     Q_D(const Model);
     
-    return get(index.row()).value(d->roles.value(role));
+    return d->itemValue(index.row(), role);
 }
 
 /*!
@@ -86,14 +86,14 @@ QMap<int, QVariant> Model::itemData(const QModelIndex &index) const {
     Q_D(const Model);
     
     QMap<int, QVariant> map;
-    QVariantMap item = get(index.row());
+    int offset;
     
-    if (!item.isEmpty()) {
-        QHashIterator<int, QByteArray> iterator(d->roles);
+    if (const ModelBlock *block = d->findBlock(index.row(), offset)) {
+        QHash<int, QVector<QVariant> >::const_iterator iterator = block->columns.constBegin();
     
-        while (iterator.hasNext()) {
-            iterator.next();
-            map[iterator.key()] = item.value(iterator.value());
+        while (iterator != block->columns.constEnd()) {
+            map[iterator.key()] = iterator.value().at(offset);
+            ++iterator;
         }
     }
     
@@ -110,7 +110,10 @@ bool Model::setData(const QModelIndex &index, const QVariant &value, int role) {
     
     Q_D(Model);
     
-    d->items[index.row()][d->roles.value(role)] = value;
+    if (!d->setItemValue(index.row(), role, value)) {
+        return false;
+    }
+    
     emit dataChanged(index, index);
     
     return true;
@@ -130,7 +133,7 @@ bool Model::setItemData(const QModelIndex &index, const QMap<int, QVariant> &rol
     
     while (iterator.hasNext()) {
         iterator.next();
-        d->items[index.row()][d->roles.value(iterator.key())] = iterator.value();
+        d->setItemValue(index.row(), iterator.key(), iterator.value());
     }
     
     emit dataChanged(index, index);
@@ -152,8 +155,8 @@ void Model::append(const QMap<int, QVariant> &roles) {
         item[d->roles.value(iterator.key())] = iterator.value();
     }
     
-    beginInsertRows(QModelIndex(), d->items.size(), d->items.size());
-    d->items << item;
+    beginInsertRows(QModelIndex(), d->count(), d->count());
+    d->appendItem(item);
     endInsertRows();
     emit countChanged(rowCount());
 }
@@ -180,7 +183,7 @@ void Model::insert(const QModelIndex &index, const QMap<int, QVariant> &roles) {
     }
     
     beginInsertRows(QModelIndex(), index.row(), index.row());
-    d->items.insert(index.row(), item);
+    d->insertItem(index.row(), item);
     endInsertRows();
     emit countChanged(rowCount());
 }
@@ -198,7 +201,7 @@ bool Model::remove(const QModelIndex &index) {
     Q_D(Model);
     
     beginRemoveRows(QModelIndex(), index.row(), index.row());
-    d->items.removeAt(index.row());
+    d->removeItem(index.row());
     endRemoveRows();
     emit countChanged(rowCount());
     
@@ -207,11 +210,13 @@ bool Model::remove(const QModelIndex &index) {
 
 /*!
     \brief Returns the item at \a row.
+    
+    The item is created from the values of each role, so data() should be used where only some values are needed.
 */
 QVariantMap Model::get(int row) const {
     Q_D(const Model);
     
-    return (row >= 0) && (row < d->items.size()) ? d->items.at(row) : QVariantMap();
+    return d->item(row);
 }
 
 /*!
@@ -222,11 +227,11 @@ QVariantMap Model::get(int row) const {
 bool Model::setProperty(int row, const QString &property, const QVariant &value) {
     Q_D(Model);
     
-    if ((row < 0) || (row >= d->items.size())) {
+    if ((row < 0) || (row >= d->count())) {
         return false;
     }
     
-    d->items[row][property] = value;
+    d->setItemValue(row, property, value);
     QModelIndex i = index(row);
     emit dataChanged(i, i);
     
@@ -241,7 +246,7 @@ bool Model::setProperty(int row, const QString &property, const QVariant &value)
 bool Model::set(int row, const QVariantMap &properties) {
     Q_D(Model);
     
-    if ((row < 0) || (row >= d->items.size())) {
+    if ((row < 0) || (row >= d->count())) {
         return false;
     }
     
@@ -249,7 +254,7 @@ bool Model::set(int row, const QVariantMap &properties) {
     
     while (iterator.hasNext()) {
         iterator.next();
-        d->items[row][iterator.key()] = iterator.value();
+        d->setItemValue(row, iterator.key(), iterator.value());
     }
     
     QModelIndex i = index(row);
@@ -264,12 +269,12 @@ bool Model::set(int row, const QVariantMap &properties) {
 void Model::append(const QVariantMap &properties) {
     Q_D(Model);
     
-    if (d->items.isEmpty()) {
+    if (d->count() == 0) {
         d->setRoleNames(properties);
     }
     
-    beginInsertRows(QModelIndex(), d->items.size(), d->items.size());
-    d->items << properties;
+    beginInsertRows(QModelIndex(), d->count(), d->count());
+    d->appendItem(properties);
     endInsertRows();
     emit countChanged(rowCount());
 }
@@ -282,17 +287,13 @@ void Model::append(const QVariantMap &properties) {
 void Model::insert(int row, const QVariantMap &properties) {
     Q_D(Model);
     
-    if ((row < 0) || (row >= d->items.size())) {
+    if ((row < 0) || (row >= d->count())) {
         append(properties);
         return;
     }
     
-    if (d->items.isEmpty()) {
-        d->setRoleNames(properties);
-    }
-    
     beginInsertRows(QModelIndex(), row, row);
-    d->items.insert(row, properties);
+    d->insertItem(row, properties);
     endInsertRows();
     emit countChanged(rowCount());
 }
@@ -305,12 +306,12 @@ void Model::insert(int row, const QVariantMap &properties) {
 bool Model::remove(int row) {
     Q_D(Model);
     
-    if ((row < 0) || (row >= d->items.size())) {
+    if ((row < 0) || (row >= d->count())) {
         return false;
     }
     
     beginRemoveRows(QModelIndex(), row, row);
-    d->items.removeAt(row);
+    d->removeItem(row);
     endRemoveRows();
     emit countChanged(rowCount());
     
@@ -323,16 +324,17 @@ bool Model::remove(int row) {
 void Model::clear() {
     Q_D(Model);
     
-    if (!d->items.isEmpty()) {
+    if (d->count() > 0) {
         beginResetModel();
-        d->items.clear();
+        d->clearItems();
         endResetModel();
         emit countChanged(rowCount());
     }
 }
 
 ModelPrivate::ModelPrivate(Model *parent) :
-    q_ptr(parent)
+    q_ptr(parent),
+    rows(0)
 {
 }
 
@@ -350,6 +352,8 @@ void ModelPrivate::setRoleNames(const QVariantMap &item) {
         roles[role] = key.toUtf8();
         role++;
     }
+    
+    updateColumns();
 #if QT_VERSION < 0x050000
     Q_Q(Model);
     
@@ -357,6 +361,530 @@ void ModelPrivate::setRoleNames(const QVariantMap &item) {
 #endif
 }
 
+/*!
+    \internal
+    \brief Creates a column for each role in each block, and removes the columns of roles that no longer exist.
+    
+    This must be called whenever the roles are changed.
+*/
+void ModelPrivate::updateColumns() {
+    roleIds.clear();
+    QHashIterator<int, QByteArray> iterator(roles);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        roleIds[QString::fromUtf8(iterator.value())] = iterator.key();
+    }
+    
+    for (int i = 0; i < blocks.size(); i++) {
+        ModelBlock &block = blocks[i];
+        
+        if (block.released) {
+            continue;
+        }
+        
+        iterator.toFront();
+        
+        while (iterator.hasNext()) {
+            iterator.next();
+            
+            if (!block.columns.contains(iterator.key())) {
+                block.columns[iterator.key()] = QVector<QVariant>(block.count);
+            }
+        }
+        
+        foreach (int role, block.columns.keys()) {
+            if (!roles.contains(role)) {
+                block.columns.remove(role);
+            }
+        }
+    }
+}
+
+/*!
+    \internal
+    \brief Returns the number of items.
+*/
+int ModelPrivate::count() const {
+    return rows;
+}
+
+/*!
+    \internal
+    \brief Returns the index of the block containing \a row, or -1 if \a row is out of range.
+*/
+int ModelPrivate::blockOfRow(int row) const {
+    if ((row < 0) || (row >= rows)) {
+        return -1;
+    }
+    
+    if (blocks.size() == 1) {
+        return 0;
+    }
+    
+    return int(qUpperBound(blockOffsets.constBegin(), blockOffsets.constEnd(), row) - blockOffsets.constBegin()) - 1;
+}
+
+/*!
+    \internal
+    \brief Returns the block containing \a row, setting \a offset to the position of \a row within it.
+    
+    Returns 0 if \a row is out of range or its block has been released.
+*/
+ModelBlock* ModelPrivate::findBlock(int row, int &offset) {
+    const int i = blockOfRow(row);
+    
+    if ((i < 0) || (blocks.at(i).released)) {
+        return 0;
+    }
+    
+    offset = row - blockOffsets.at(i);
+    return &blocks[i];
+}
+
+const ModelBlock* ModelPrivate::findBlock(int row, int &offset) const {
+    const int i = blockOfRow(row);
+    
+    if ((i < 0) || (blocks.at(i).released)) {
+        return 0;
+    }
+    
+    offset = row - blockOffsets.at(i);
+    return &blocks.at(i);
+}
+
+/*!
+    \internal
+    \brief Creates the item at \a row from its role values and extra properties.
+    
+    The item of a released block is empty.
+*/
+QVariantMap ModelPrivate::item(int row) const {
+    int offset;
+    const ModelBlock *block = findBlock(row, offset);
+    
+    if (!block) {
+        return QVariantMap();
+    }
+    
+    QVariantMap map = block->extraProperties.at(offset);
+    QHash<int, QVector<QVariant> >::const_iterator iterator = block->columns.constBegin();
+    
+    while (iterator != block->columns.constEnd()) {
+        const QVariant &value = iterator.value().at(offset);
+        
+        if (value.isValid()) {
+            map[QString::fromUtf8(roles.value(iterator.key()))] = value;
+        }
+        
+        ++iterator;
+    }
+    
+    return map;
+}
+
+/*!
+    \internal
+    \brief Returns the value of \a role for the item at \a row.
+*/
+QVariant ModelPrivate::itemValue(int row, int role) const {
+    int offset;
+    const ModelBlock *block = findBlock(row, offset);
+    
+    if (!block) {
+        return QVariant();
+    }
+    
+    QHash<int, QVector<QVariant> >::const_iterator column = block->columns.constFind(role);
+    return column != block->columns.constEnd() ? column.value().at(offset) : QVariant();
+}
+
+/*!
+    \internal
+    \brief Returns the property \a name of the item at \a row.
+*/
+QVariant ModelPrivate::itemValue(int row, const QString &name) const {
+    QHash<QString, int>::const_iterator role = roleIds.constFind(name);
+    
+    if (role != roleIds.constEnd()) {
+        return itemValue(row, role.value());
+    }
+    
+    int offset;
+    const ModelBlock *block = findBlock(row, offset);
+    return block ? block->extraProperties.at(offset).value(name) : QVariant();
+}
+
+/*!
+    \internal
+    \brief Appends \a item to the last block, storing the value of each role in its column.
+*/
+void ModelPrivate::appendItem(const QVariantMap &item) {
+    insertItem(count(), item);
+}
+
+/*!
+    \internal
+    \brief Inserts \a item before \a row, storing the value of each role in its column.
+    
+    The item is added to the block containing \a row, or to the last block if \a row is count(). If that block has 
+    been released, only its number of rows changes.
+*/
+void ModelPrivate::insertItem(int row, const QVariantMap &item) {
+    if (blocks.isEmpty()) {
+        appendBlock();
+    }
+    
+    const int i = row >= count() ? blocks.size() - 1 : qMax(0, blockOfRow(row));
+    ModelBlock &block = blocks[i];
+    const int offset = qBound(0, row - blockOffsets.at(i), block.count);
+    block.count++;
+    rows++;
+    updateBlockOffsets(i + 1);
+    
+    if (block.released) {
+        return;
+    }
+    
+    QHash<int, QVector<QVariant> >::iterator column = block.columns.begin();
+    
+    while (column != block.columns.end()) {
+        column.value().insert(offset, QVariant());
+        ++column;
+    }
+    
+    QVariantMap extra;
+    QMapIterator<QString, QVariant> iterator(item);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        QHash<QString, int>::const_iterator role = roleIds.constFind(iterator.key());
+        
+        if (role != roleIds.constEnd()) {
+            block.columns[role.value()][offset] = iterator.value();
+        }
+        else {
+            extra[iterator.key()] = iterator.value();
+        }
+    }
+    
+    block.extraProperties.insert(offset, extra);
+}
+
+/*!
+    \internal
+    \brief Removes the item at \a row.
+    
+    The block containing \a row is kept, even if it becomes empty.
+*/
+void ModelPrivate::removeItem(int row) {
+    const int i = blockOfRow(row);
+    
+    if (i < 0) {
+        return;
+    }
+    
+    ModelBlock &block = blocks[i];
+    const int offset = row - blockOffsets.at(i);
+    block.count--;
+    rows--;
+    updateBlockOffsets(i + 1);
+    
+    if (block.released) {
+        return;
+    }
+    
+    QHash<int, QVector<QVariant> >::iterator column = block.columns.begin();
+    
+    while (column != block.columns.end()) {
+        column.value().remove(offset);
+        ++column;
+    }
+    
+    block.extraProperties.remove(offset);
+}
+
+/*!
+    \internal
+    \brief Moves the item at \a from so that it is at \a to.
+*/
+void ModelPrivate::moveItem(int from, int to) {
+    const int i = blockOfRow(from);
+    
+    if ((i < 0) || (i != blockOfRow(to)) || (blocks.at(i).released)) {
+        const QVariantMap moved = item(from);
+        removeItem(from);
+        insertItem(to, moved);
+        return;
+    }
+    
+    ModelBlock &block = blocks[i];
+    const int offset = from - blockOffsets.at(i);
+    const int target = to - blockOffsets.at(i);
+    QHash<int, QVector<QVariant> >::iterator column = block.columns.begin();
+    
+    while (column != block.columns.end()) {
+        const QVariant value = column.value().at(offset);
+        column.value().remove(offset);
+        column.value().insert(target, value);
+        ++column;
+    }
+    
+    const QVariantMap extra = block.extraProperties.at(offset);
+    block.extraProperties.remove(offset);
+    block.extraProperties.insert(target, extra);
+}
+
+/*!
+    \internal
+    \brief Removes all items and blocks.
+*/
+void ModelPrivate::clearItems() {
+    blocks.clear();
+    blockOffsets.clear();
+    rows = 0;
+}
+
+/*!
+    \internal
+    \brief Replaces the values of the item at \a row with those of \a item.
+*/
+void ModelPrivate::setItem(int row, const QVariantMap &item) {
+    int offset;
+    ModelBlock *block = findBlock(row, offset);
+    
+    if (!block) {
+        return;
+    }
+    
+    QHash<int, QVector<QVariant> >::iterator column = block->columns.begin();
+    
+    while (column != block->columns.end()) {
+        column.value()[offset] = QVariant();
+        ++column;
+    }
+    
+    block->extraProperties[offset] = QVariantMap();
+    QMapIterator<QString, QVariant> iterator(item);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        setItemValue(row, iterator.key(), iterator.value());
+    }
+}
+
+/*!
+    \internal
+    \brief Sets the value of \a role for the item at \a row.
+    
+    Returns false if there is no such role, or the block containing \a row has been released.
+*/
+bool ModelPrivate::setItemValue(int row, int role, const QVariant &value) {
+    int offset;
+    ModelBlock *block = findBlock(row, offset);
+    
+    if (!block) {
+        return false;
+    }
+    
+    QHash<int, QVector<QVariant> >::iterator column = block->columns.find(role);
+    
+    if (column == block->columns.end()) {
+        return false;
+    }
+    
+    column.value()[offset] = value;
+    return true;
+}
+
+/*!
+    \internal
+    \brief Sets the property \a name of the item at \a row.
+*/
+void ModelPrivate::setItemValue(int row, const QString &name, const QVariant &value) {
+    QHash<QString, int>::const_iterator role = roleIds.constFind(name);
+    
+    if (role != roleIds.constEnd()) {
+        setItemValue(row, role.value(), value);
+        return;
+    }
+    
+    int offset;
+    
+    if (ModelBlock *block = findBlock(row, offset)) {
+        block->extraProperties[offset][name] = value;
+    }
+}
+
+/*!
+    \internal
+    \brief Starts a new block, to which appended items are added.
+*/
+void ModelPrivate::appendBlock() {
+    ModelBlock block;
+    QHashIterator<int, QByteArray> iterator(roles);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        block.columns[iterator.key()] = QVector<QVariant>();
+    }
+    
+    blocks << block;
+    blockOffsets << count();
+}
+
+/*!
+    \internal
+    \brief Releases the items of \a block, keeping only its number of rows.
+*/
+void ModelPrivate::releaseBlock(int block) {
+    if ((block < 0) || (block >= blocks.size())) {
+        return;
+    }
+    
+    ModelBlock &b = blocks[block];
+    b.released = true;
+    b.columns.clear();
+    b.extraProperties = QVector<QVariantMap>();
+}
+
+/*!
+    \internal
+    \brief Replaces the items of \a block with \a items, restoring it if it has been released.
+    
+    The number of rows in the block is not changed. Rows without an item are left empty, and surplus items are 
+    ignored.
+*/
+void ModelPrivate::setBlock(int block, const QList<QVariantMap> &items) {
+    if ((block < 0) || (block >= blocks.size())) {
+        return;
+    }
+    
+    ModelBlock &b = blocks[block];
+    b.released = false;
+    b.columns.clear();
+    b.extraProperties = QVector<QVariantMap>(b.count);
+    QHashIterator<int, QByteArray> iterator(roles);
+    
+    while (iterator.hasNext()) {
+        iterator.next();
+        b.columns[iterator.key()] = QVector<QVariant>(b.count);
+    }
+    
+    for (int i = 0; i < qMin(b.count, items.size()); i++) {
+        QMapIterator<QString, QVariant> property(items.at(i));
+        
+        while (property.hasNext()) {
+            property.next();
+            QHash<QString, int>::const_iterator role = roleIds.constFind(property.key());
+            
+            if (role != roleIds.constEnd()) {
+                b.columns[role.value()][i] = property.value();
+            }
+            else {
+                b.extraProperties[i][property.key()] = property.value();
+            }
+        }
+    }
+}
+
+/*!
+    \internal
+    \brief Divides the items into blocks of \a sizes rows.
+    
+    Any items beyond the total of \a sizes are added to the last block. A block whose rows already match its new 
+    size is kept as it is, and other blocks are split or joined by copying only the parts of their columns that 
+    move. A new block containing rows of a released block is also released.
+*/
+void ModelPrivate::setBlockSizes(const QVector<int> &sizes) {
+    QVector<int> targets;
+    int remaining = rows;
+    
+    for (int i = 0; i < sizes.size(); i++) {
+        const int size = i < sizes.size() - 1 ? qBound(0, sizes.at(i), remaining) : remaining;
+        targets << size;
+        remaining -= size;
+    }
+    
+    if ((targets.isEmpty()) && (rows > 0)) {
+        targets << rows;
+    }
+    
+    QList<ModelBlock> source;
+    qSwap(source, blocks);
+    int b = 0;
+    int offset = 0;
+    
+    foreach (int target, targets) {
+        while ((b < source.size()) && (offset >= source.at(b).count)) {
+            b++;
+            offset = 0;
+        }
+        
+        if ((offset == 0) && (b < source.size()) && (source.at(b).count == target) && (target > 0)) {
+            blocks << source.at(b);
+            offset = target;
+            continue;
+        }
+        
+        ModelBlock block;
+        QHashIterator<int, QByteArray> iterator(roles);
+        
+        while (iterator.hasNext()) {
+            iterator.next();
+            block.columns[iterator.key()] = QVector<QVariant>();
+        }
+        
+        int needed = target;
+        
+        while ((needed > 0) && (b < source.size())) {
+            const ModelBlock &from = source.at(b);
+            const int n = qMin(needed, from.count - offset);
+            block.count += n;
+            block.released = (block.released) || (from.released);
+            
+            if (!block.released) {
+                QHash<int, QVector<QVariant> >::iterator column = block.columns.begin();
+                
+                while (column != block.columns.end()) {
+                    column.value() += from.columns.value(column.key()).mid(offset, n);
+                    ++column;
+                }
+                
+                block.extraProperties += from.extraProperties.mid(offset, n);
+            }
+            
+            needed -= n;
+            offset += n;
+            
+            if (offset >= from.count) {
+                b++;
+                offset = 0;
+            }
+        }
+        
+        if (block.released) {
+            block.columns.clear();
+            block.extraProperties = QVector<QVariantMap>();
+        }
+        
+        blocks << block;
+    }
+    
+    blockOffsets = QVector<int>(blocks.size(), 0);
+    updateBlockOffsets(1);
+}
+
+/*!
+    \internal
+    \brief Updates the offsets of the blocks from \a block onwards.
+*/
+void ModelPrivate::updateBlockOffsets(int block) {
+    for (int i = qMax(1, block); i < blocks.size(); i++) {
+        blockOffsets[i] = blockOffsets.at(i - 1) + blocks.at(i - 1).count;
+    }
+}
+
 }
 
 #include "moc_model.cpp"
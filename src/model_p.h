@@ -18,9 +18,43 @@
 #define QYOUTUBE_MODEL_P_H
 
 #include "model.h"
+#include <QVector>
 
 namespace QYouTube {
 
+/*!
+    \internal
+    \brief A block of consecutive items, with the value of each role held in a contiguous column.
+    
+    A released block keeps only its number of rows, so its items cost no memory until the block is set again.
+*/
+class ModelBlock
+{
+
+public:
+    ModelBlock() :
+        count(0),
+        released(false)
+    {
+    }
+    
+    int count;
+    
+    bool released;
+    
+    QHash<int, QVector<QVariant> > columns;
+    
+    QVector<QVariantMap> extraProperties;
+};
+
+/*!
+    \internal
+    \brief Stores the items of a Model in blocks, with one column per role in each block.
+    
+    The value of each role is held in a contiguous column, so that data() needs no copy of the item and no lookup by 
+    name. Properties that do not have a role are kept in a map for each row. Items are appended to the last block, 
+    so a model that does not start new blocks keeps all of its items in one.
+*/
 class ModelPrivate
 {
 
@@ -29,12 +63,47 @@ public:
     virtual ~ModelPrivate();
     
     void setRoleNames(const QVariantMap &item);
+    
+    int count() const;
+    
+    QVariantMap item(int row) const;
+    QVariant itemValue(int row, int role) const;
+    QVariant itemValue(int row, const QString &name) const;
+    
+    void appendItem(const QVariantMap &item);
+    void insertItem(int row, const QVariantMap &item);
+    void removeItem(int row);
+    void moveItem(int from, int to);
+    void clearItems();
+    
+    void setItem(int row, const QVariantMap &item);
+    
+    bool setItemValue(int row, int role, const QVariant &value);
+    void setItemValue(int row, const QString &name, const QVariant &value);
+    
+    int blockOfRow(int row) const;
+    ModelBlock* findBlock(int row, int &offset);
+    const ModelBlock* findBlock(int row, int &offset) const;
+    
+    void appendBlock();
+    void releaseBlock(int block);
+    void setBlock(int block, const QList<QVariantMap> &items);
+    void setBlockSizes(const QVector<int> &sizes);
+    void updateBlockOffsets(int block);
+    
+    void updateColumns();
         
     Model *q_ptr;
     
     QHash<int, QByteArray> roles;
     
-    QList<QVariantMap> items;
+    QHash<QString, int> roleIds;
+    
+    QList<ModelBlock> blocks;
+    
+    QVector<int> blockOffsets;
+    
+    int rows;
     
     Q_DECLARE_PUBLIC(Model)
 };
@@ -0,0 +1,446 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "networkaccessmanagerpool_p.h"
+#include <QBuffer>
+#include <QCoreApplication>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadStorage>
+#ifdef QYOUTUBE_DEBUG
+#include <QDebug>
+#endif
+
+namespace QYouTube {
+
+class NetworkAccessManagerPoolData
+{
+
+public:
+    NetworkAccessManagerPoolData() :
+        maximumConnectionsPerHost(0),
+        requests(0),
+        encryptedRequests(0),
+        handshakes(0)
+    {
+    }
+
+    QMutex mutex;
+
+    int maximumConnectionsPerHost;
+
+    qint64 requests;
+
+    qint64 encryptedRequests;
+
+    qint64 handshakes;
+};
+
+Q_GLOBAL_STATIC(NetworkAccessManagerPoolData, poolData)
+
+static QThreadStorage<PooledNetworkAccessManager*> managers;
+
+// The main thread outlives the application, so its manager is owned by the application instead.
+static QPointer<PooledNetworkAccessManager> mainManager;
+
+static QString hostKey(const QUrl &url) {
+    return QString("%1://%2:%3").arg(url.scheme()).arg(url.host())
+                                .arg(url.port(url.scheme() == "https" ? 443 : 80));
+}
+
+/*!
+    \class NetworkAccessManagerPool
+    \brief Provides the QNetworkAccessManager instances shared by all requests.
+
+    \ingroup requests
+
+    Unless a QNetworkAccessManager is set using Request::setNetworkAccessManager(), all requests and models use the
+    manager provided by NetworkAccessManagerPool for the current thread. Sharing a single manager allows connections,
+    TLS sessions and DNS lookups to be reused between requests.
+
+    The number of concurrent connections to each host can be limited using setMaximumConnectionsPerHost(). Requests
+    exceeding the limit are queued until a connection becomes available.
+
+    NetworkAccessManagerPool also counts the requests made using the shared managers, and the TLS handshakes needed 
+    to make them. A request sent over a connection that is kept alive needs no new handshake, so the difference 
+    shows whether connections are being reused:
+
+    \code
+    qDebug() << "HTTPS requests:" << NetworkAccessManagerPool::encryptedRequestCount()
+             << "handshakes:" << NetworkAccessManagerPool::handshakeCount()
+             << "reused:" << NetworkAccessManagerPool::reusedConnectionCount();
+    \endcode
+*/
+
+/*!
+    \brief Returns the shared QNetworkAccessManager for the current thread.
+
+    The manager is created when first required. The manager for the main thread is a child of the application, and 
+    is deleted with it. Managers for other threads are deleted when the thread exits.
+*/
+QNetworkAccessManager* NetworkAccessManagerPool::networkAccessManager() {
+    QCoreApplication *app = QCoreApplication::instance();
+
+    if ((app) && (QThread::currentThread() == app->thread())) {
+        if (!mainManager) {
+            mainManager = new PooledNetworkAccessManager(app);
+#ifdef QYOUTUBE_DEBUG
+            qDebug() << "QYouTube::NetworkAccessManagerPool::networkAccessManager: Created manager" << mainManager;
+#endif
+        }
+
+        return mainManager;
+    }
+
+    if (!managers.hasLocalData()) {
+        managers.setLocalData(new PooledNetworkAccessManager);
+#ifdef QYOUTUBE_DEBUG
+        qDebug() << "QYouTube::NetworkAccessManagerPool::networkAccessManager: Created manager" << managers.localData();
+#endif
+    }
+
+    return managers.localData();
+}
+
+/*!
+    \brief Returns the maximum number of concurrent connections to a single host.
+
+    The default value is 0, meaning that no additional limit is imposed (QNetworkAccessManager uses up to six
+    connections per host).
+*/
+int NetworkAccessManagerPool::maximumConnectionsPerHost() {
+    QMutexLocker locker(&poolData()->mutex);
+
+    return poolData()->maximumConnectionsPerHost;
+}
+
+/*!
+    \brief Sets the maximum number of concurrent connections to a single host to \a maximum.
+
+    Requests that would exceed the maximum are queued until an existing request to the same host has finished.
+*/
+void NetworkAccessManagerPool::setMaximumConnectionsPerHost(int maximum) {
+    QMutexLocker locker(&poolData()->mutex);
+
+    poolData()->maximumConnectionsPerHost = qMax(0, maximum);
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::NetworkAccessManagerPool::setMaximumConnectionsPerHost" << maximum;
+#endif
+}
+
+/*!
+    \brief Returns the number of requests sent using the shared managers.
+*/
+qint64 NetworkAccessManagerPool::requestCount() {
+    QMutexLocker locker(&poolData()->mutex);
+
+    return poolData()->requests;
+}
+
+/*!
+    \brief Returns the number of HTTPS requests sent using the shared managers.
+*/
+qint64 NetworkAccessManagerPool::encryptedRequestCount() {
+    QMutexLocker locker(&poolData()->mutex);
+
+    return poolData()->encryptedRequests;
+}
+
+/*!
+    \brief Returns the number of TLS handshakes completed by the shared managers.
+
+    Handshakes are counted using QNetworkAccessManager::encrypted(), which Qt emits once for each new encrypted 
+    connection. The signal is only available from Qt 5.1, so earlier versions return -1.
+
+    A handshake that resumes a cached TLS session still counts, as it still opens a new connection. Handshakes that 
+    fail are not counted.
+*/
+qint64 NetworkAccessManagerPool::handshakeCount() {
+#if QT_VERSION >= 0x050100
+    QMutexLocker locker(&poolData()->mutex);
+
+    return poolData()->handshakes;
+#else
+    return -1;
+#endif
+}
+
+/*!
+    \brief Returns the number of HTTPS requests that were sent over an existing connection.
+
+    This is the difference between encryptedRequestCount() and handshakeCount(), so it only covers HTTPS requests, 
+    and is an estimate if requests were still in progress when the statistics were reset. Plain HTTP requests do not 
+    report new connections, so their reuse cannot be counted. Returns -1 if handshakeCount() is not available.
+*/
+qint64 NetworkAccessManagerPool::reusedConnectionCount() {
+#if QT_VERSION >= 0x050100
+    QMutexLocker locker(&poolData()->mutex);
+
+    return qMax(Q_INT64_C(0), poolData()->encryptedRequests - poolData()->handshakes);
+#else
+    return -1;
+#endif
+}
+
+/*!
+    \brief Resets the request and handshake counters to zero.
+*/
+void NetworkAccessManagerPool::resetStatistics() {
+    QMutexLocker locker(&poolData()->mutex);
+
+    poolData()->requests = 0;
+    poolData()->encryptedRequests = 0;
+    poolData()->handshakes = 0;
+}
+
+PendingNetworkReply::PendingNetworkReply(QNetworkAccessManager::Operation op, const QNetworkRequest &request,
+                                         QIODevice *outgoingData, QObject *parent) :
+    QNetworkReply(parent),
+    buffer(0),
+    complete(false)
+{
+    setOperation(op);
+    setRequest(request);
+    setUrl(request.url());
+
+    if (outgoingData) {
+        // The outgoing data may be deleted before the request is started, so it is copied.
+        buffer = new QBuffer(this);
+        buffer->setData(outgoingData->readAll());
+        buffer->open(QIODevice::ReadOnly);
+    }
+
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+PendingNetworkReply::~PendingNetworkReply() {
+    if (reply) {
+        delete reply;
+    }
+}
+
+QIODevice* PendingNetworkReply::outgoingData() const {
+    return buffer;
+}
+
+bool PendingNetworkReply::isComplete() const {
+    return complete;
+}
+
+bool PendingNetworkReply::isStarted() const {
+    return reply != 0;
+}
+
+void PendingNetworkReply::start(QNetworkReply *r) {
+    reply = r;
+    connect(reply, SIGNAL(metaDataChanged()), this, SLOT(_q_onMetaDataChanged()));
+    connect(reply, SIGNAL(readyRead()), this, SLOT(_q_onReadyRead()));
+    connect(reply, SIGNAL(downloadProgress(qint64, qint64)), this, SIGNAL(downloadProgress(qint64, qint64)));
+    connect(reply, SIGNAL(uploadProgress(qint64, qint64)), this, SIGNAL(uploadProgress(qint64, qint64)));
+    connect(reply, SIGNAL(finished()), this, SLOT(_q_onFinished()));
+    emit started();
+}
+
+void PendingNetworkReply::abort() {
+    if (reply) {
+        reply->abort();
+        return;
+    }
+
+    if (complete) {
+        return;
+    }
+
+    complete = true;
+    setError(OperationCanceledError, tr("Operation canceled"));
+#if QT_VERSION >= 0x040800
+    setFinished(true);
+#endif
+    emit error(OperationCanceledError);
+    emit finished();
+}
+
+qint64 PendingNetworkReply::bytesAvailable() const {
+    return content.size() + QNetworkReply::bytesAvailable();
+}
+
+bool PendingNetworkReply::isSequential() const {
+    return true;
+}
+
+qint64 PendingNetworkReply::readData(char *data, qint64 maxSize) {
+    if (content.isEmpty()) {
+        return complete ? -1 : 0;
+    }
+
+    const qint64 size = qMin(maxSize, qint64(content.size()));
+    memcpy(data, content.constData(), size);
+    content.remove(0, size);
+
+    return size;
+}
+
+void PendingNetworkReply::copyMetaData() {
+    foreach (const QByteArray &header, reply->rawHeaderList()) {
+        setRawHeader(header, reply->rawHeader(header));
+    }
+
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute,
+                 reply->attribute(QNetworkRequest::HttpStatusCodeAttribute));
+    setAttribute(QNetworkRequest::HttpReasonPhraseAttribute,
+                 reply->attribute(QNetworkRequest::HttpReasonPhraseAttribute));
+    setAttribute(QNetworkRequest::RedirectionTargetAttribute,
+                 reply->attribute(QNetworkRequest::RedirectionTargetAttribute));
+    setAttribute(QNetworkRequest::ConnectionEncryptedAttribute,
+                 reply->attribute(QNetworkRequest::ConnectionEncryptedAttribute));
+    setAttribute(QNetworkRequest::SourceIsFromCacheAttribute,
+                 reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute));
+    setUrl(reply->url());
+}
+
+void PendingNetworkReply::_q_onMetaDataChanged() {
+    copyMetaData();
+    emit metaDataChanged();
+}
+
+void PendingNetworkReply::_q_onReadyRead() {
+    content.append(reply->readAll());
+    emit readyRead();
+}
+
+void PendingNetworkReply::_q_onFinished() {
+    copyMetaData();
+    content.append(reply->readAll());
+    complete = true;
+
+    const NetworkError e = reply->error();
+
+    if (e != NoError) {
+        setError(e, reply->errorString());
+    }
+#if QT_VERSION >= 0x040800
+    setFinished(true);
+#endif
+    if (e != NoError) {
+        emit error(e);
+    }
+
+    emit finished();
+}
+
+PooledNetworkAccessManager::PooledNetworkAccessManager(QObject *parent) :
+    QNetworkAccessManager(parent)
+{
+#if QT_VERSION >= 0x050100
+    connect(this, SIGNAL(encrypted(QNetworkReply*)), this, SLOT(_q_onEncrypted()));
+#endif
+}
+
+QNetworkReply* PooledNetworkAccessManager::createRequest(Operation op, const QNetworkRequest &request,
+                                                         QIODevice *outgoingData) {
+    const int maximum = NetworkAccessManagerPool::maximumConnectionsPerHost();
+
+    if (maximum > 0) {
+        const QString host = hostKey(request.url());
+
+        if (activeReplies.value(host) >= maximum) {
+#ifdef QYOUTUBE_DEBUG
+            qDebug() << "QYouTube::PooledNetworkAccessManager::createRequest: Queueing request" << request.url();
+#endif
+            PendingNetworkReply *reply = new PendingNetworkReply(op, request, outgoingData, this);
+            pendingReplies[host].enqueue(QPointer<PendingNetworkReply>(reply));
+            return reply;
+        }
+    }
+
+    return startRequest(op, request, outgoingData);
+}
+
+QNetworkReply* PooledNetworkAccessManager::startRequest(Operation op, const QNetworkRequest &request,
+                                                        QIODevice *outgoingData) {
+    QNetworkReply *reply = QNetworkAccessManager::createRequest(op, request, outgoingData);
+    const QString host = hostKey(request.url());
+    activeReplies[host]++;
+    replyHosts[reply] = host;
+    connect(reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+    connect(reply, SIGNAL(destroyed(QObject*)), this, SLOT(_q_onReplyDestroyed(QObject*)));
+
+    QMutexLocker locker(&poolData()->mutex);
+    poolData()->requests++;
+
+    if (request.url().scheme() == "https") {
+        poolData()->encryptedRequests++;
+    }
+
+    return reply;
+}
+
+void PooledNetworkAccessManager::releaseReply(QObject *obj) {
+    if (!replyHosts.contains(obj)) {
+        return;
+    }
+
+    const QString host = replyHosts.take(obj);
+
+    if (--activeReplies[host] <= 0) {
+        activeReplies.remove(host);
+    }
+
+    startPendingRequests(host);
+}
+
+void PooledNetworkAccessManager::startPendingRequests(const QString &host) {
+    if (!pendingReplies.contains(host)) {
+        return;
+    }
+
+    const int maximum = NetworkAccessManagerPool::maximumConnectionsPerHost();
+    QQueue< QPointer<PendingNetworkReply> > &queue = pendingReplies[host];
+
+    while ((!queue.isEmpty()) && ((maximum <= 0) || (activeReplies.value(host) < maximum))) {
+        const QPointer<PendingNetworkReply> pending = queue.dequeue();
+
+        if ((pending) && (!pending->isComplete())) {
+#ifdef QYOUTUBE_DEBUG
+            qDebug() << "QYouTube::PooledNetworkAccessManager::startPendingRequests: Starting request" << pending->url();
+#endif
+            pending->start(startRequest(pending->operation(), pending->request(), pending->outgoingData()));
+        }
+    }
+
+    if (queue.isEmpty()) {
+        pendingReplies.remove(host);
+    }
+}
+
+// Emitted once for each new encrypted connection, but not for requests sent over an existing one.
+void PooledNetworkAccessManager::_q_onEncrypted() {
+    QMutexLocker locker(&poolData()->mutex);
+    poolData()->handshakes++;
+}
+
+void PooledNetworkAccessManager::_q_onReplyFinished() {
+    releaseReply(sender());
+}
+
+void PooledNetworkAccessManager::_q_onReplyDestroyed(QObject *obj) {
+    releaseReply(obj);
+}
+
+}
+
+#include "moc_networkaccessmanagerpool_p.cpp"
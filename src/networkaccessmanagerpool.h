@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_NETWORKACCESSMANAGERPOOL_H
+#define QYOUTUBE_NETWORKACCESSMANAGERPOOL_H
+
+#include "qyoutube_global.h"
+
+class QNetworkAccessManager;
+
+namespace QYouTube {
+
+class QYOUTUBESHARED_EXPORT NetworkAccessManagerPool
+{
+
+public:
+    static QNetworkAccessManager* networkAccessManager();
+
+    static int maximumConnectionsPerHost();
+    static void setMaximumConnectionsPerHost(int maximum);
+
+    static qint64 requestCount();
+    static qint64 encryptedRequestCount();
+    static qint64 handshakeCount();
+    static qint64 reusedConnectionCount();
+    static void resetStatistics();
+
+private:
+    NetworkAccessManagerPool();
+
+    Q_DISABLE_COPY(NetworkAccessManagerPool)
+};
+
+}
+
+#endif // QYOUTUBE_NETWORKACCESSMANAGERPOOL_H
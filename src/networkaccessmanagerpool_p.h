@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_NETWORKACCESSMANAGERPOOL_P_H
+#define QYOUTUBE_NETWORKACCESSMANAGERPOOL_P_H
+
+#include "networkaccessmanagerpool.h"
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QPointer>
+#include <QQueue>
+
+class QBuffer;
+
+namespace QYouTube {
+
+/*!
+    \internal
+    \brief A QNetworkReply that waits for a free connection to its host.
+
+    Once a connection is available, the real reply is started and its data is forwarded.
+*/
+class PendingNetworkReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    PendingNetworkReply(QNetworkAccessManager::Operation op, const QNetworkRequest &request,
+                        QIODevice *outgoingData, QObject *parent = 0);
+    ~PendingNetworkReply();
+
+    QIODevice* outgoingData() const;
+
+    bool isComplete() const;
+
+    bool isStarted() const;
+
+    void start(QNetworkReply *r);
+
+    void abort();
+
+    qint64 bytesAvailable() const;
+
+    bool isSequential() const;
+
+Q_SIGNALS:
+    void started();
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+
+private Q_SLOTS:
+    void _q_onMetaDataChanged();
+    void _q_onReadyRead();
+    void _q_onFinished();
+
+private:
+    void copyMetaData();
+
+    QPointer<QNetworkReply> reply;
+
+    QBuffer *buffer;
+
+    QByteArray content;
+
+    bool complete;
+};
+
+/*!
+    \internal
+    \brief The QNetworkAccessManager shared by all requests made in a single thread.
+*/
+class PooledNetworkAccessManager : public QNetworkAccessManager
+{
+    Q_OBJECT
+
+public:
+    explicit PooledNetworkAccessManager(QObject *parent = 0);
+
+protected:
+    QNetworkReply* createRequest(Operation op, const QNetworkRequest &request, QIODevice *outgoingData = 0);
+
+private Q_SLOTS:
+    void _q_onEncrypted();
+    void _q_onReplyFinished();
+    void _q_onReplyDestroyed(QObject *obj);
+
+private:
+    QNetworkReply* startRequest(Operation op, const QNetworkRequest &request, QIODevice *outgoingData);
+
+    void releaseReply(QObject *obj);
+
+    void startPendingRequests(const QString &host);
+
+    QHash<QString, int> activeReplies;
+
+    QHash<QString, QQueue< QPointer<PendingNetworkReply> > > pendingReplies;
+
+    QHash<QObject*, QString> replyHosts;
+};
+
+}
+
+#endif // QYOUTUBE_NETWORKACCESSMANAGERPOOL_P_H
@@ -0,0 +1,500 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "quotatracker_p.h"
+#include <QDateTime>
+#include <QMutexLocker>
+#include <qmath.h>
+#ifdef QYOUTUBE_DEBUG
+#include <QDebug>
+#endif
+
+namespace QYouTube {
+
+static const qint64 RATE_WINDOW = 60000;
+
+/*!
+    \class QuotaTracker
+    \brief Accounts for the YouTube Data API quota used by requests, and optionally limits it.
+
+    \ingroup requests
+
+    Each call to the YouTube Data API has a quota cost, which depends on the method and the resource. When a
+    QuotaTracker is set on a ResourcesRequest or ResourcesModel, the cost of each call is charged to the tracker
+    before the request is made. A GET request that shares a reply already in flight for an identical request makes
+    no call, so it is not charged. The tracker keeps the total for the current day, both overall and for each API
+    key or client id, and the number of units used in the last minute. All of these are updated as requests are
+    made, and usageChanged() is emitted.
+
+    The daily totals are reset at midnight Pacific Standard Time, when the YouTube Data API quota is reset.
+
+    By default, the tracker only records usage. Admission control can be enabled by setting admissionPolicy, together
+    with dailyBudget and/or rateLimit:
+
+    <table>
+        <tr>
+            <th>Policy</th>
+            <th>Description</th>
+        </tr>
+        <tr>
+            <td>NoAdmissionControl</td>
+            <td>Requests are only recorded (default).</td>
+        </tr>
+        <tr>
+            <td>DelayRequests</td>
+            <td>Requests that would exceed rateLimit are delayed until they are within the limit. Requests that would
+            exceed dailyBudget fail with Request::QuotaExceededError.</td>
+        </tr>
+        <tr>
+            <td>RejectRequests</td>
+            <td>Requests that would exceed either rateLimit or dailyBudget fail with Request::QuotaExceededError.</td>
+        </tr>
+    </table>
+
+    The rate limit is a token bucket holding up to rateLimit units, which refills at rateLimit units per minute. A
+    call is admitted once the bucket holds its cost, or is full if the call costs more than rateLimit. The cost is
+    then taken from the bucket, which may leave it in debt, and later calls wait until the debt has been repaid. So
+    usage never exceeds rateLimit units per minute over time, even for calls that cost more than rateLimit.
+
+    Setting rateLimit to the daily quota divided by the number of minutes in a day spreads the use of the quota
+    evenly throughout the day. With the default quota of 10000 units this is 6 units per minute, so after a search
+    (100 units) further calls are delayed for about 16 minutes, and after a video upload (1600 units) for about 4.5
+    hours:
+
+    \code
+    QuotaTracker *tracker = new QuotaTracker(this);
+    tracker->setDailyBudget(10000);
+    tracker->setRateLimit(10000 / 1440);
+    tracker->setAdmissionPolicy(QuotaTracker::DelayRequests);
+
+    ResourcesModel *model = new ResourcesModel(this);
+    model->setQuotaTracker(tracker);
+    \endcode
+
+    A single QuotaTracker can be shared between any number of requests and models, including those in different
+    threads.
+
+    \sa Request::setQuotaTracker()
+*/
+QuotaTracker::QuotaTracker(QObject *parent) :
+    QObject(parent),
+    d_ptr(new QuotaTrackerPrivate(this))
+{
+}
+
+QuotaTracker::QuotaTracker(QuotaTrackerPrivate &dd, QObject *parent) :
+    QObject(parent),
+    d_ptr(&dd)
+{
+}
+
+QuotaTracker::~QuotaTracker() {}
+
+/*!
+    \enum QuotaTracker::AdmissionPolicy
+    \brief Determines what happens to requests that would exceed the dailyBudget or rateLimit.
+*/
+
+/*!
+    \property AdmissionPolicy QuotaTracker::admissionPolicy
+    \brief What happens to requests that would exceed the dailyBudget or rateLimit.
+
+    The default value is NoAdmissionControl.
+*/
+
+/*!
+    \fn void QuotaTracker::admissionPolicyChanged()
+    \brief Emitted when the admissionPolicy changes.
+*/
+QuotaTracker::AdmissionPolicy QuotaTracker::admissionPolicy() const {
+    Q_D(const QuotaTracker);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->admissionPolicy;
+}
+
+void QuotaTracker::setAdmissionPolicy(QuotaTracker::AdmissionPolicy policy) {
+    Q_D(QuotaTracker);
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        if (policy == d->admissionPolicy) {
+            return;
+        }
+
+        d->admissionPolicy = policy;
+    }
+
+    emit admissionPolicyChanged();
+}
+
+/*!
+    \property int QuotaTracker::dailyBudget
+    \brief The maximum number of units that can be used in a day.
+
+    The budget is only enforced when admissionPolicy is not NoAdmissionControl. The default value is 0 (no limit).
+*/
+
+/*!
+    \fn void QuotaTracker::dailyBudgetChanged()
+    \brief Emitted when the dailyBudget changes.
+*/
+int QuotaTracker::dailyBudget() const {
+    Q_D(const QuotaTracker);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->dailyBudget;
+}
+
+void QuotaTracker::setDailyBudget(int units) {
+    Q_D(QuotaTracker);
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        units = qMax(0, units);
+
+        if (units == d->dailyBudget) {
+            return;
+        }
+
+        d->dailyBudget = units;
+    }
+
+    emit dailyBudgetChanged();
+}
+
+/*!
+    \property int QuotaTracker::rateLimit
+    \brief The maximum number of units that can be used per minute.
+
+    The limit is enforced using a token bucket that allows debt, so calls that cost more than the limit are admitted
+    and delay later calls instead. It is only enforced when admissionPolicy is not NoAdmissionControl. The default
+    value is 0 (no limit).
+*/
+
+/*!
+    \fn void QuotaTracker::rateLimitChanged()
+    \brief Emitted when the rateLimit changes.
+*/
+int QuotaTracker::rateLimit() const {
+    Q_D(const QuotaTracker);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->rateLimit;
+}
+
+void QuotaTracker::setRateLimit(int unitsPerMinute) {
+    Q_D(QuotaTracker);
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        unitsPerMinute = qMax(0, unitsPerMinute);
+
+        if (unitsPerMinute == d->rateLimit) {
+            return;
+        }
+
+        d->rateLimit = unitsPerMinute;
+    }
+
+    emit rateLimitChanged();
+}
+
+/*!
+    \property qint64 QuotaTracker::dailyUsage
+    \brief The number of units used today.
+*/
+
+/*!
+    \fn void QuotaTracker::usageChanged()
+    \brief Emitted when a request is charged or rejected.
+*/
+qint64 QuotaTracker::dailyUsage() const {
+    Q_D(const QuotaTracker);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->day == QuotaTrackerPrivate::quotaDay() ? d->dailyUsage : 0;
+}
+
+/*!
+    \brief Returns the number of units used today by requests made with \a key.
+
+    \a key is the API key of the request, or its client id if it has no API key.
+*/
+qint64 QuotaTracker::dailyUsage(const QString &key) const {
+    Q_D(const QuotaTracker);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->day == QuotaTrackerPrivate::quotaDay() ? d->keyUsage.value(key) : 0;
+}
+
+/*!
+    \brief Returns the API keys and client ids that have been charged today.
+*/
+QStringList QuotaTracker::keys() const {
+    Q_D(const QuotaTracker);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->day == QuotaTrackerPrivate::quotaDay() ? d->keyUsage.keys() : QStringList();
+}
+
+/*!
+    \property int QuotaTracker::currentRate
+    \brief The number of units used in the last minute.
+*/
+int QuotaTracker::currentRate() const {
+    Q_D(const QuotaTracker);
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    QMutexLocker locker(&d->mutex);
+
+    int units = 0;
+
+    foreach (const QuotaCharge &charge, d->charges) {
+        if ((charge.first > now - RATE_WINDOW) && (charge.first <= now)) {
+            units += charge.second;
+        }
+    }
+
+    return units;
+}
+
+/*!
+    \property qint64 QuotaTracker::delayedCount
+    \brief The number of requests that have been delayed by admission control.
+*/
+qint64 QuotaTracker::delayedCount() const {
+    Q_D(const QuotaTracker);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->delayed;
+}
+
+/*!
+    \property qint64 QuotaTracker::rejectedCount
+    \brief The number of requests that have been rejected by admission control.
+*/
+qint64 QuotaTracker::rejectedCount() const {
+    Q_D(const QuotaTracker);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->rejected;
+}
+
+/*!
+    \brief Returns the quota cost of a call to \a resourcePath using \a operation.
+
+    The costs are those documented for the YouTube Data API: 1 unit for most list requests, 100 units for search,
+    50 units for most insert, update and delete requests, and 1600 units for a video upload.
+
+    Reimplement this method if different costs are required.
+*/
+int QuotaTracker::cost(Request::Operation operation, const QString &resourcePath) const {
+    const QString path = resourcePath.startsWith("/") ? resourcePath.mid(1) : resourcePath;
+
+    switch (operation) {
+    case Request::HeadOperation:
+    case Request::GetOperation:
+        if (path == "search") {
+            return 100;
+        }
+
+        if (path.startsWith("captions/")) {
+            return 200;
+        }
+
+        return 1;
+    case Request::PostOperation:
+        if (path == "videos") {
+            return 1600;
+        }
+
+        if (path == "captions") {
+            return 400;
+        }
+
+        return 50;
+    case Request::PutOperation:
+        return path == "captions" ? 450 : 50;
+    case Request::DeleteOperation:
+        return 50;
+    default:
+        return 0;
+    }
+}
+
+/*!
+    \brief Charges a call to \a resourcePath using \a operation to \a key.
+
+    Returns the number of milliseconds by which the call must be delayed, or -1 if the call is rejected.
+
+    This is called by ResourcesRequest, and does not normally need to be called.
+*/
+int QuotaTracker::admit(const QString &key, Request::Operation operation, const QString &resourcePath) {
+    Q_D(QuotaTracker);
+
+    const int units = cost(operation, resourcePath);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 delay = 0;
+    bool rejected = false;
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        d->rollOver();
+        d->expireCharges(now);
+
+        if (d->admissionPolicy != NoAdmissionControl) {
+            if ((d->dailyBudget > 0) && (d->dailyUsage + units > d->dailyBudget)) {
+                rejected = true;
+            }
+            else if (d->rateLimit > 0) {
+                if (d->admissionPolicy == RejectRequests) {
+                    // Calls that have been delayed by DelayRequests are still waiting for the bucket.
+                    rejected = (now < d->bucketTime) || (d->bucketLevel(now) < qMin(units, d->rateLimit));
+                }
+
+                if (!rejected) {
+                    delay = d->scheduleCharge(now, units) - now;
+                }
+            }
+        }
+
+        if (rejected) {
+            d->rejected++;
+        }
+        else {
+            if (delay > 0) {
+                d->delayed++;
+            }
+
+            // Charges are kept in time order, so delayed charges are inserted after any earlier ones.
+            const QuotaCharge charge(now + delay, units);
+            int i = d->charges.size();
+
+            while ((i > 0) && (d->charges.at(i - 1).first > charge.first)) {
+                i--;
+            }
+
+            d->charges.insert(i, charge);
+            d->dailyUsage += units;
+            d->keyUsage[key] += units;
+        }
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::QuotaTracker::admit" << key << Request::Operation(operation) << resourcePath << units
+             << rejected << delay;
+#endif
+    emit usageChanged();
+    return rejected ? -1 : int(delay);
+}
+
+/*!
+    \brief Resets all usage totals and counters to zero.
+*/
+void QuotaTracker::reset() {
+    Q_D(QuotaTracker);
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        d->dailyUsage = 0;
+        d->keyUsage.clear();
+        d->charges.clear();
+        d->bucketTime = 0;
+        d->bucketDebt = 0;
+        d->delayed = 0;
+        d->rejected = 0;
+    }
+
+    emit usageChanged();
+}
+
+QuotaTrackerPrivate::QuotaTrackerPrivate(QuotaTracker *parent) :
+    q_ptr(parent),
+    admissionPolicy(QuotaTracker::NoAdmissionControl),
+    dailyBudget(0),
+    rateLimit(0),
+    day(quotaDay()),
+    dailyUsage(0),
+    bucketTime(0),
+    bucketDebt(0),
+    delayed(0),
+    rejected(0)
+{
+}
+
+QuotaTrackerPrivate::~QuotaTrackerPrivate() {}
+
+QDate QuotaTrackerPrivate::quotaDay() {
+    // The quota is reset at midnight Pacific Time. Daylight saving time is ignored.
+    return QDateTime::currentDateTimeUtc().addSecs(-8 * 3600).date();
+}
+
+void QuotaTrackerPrivate::rollOver() {
+    const QDate today = quotaDay();
+
+    if (today != day) {
+        day = today;
+        dailyUsage = 0;
+        keyUsage.clear();
+    }
+}
+
+void QuotaTrackerPrivate::expireCharges(qint64 now) {
+    while ((!charges.isEmpty()) && (charges.first().first <= now - RATE_WINDOW)) {
+        charges.removeFirst();
+    }
+}
+
+double QuotaTrackerPrivate::bucketLevel(qint64 time) const {
+    // The bucket starts full, and bucketDebt is the number of units below full at bucketTime.
+    const double refilled = double(qMax(Q_INT64_C(0), time - bucketTime)) * rateLimit / RATE_WINDOW;
+    return rateLimit - qMax(0.0, bucketDebt - refilled);
+}
+
+qint64 QuotaTrackerPrivate::scheduleCharge(qint64 now, int units) {
+    // Delayed requests are admitted in the order in which they were made.
+    qint64 time = qMax(now, bucketTime);
+    double level = bucketLevel(time);
+    const int required = qMin(units, rateLimit);
+
+    if (level < required) {
+        time += qint64(ceil((required - level) * RATE_WINDOW / rateLimit));
+        level = required;
+    }
+
+    bucketTime = time;
+    bucketDebt = rateLimit - level + units;
+
+    return time;
+}
+
+}
+
+#include "moc_quotatracker.cpp"
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_QUOTATRACKER_H
+#define QYOUTUBE_QUOTATRACKER_H
+
+#include "request.h"
+#include <QStringList>
+
+namespace QYouTube {
+
+class QuotaTrackerPrivate;
+
+class QYOUTUBESHARED_EXPORT QuotaTracker : public QObject
+{
+    Q_OBJECT
+
+    Q_PROPERTY(AdmissionPolicy admissionPolicy READ admissionPolicy WRITE setAdmissionPolicy
+               NOTIFY admissionPolicyChanged)
+    Q_PROPERTY(int dailyBudget READ dailyBudget WRITE setDailyBudget NOTIFY dailyBudgetChanged)
+    Q_PROPERTY(int rateLimit READ rateLimit WRITE setRateLimit NOTIFY rateLimitChanged)
+    Q_PROPERTY(qint64 dailyUsage READ dailyUsage NOTIFY usageChanged)
+    Q_PROPERTY(int currentRate READ currentRate NOTIFY usageChanged)
+    Q_PROPERTY(qint64 delayedCount READ delayedCount NOTIFY usageChanged)
+    Q_PROPERTY(qint64 rejectedCount READ rejectedCount NOTIFY usageChanged)
+
+    Q_ENUMS(AdmissionPolicy)
+
+public:
+    enum AdmissionPolicy {
+        NoAdmissionControl = 0,
+        DelayRequests,
+        RejectRequests
+    };
+
+    explicit QuotaTracker(QObject *parent = 0);
+    ~QuotaTracker();
+
+    AdmissionPolicy admissionPolicy() const;
+    void setAdmissionPolicy(AdmissionPolicy policy);
+
+    int dailyBudget() const;
+    void setDailyBudget(int units);
+
+    int rateLimit() const;
+    void setRateLimit(int unitsPerMinute);
+
+    qint64 dailyUsage() const;
+    Q_INVOKABLE qint64 dailyUsage(const QString &key) const;
+    Q_INVOKABLE QStringList keys() const;
+
+    int currentRate() const;
+
+    qint64 delayedCount() const;
+    qint64 rejectedCount() const;
+
+    virtual int cost(Request::Operation operation, const QString &resourcePath) const;
+
+    int admit(const QString &key, Request::Operation operation, const QString &resourcePath);
+
+public Q_SLOTS:
+    void reset();
+
+Q_SIGNALS:
+    void admissionPolicyChanged();
+    void dailyBudgetChanged();
+    void rateLimitChanged();
+    void usageChanged();
+
+protected:
+    QuotaTracker(QuotaTrackerPrivate &dd, QObject *parent = 0);
+
+    QScopedPointer<QuotaTrackerPrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(QuotaTracker)
+
+private:
+    Q_DISABLE_COPY(QuotaTracker)
+};
+
+}
+
+#endif // QYOUTUBE_QUOTATRACKER_H
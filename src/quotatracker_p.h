@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_QUOTATRACKER_P_H
+#define QYOUTUBE_QUOTATRACKER_P_H
+
+#include "quotatracker.h"
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+
+namespace QYouTube {
+
+// The time in milliseconds since the epoch at which units were, or will be, used.
+typedef QPair<qint64, int> QuotaCharge;
+
+class QuotaTrackerPrivate
+{
+
+public:
+    QuotaTrackerPrivate(QuotaTracker *parent);
+    virtual ~QuotaTrackerPrivate();
+
+    static QDate quotaDay();
+
+    void rollOver();
+    void expireCharges(qint64 now);
+
+    double bucketLevel(qint64 time) const;
+    qint64 scheduleCharge(qint64 now, int units);
+
+    QuotaTracker *q_ptr;
+
+    mutable QMutex mutex;
+
+    QuotaTracker::AdmissionPolicy admissionPolicy;
+
+    int dailyBudget;
+    int rateLimit;
+
+    QDate day;
+
+    qint64 dailyUsage;
+
+    QHash<QString, qint64> keyUsage;
+
+    QList<QuotaCharge> charges;
+
+    qint64 bucketTime;
+    double bucketDebt;
+
+    qint64 delayed;
+    qint64 rejected;
+
+    Q_DECLARE_PUBLIC(QuotaTracker)
+};
+
+}
+
+#endif // QYOUTUBE_QUOTATRACKER_P_H
@@ -15,13 +15,38 @@
  */
 
 #include "request_p.h"
+#include "inflightrequests_p.h"
+#include "networkaccessmanagerpool_p.h"
+#include "quotatracker.h"
+#include "responsecache.h"
+#include "retrypolicy.h"
+#include "tokenmanager.h"
 #include "urls.h"
+#include <QMutexLocker>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QDebug>
 
 namespace QYouTube {
 
+class RequestDefaults
+{
+
+public:
+    RequestDefaults() :
+        timeout(0),
+        inactivityTimeout(0)
+    {
+    }
+    
+    QMutex mutex;
+    
+    int timeout;
+    int inactivityTimeout;
+};
+
+Q_GLOBAL_STATIC(RequestDefaults, requestDefaults)
+
 /*!
     \class Request
     \brief The base class for making requests to the YouTube Data API.
@@ -35,12 +60,16 @@ Request::Request(QObject *parent) :
     QObject(parent),
     d_ptr(new RequestPrivate(this))
 {
+    connect(TokenManager::instance(), SIGNAL(accessTokenRefreshed(QString, QString, QVariant, int, QString)),
+            this, SLOT(_q_onAccessTokenRefreshed(QString, QString, QVariant, int, QString)));
 }
 
 Request::Request(RequestPrivate &dd, QObject *parent) :
     QObject(parent),
     d_ptr(&dd)
 {
+    connect(TokenManager::instance(), SIGNAL(accessTokenRefreshed(QString, QString, QVariant, int, QString)),
+            this, SLOT(_q_onAccessTokenRefreshed(QString, QString, QVariant, int, QString)));
 }
 
 Request::~Request() {
@@ -50,6 +79,17 @@ Request::~Request() {
         delete d->reply;
         d->reply = 0;
     }
+    
+    d->detachFlight();
+    
+    qDeleteAll(d->operationReplies.keys());
+    d->operationReplies.clear();
+    
+    foreach (InFlightReply *flight, d->operationFlights.keys()) {
+        flight->release();
+    }
+    
+    d->operationFlights.clear();
 }
 
 /*!
@@ -374,13 +414,41 @@ Request::Status Request::status() const {
 /*!
     \property QVariant Request::result
     \brief The result of the last HTTP request.
+    
+    If lazyResult is true, the result is converted from resultValue() when it is first read.
 */
 QVariant Request::result() const {
     Q_D(const Request);
     
+    if ((!d->result.isValid()) && (!d->resultValue.isUndefined())) {
+        d->result = d->resultValue.toVariant();
+    }
+    
     return d->result;
 }
 
+/*!
+    \brief Returns the result of the last HTTP request as a lazily parsed JSON value.
+    
+    The value is only available if lazyResult is true, otherwise it is undefined. Values are parsed from the raw 
+    response when they are accessed, so reading a few fields of each item is much cheaper than using result():
+    
+    \code
+    const QtJson::JsonValue items = request->resultValue().value("items");
+    
+    for (int i = 0; i < items.count(); i++) {
+        qDebug() << items.at(i).query("snippet.title").toString();
+    }
+    \endcode
+    
+    \sa lazyResult
+*/
+QtJson::JsonValue Request::resultValue() const {
+    Q_D(const Request);
+    
+    return d->resultValue;
+}
+
 /*!
     \enum Request::Error
     \brief The error resulting from the last HTTP request.
@@ -502,6 +570,10 @@ QVariant Request::result() const {
             <td>ParseError</td>
             <td>There was an error in parsing the server response.</td>
         </tr>
+        <tr>
+            <td>QuotaExceededError</td>
+            <td>The request was rejected by the QuotaTracker because it would exceed the quota budget or rate.</td>
+        </tr>
     </table>
 */
 
@@ -531,17 +603,14 @@ QString Request::errorString() const {
     
     Request does not take ownership of \a manager.
     
-    If no QNetworkAccessManager is set, one will be created 
-    when required.    
+    If no QNetworkAccessManager is set, the manager shared by 
+    all requests in the current thread is used.
+    
+    \sa NetworkAccessManagerPool
 */
 void Request::setNetworkAccessManager(QNetworkAccessManager *manager) {
     Q_D(Request);
     
-    if ((d->manager) && (d->ownNetworkAccessManager)) {
-        delete d->manager;
-    }
-    
-    d->ownNetworkAccessManager = false;
     d->manager = manager;
 #ifdef QYOUTUBE_DEBUG
     qDebug() << "QYouTube::Request::setNetworkAccessManager" << manager;
@@ -549,486 +618,1873 @@ void Request::setNetworkAccessManager(QNetworkAccessManager *manager) {
 }
 
 /*!
-    \brief Performs a HTTP HEAD request.
+    \brief Returns the ResponseCache used to store the results of HTTP GET requests.
+    
+    \sa setResponseCache()
 */
-void Request::head(bool authRequired) {
-    Q_D(Request);
+ResponseCache* Request::responseCache() const {
+    Q_D(const Request);
     
-    if (d->url.isEmpty()) {
-        qDebug() << "QYouTube::Request::head(): URL is empty";
-        return;
-    }
+    return d->responseCache;
+}
+
+/*!
+    \brief Sets the ResponseCache used to store the results of HTTP GET requests to \a cache.
     
-    d->redirects = 0;
-    d->setOperation(HeadOperation);
-    d->setStatus(Loading);
+    When a cache is set, the ETag of any cached result is sent with each HTTP GET request, and if the YouTube Data API 
+    responds with 304 Not Modified, the cached result is used instead of downloading the response again.
     
-    if (d->reply) {
-        delete d->reply;
-    }
+    Request does not take ownership of \a cache, and the same cache can be shared between any number of requests.
+    
+    The response cache is supported by Request and ResourcesRequest.
+    
+    By default, no cache is used.
+    
+    \sa ResponseCache
+*/
+void Request::setResponseCache(ResponseCache *cache) {
+    Q_D(Request);
+    
+    d->responseCache = cache;
 #ifdef QYOUTUBE_DEBUG
-    qDebug() << "QYouTube::Request::head" << d->url;
+    qDebug() << "QYouTube::Request::setResponseCache" << cache;
 #endif
-    d->reply = d->networkAccessManager()->head(d->buildRequest(authRequired));
-    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
 }
 
 /*!
-    \brief Performs a HTTP GET request.
+    \brief Returns the RetryPolicy used to retry failed HTTP requests.
+    
+    \sa setRetryPolicy()
 */
-void Request::get(bool authRequired) {
-    Q_D(Request);
+RetryPolicy* Request::retryPolicy() const {
+    Q_D(const Request);
     
-    if (d->url.isEmpty()) {
-        qDebug() << "QYouTube::Request::get(): URL is empty";
-        return;
-    }
+    return d->retryPolicy;
+}
+
+/*!
+    \brief Sets the RetryPolicy used to retry failed HTTP requests to \a policy.
     
-    d->redirects = 0;
-    d->setOperation(GetOperation);
-    d->setStatus(Loading);
+    When a policy is set, HTTP requests that fail with a transient error are repeated after a delay determined by 
+    \a policy, and the retrying() signal is emitted before each retry. The status remains Loading until the request 
+    succeeds, fails with an error that cannot be retried, or the maximum number of retries is reached.
     
-    if (d->reply) {
-        delete d->reply;
-    }
+    Request does not take ownership of \a policy, and the same policy can be shared between any number of requests.
+    
+    Retries are supported by Request and ResourcesRequest.
+    
+    By default, no policy is used, and failed requests are not retried.
+    
+    \sa RetryPolicy
+*/
+void Request::setRetryPolicy(RetryPolicy *policy) {
+    Q_D(Request);
+    
+    d->retryPolicy = policy;
 #ifdef QYOUTUBE_DEBUG
-    qDebug() << "QYouTube::Request::get" << d->url;
+    qDebug() << "QYouTube::Request::setRetryPolicy" << policy;
 #endif
-    d->reply = d->networkAccessManager()->get(d->buildRequest(authRequired));
-    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
 }
 
 /*!
-    \brief Performs a HTTP POST request.
+    \brief Returns the QuotaTracker used to account for the quota used by requests.
+    
+    \sa setQuotaTracker()
 */
-void Request::post(bool authRequired) {
-    Q_D(Request);
+QuotaTracker* Request::quotaTracker() const {
+    Q_D(const Request);
     
-    if (d->url.isEmpty()) {
-        qDebug() << "QYouTube::Request::post(): URL is empty";
-        return;
-    }
+    return d->quotaTracker;
+}
+
+/*!
+    \brief Sets the QuotaTracker used to account for the quota used by requests to \a tracker.
     
-    d->redirects = 0;
-    d->setOperation(PostOperation);
+    When a tracker is set, the quota cost of each call is charged to \a tracker before the HTTP request is made. If 
+    the tracker delays the call, status is Loading until the HTTP request is made and completed. If the tracker 
+    rejects the call, the request fails with QuotaExceededError.
     
-    if (d->reply) {
-        delete d->reply;
-    }
+    Request does not take ownership of \a tracker, and the same tracker can be shared between any number of requests.
     
-    bool ok = true;
-    QByteArray data;
+    The quota tracker is supported by ResourcesRequest.
     
-    switch (d->data.type()) {
-    case QVariant::String:
-    case QVariant::ByteArray:
-    case QVariant::Invalid:
-        data = d->data.toString().toUtf8();
-        break;
-    default:
-        data = QtJson::Json::serialize(d->data, ok);
-        break;
-    }
+    By default, no tracker is used.
+    
+    \sa QuotaTracker
+*/
+void Request::setQuotaTracker(QuotaTracker *tracker) {
+    Q_D(Request);
+    
+    d->quotaTracker = tracker;
 #ifdef QYOUTUBE_DEBUG
-    qDebug() << "QYouTube::Request::post" << d->url << data;
+    qDebug() << "QYouTube::Request::setQuotaTracker" << tracker;
 #endif
-    if (ok) {
-        d->setStatus(Loading);        
-        d->reply = d->networkAccessManager()->post(d->buildRequest(authRequired), data);
-        connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
-    }
-    else {
-        d->setStatus(Failed);
-        d->setError(ParseError);
-        d->setErrorString(tr("Unable to serialize the POST data"));
-        emit finished();
-    }    
 }
 
 /*!
-    \brief Performs a HTTP PUT request.
+    \fn void Request::retrying(int id, int retry, int delay)
+    \brief Emitted when a failed HTTP request will be retried after \a delay milliseconds.
+    
+    \a id is the id of the operation if concurrent is true, otherwise 0. \a retry is the number of the retry, 
+    starting from 1.
+    
+    \sa setRetryPolicy()
 */
-void Request::put(bool authRequired) {
-    Q_D(Request);
+
+/*!
+    \property bool Request::concurrent
+    \brief Whether the request can perform multiple operations concurrently.
     
-    if (d->url.isEmpty()) {
-        qDebug() << "QYouTube::Request::put(): URL is empty";
-        return;
-    }
+    By default, each new HTTP request replaces any request that is in progress, and only the result of the last 
+    request is available.
     
-    d->redirects = 0;
-    d->setOperation(PutOperation);
+    When concurrent is true, each HTTP request is performed as a separate operation. The methods that start an 
+    operation return an id that can be used to retrieve the status and result of the operation using 
+    operationStatus(), operationResult(), operationError() and operationErrorString(). The operationFinished() signal 
+    is emitted with the id of each operation when it is completed, and the finished() signal is not emitted.
     
-    if (d->reply) {
-        delete d->reply;
-    }
+    While any operation is in progress, status is Loading. Otherwise, status is the status of the last completed 
+    operation.
     
-    bool ok = true;
-    QByteArray data;
+    The results of completed operations are kept until they are released using releaseOperation(), or the request is 
+    deleted.
     
-    switch (d->data.type()) {
-    case QVariant::String:
-    case QVariant::ByteArray:
-    case QVariant::Invalid:
-        data = d->data.toString().toUtf8();
-        break;
-    default:
-        data = QtJson::Json::serialize(d->data, ok);
-        break;
-    }
-#ifdef QYOUTUBE_DEBUG
-    qDebug() << "QYouTube::Request::put" << d->url << data;
-#endif
-    if (ok) {
-        d->setStatus(Loading);        
-        d->reply = d->networkAccessManager()->put(d->buildRequest(authRequired), data);
-        connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
-    }
-    else {
-        d->setStatus(Failed);
-        d->setError(ParseError);
-        d->setErrorString(tr("Unable to serialize the PUT data"));
-        emit finished();
-    }    
-}
+    Concurrent operations are supported by Request and ResourcesRequest.
+    
+    The default value is false.
+*/
 
 /*!
-    \brief Performs a HTTP DELETE request.
+    \fn void Request::concurrentChanged()
+    \brief Emitted when concurrent changes.
 */
-void Request::deleteResource(bool authRequired) {
-    Q_D(Request);
-    
-    if (d->url.isEmpty()) {
-        qDebug() << "QYouTube::Request::deleteResource(): URL is empty";
-        return;
-    }
+bool Request::isConcurrent() const {
+    Q_D(const Request);
     
-    d->redirects = 0;
-    d->setOperation(DeleteOperation);
-    d->setStatus(Loading);
+    return d->concurrent;
+}
+
+void Request::setConcurrent(bool enabled) {
+    Q_D(Request);
     
-    if (d->reply) {
-        delete d->reply;
+    if (enabled != d->concurrent) {
+        d->concurrent = enabled;
+        emit concurrentChanged();
     }
 #ifdef QYOUTUBE_DEBUG
-    qDebug() << "QYouTube::Request::deleteResource" << d->url;
+    qDebug() << "QYouTube::Request::setConcurrent" << enabled;
 #endif
-    d->reply = d->networkAccessManager()->deleteResource(d->buildRequest(authRequired));
-    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
 }
 
 /*!
-    \brief Cancels the current HTTP request.
+    \property bool Request::lazyResult
+    \brief Whether responses are kept as raw JSON and parsed only when they are accessed.
+    
+    By default, each response is parsed into a QVariant as it is downloaded. When lazyResult is true, the response is 
+    instead checked and indexed, and is available using resultValue() or operationResultValue(). Values are only 
+    parsed when they are accessed, which typically uses an order of magnitude less memory and time when only a few 
+    fields are needed. result() and operationResult() are still available, and convert the whole response when first 
+    read.
+    
+    Error responses are always parsed.
+    
+    The default value is false.
+    
+    \sa resultValue()
 */
-void Request::cancel() {
-    Q_D(Request);
+
+/*!
+    \fn void Request::lazyResultChanged()
+    \brief Emitted when lazyResult changes.
+*/
+bool Request::lazyResult() const {
+    Q_D(const Request);
     
-    if (d->reply) {
-        d->reply->abort();
-    }
+    return d->lazyResult;
 }
 
-RequestPrivate::RequestPrivate(Request *parent) :
-    q_ptr(parent),
-    manager(0),
-    reply(0),
-    ownNetworkAccessManager(false),
-    operation(Request::UnknownOperation),
-    status(Request::Null),
-    error(Request::NoError),
-    redirects(0)
-{
+void Request::setLazyResult(bool enabled) {
+    Q_D(Request);
+    
+    if (enabled != d->lazyResult) {
+        d->lazyResult = enabled;
+        emit lazyResultChanged();
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::Request::setLazyResult" << enabled;
+#endif
 }
 
-RequestPrivate::~RequestPrivate() {}
+/*!
+    \property int Request::timeout
+    \brief The maximum time in milliseconds that a HTTP request can take.
+    
+    If a HTTP request is not completed within the timeout, it is aborted and the request fails with TimeoutError. 
+    A value of 0 means that there is no limit.
+    
+    The timeout applies to each HTTP request made, including those made to follow a redirect or to retry a failed 
+    request.
+    
+    The default value is defaultTimeout() at the time the request is created.
+*/
 
-QNetworkAccessManager* RequestPrivate::networkAccessManager() {    
-    if (!manager) {
-        Q_Q(Request);
-        ownNetworkAccessManager = true;
-        manager = new QNetworkAccessManager(q);
-    }
+/*!
+    \fn void Request::timeoutChanged()
+    \brief Emitted when the timeout changes.
+*/
+int Request::timeout() const {
+    Q_D(const Request);
     
-    return manager;
+    return d->timeout;
 }
 
-void RequestPrivate::setOperation(Request::Operation op) {
-    if (op != operation) {
-        Q_Q(Request);
-        operation = op;
-        emit q->operationChanged();
+void Request::setTimeout(int msecs) {
+    Q_D(Request);
+    
+    msecs = qMax(0, msecs);
+    
+    if (msecs != d->timeout) {
+        d->timeout = msecs;
+        emit timeoutChanged();
     }
 #ifdef QYOUTUBE_DEBUG
-    qDebug() << "QYouTube::RequestPrivate::setOperation" << Request::Operation(op);
+    qDebug() << "QYouTube::Request::setTimeout" << msecs;
 #endif
 }
 
-void RequestPrivate::setStatus(Request::Status s) {
-    if (s != status) {
-        Q_Q(Request);
-        status = s;
-        emit q->statusChanged(s);
-    }
-#ifdef QYOUTUBE_DEBUG
-    qDebug() << "QYouTube::RequestPrivate::setStatus" << Request::Status(s);
-#endif
-}
+/*!
+    \property int Request::inactivityTimeout
+    \brief The maximum time in milliseconds that a HTTP request can wait without sending or receiving any data.
+    
+    If no data is transferred within the timeout, the HTTP request is aborted and the request fails with 
+    TimeoutError. A value of 0 means that there is no limit.
+    
+    The default value is defaultInactivityTimeout() at the time the request is created.
+*/
 
-void RequestPrivate::setError(Request::Error e) {
-    error = e;
-#ifdef QYOUTUBE_DEBUG
-    qDebug() << "QYouTube::RequestPrivate::setError" << Request::Error(e);
-#endif
+/*!
+    \fn void Request::inactivityTimeoutChanged()
+    \brief Emitted when the inactivityTimeout changes.
+*/
+int Request::inactivityTimeout() const {
+    Q_D(const Request);
+    
+    return d->inactivityTimeout;
 }
 
-void RequestPrivate::setErrorString(const QString &es) {
-    errorString = es;
+void Request::setInactivityTimeout(int msecs) {
+    Q_D(Request);
+    
+    msecs = qMax(0, msecs);
+    
+    if (msecs != d->inactivityTimeout) {
+        d->inactivityTimeout = msecs;
+        emit inactivityTimeoutChanged();
+    }
 #ifdef QYOUTUBE_DEBUG
-    qDebug() << "QYouTube::RequestPrivate::setErrorString" << es;
+    qDebug() << "QYouTube::Request::setInactivityTimeout" << msecs;
 #endif
 }
 
-void RequestPrivate::setResult(const QVariant &res) {
+/*!
+    \brief Returns the timeout used by new requests.
+    
+    The default value is 0 (no limit).
+    
+    \sa timeout
+*/
+int Request::defaultTimeout() {
+    QMutexLocker locker(&requestDefaults()->mutex);
+    
+    return requestDefaults()->timeout;
+}
+
+/*!
+    \brief Sets the timeout used by new requests to \a msecs.
+    
+    \sa timeout
+*/
+void Request::setDefaultTimeout(int msecs) {
+    QMutexLocker locker(&requestDefaults()->mutex);
+    
+    requestDefaults()->timeout = qMax(0, msecs);
+}
+
+/*!
+    \brief Returns the inactivity timeout used by new requests.
+    
+    The default value is 0 (no limit).
+    
+    \sa inactivityTimeout
+*/
+int Request::defaultInactivityTimeout() {
+    QMutexLocker locker(&requestDefaults()->mutex);
+    
+    return requestDefaults()->inactivityTimeout;
+}
+
+/*!
+    \brief Sets the inactivity timeout used by new requests to \a msecs.
+    
+    \sa inactivityTimeout
+*/
+void Request::setDefaultInactivityTimeout(int msecs) {
+    QMutexLocker locker(&requestDefaults()->mutex);
+    
+    requestDefaults()->inactivityTimeout = qMax(0, msecs);
+}
+
+/*!
+    \fn void Request::operationFinished(int id)
+    \brief Emitted when the operation identified by \a id is completed.
+    
+    \sa concurrent
+*/
+
+/*!
+    \brief Returns the status of the operation identified by \a id.
+    
+    \sa concurrent
+*/
+Request::Status Request::operationStatus(int id) const {
+    Q_D(const Request);
+    
+    return d->operations.value(id).status;
+}
+
+/*!
+    \brief Returns the result of the operation identified by \a id.
+    
+    \sa concurrent
+*/
+QVariant Request::operationResult(int id) const {
+    Q_D(const Request);
+    
+    QHash<int, RequestOperation>::const_iterator iterator = d->operations.constFind(id);
+    
+    if (iterator == d->operations.constEnd()) {
+        return QVariant();
+    }
+    
+    if ((!iterator->result.isValid()) && (!iterator->resultValue.isUndefined())) {
+        iterator->result = iterator->resultValue.toVariant();
+    }
+    
+    return iterator->result;
+}
+
+/*!
+    \brief Returns the result of the operation identified by \a id as a lazily parsed JSON value.
+    
+    \sa resultValue(), concurrent
+*/
+QtJson::JsonValue Request::operationResultValue(int id) const {
+    Q_D(const Request);
+    
+    return d->operations.value(id).resultValue;
+}
+
+/*!
+    \brief Returns the error resulting from the operation identified by \a id.
+    
+    \sa concurrent
+*/
+Request::Error Request::operationError(int id) const {
+    Q_D(const Request);
+    
+    return d->operations.value(id).error;
+}
+
+/*!
+    \brief Returns a description of the error resulting from the operation identified by \a id.
+    
+    \sa concurrent
+*/
+QString Request::operationErrorString(int id) const {
+    Q_D(const Request);
+    
+    return d->operations.value(id).errorString;
+}
+
+/*!
+    \brief Performs a HTTP HEAD request.
+    
+    Returns the id of the operation if concurrent is true, otherwise 0.
+*/
+int Request::head(bool authRequired) {
+    Q_D(Request);
+    
+    if (d->url.isEmpty()) {
+        qDebug() << "QYouTube::Request::head(): URL is empty";
+        return 0;
+    }
+    
+    if (d->concurrent) {
+        return d->startOperation(HeadOperation, authRequired);
+    }
+    
+    d->redirects = 0;
+    d->retries = 0;
+    d->resourcePath = QString();
+    d->setOperation(HeadOperation);
+    d->setStatus(Loading);
+    
+    d->detachFlight();
+    
+    if (d->reply) {
+        delete d->reply;
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::Request::head" << d->url;
+#endif
+    d->reply = d->watchReply(d->networkAccessManager()->head(d->buildRequest(authRequired)));
+    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+    return 0;
+}
+
+/*!
+    \brief Performs a HTTP GET request.
+    
+    Returns the id of the operation if concurrent is true, otherwise 0.
+*/
+int Request::get(bool authRequired) {
+    Q_D(Request);
+    
+    if (d->url.isEmpty()) {
+        qDebug() << "QYouTube::Request::get(): URL is empty";
+        return 0;
+    }
+    
+    if (d->concurrent) {
+        return d->startOperation(GetOperation, authRequired);
+    }
+    
+    d->redirects = 0;
+    d->retries = 0;
+    d->resourcePath = QString();
+    d->setOperation(GetOperation);
+    d->setStatus(Loading);
+    
+    d->detachFlight();
+    
+    if (d->reply) {
+        delete d->reply;
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::Request::get" << d->url;
+#endif
+    QNetworkRequest request = d->buildRequest(authRequired);
+    
+    if (d->conditional) {
+        d->addConditionalHeaders(&request, d->url);
+    }
+    
+    d->conditional = true;
+    
+    if (d->shareReplies) {
+        d->reply = 0;
+        d->flight = InFlightReply::get(d->networkAccessManager(), request, d->timeout, d->inactivityTimeout,
+                                       d->lazyResult, d->responseCache != 0);
+        connect(d->flight, SIGNAL(finished()), this, SLOT(_q_onFlightFinished()));
+    }
+    else {
+        d->reply = d->watchReply(d->networkAccessManager()->get(request));
+        connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+    }
+    
+    return 0;
+}
+
+/*!
+    \brief Performs a HTTP POST request.
+    
+    Returns the id of the operation if concurrent is true, otherwise 0.
+*/
+int Request::post(bool authRequired) {
+    Q_D(Request);
+    
+    if (d->url.isEmpty()) {
+        qDebug() << "QYouTube::Request::post(): URL is empty";
+        return 0;
+    }
+    
+    if (d->concurrent) {
+        return d->startOperation(PostOperation, authRequired);
+    }
+    
+    d->redirects = 0;
+    d->retries = 0;
+    d->resourcePath = QString();
+    d->setOperation(PostOperation);
+    
+    d->detachFlight();
+    
+    if (d->reply) {
+        delete d->reply;
+    }
+    
+    bool ok = true;
+    const QByteArray data = d->serializeData(ok);
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::Request::post" << d->url << data;
+#endif
+    if (ok) {
+        d->setStatus(Loading);        
+        d->reply = d->watchReply(d->networkAccessManager()->post(d->buildRequest(authRequired), data));
+        connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+    }
+    else {
+        d->setStatus(Failed);
+        d->setError(ParseError);
+        d->setErrorString(tr("Unable to serialize the POST data"));
+        emit finished();
+    }
+    
+    return 0;
+}
+
+/*!
+    \brief Performs a HTTP PUT request.
+    
+    Returns the id of the operation if concurrent is true, otherwise 0.
+*/
+int Request::put(bool authRequired) {
+    Q_D(Request);
+    
+    if (d->url.isEmpty()) {
+        qDebug() << "QYouTube::Request::put(): URL is empty";
+        return 0;
+    }
+    
+    if (d->concurrent) {
+        return d->startOperation(PutOperation, authRequired);
+    }
+    
+    d->redirects = 0;
+    d->retries = 0;
+    d->resourcePath = QString();
+    d->setOperation(PutOperation);
+    
+    d->detachFlight();
+    
+    if (d->reply) {
+        delete d->reply;
+    }
+    
+    bool ok = true;
+    const QByteArray data = d->serializeData(ok);
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::Request::put" << d->url << data;
+#endif
+    if (ok) {
+        d->setStatus(Loading);        
+        d->reply = d->watchReply(d->networkAccessManager()->put(d->buildRequest(authRequired), data));
+        connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+    }
+    else {
+        d->setStatus(Failed);
+        d->setError(ParseError);
+        d->setErrorString(tr("Unable to serialize the PUT data"));
+        emit finished();
+    }
+    
+    return 0;
+}
+
+/*!
+    \brief Performs a HTTP DELETE request.
+    
+    Returns the id of the operation if concurrent is true, otherwise 0.
+*/
+int Request::deleteResource(bool authRequired) {
+    Q_D(Request);
+    
+    if (d->url.isEmpty()) {
+        qDebug() << "QYouTube::Request::deleteResource(): URL is empty";
+        return 0;
+    }
+    
+    if (d->concurrent) {
+        return d->startOperation(DeleteOperation, authRequired);
+    }
+    
+    d->redirects = 0;
+    d->retries = 0;
+    d->resourcePath = QString();
+    d->setOperation(DeleteOperation);
+    d->setStatus(Loading);
+    
+    d->detachFlight();
+    
+    if (d->reply) {
+        delete d->reply;
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::Request::deleteResource" << d->url;
+#endif
+    d->reply = d->watchReply(d->networkAccessManager()->deleteResource(d->buildRequest(authRequired)));
+    connect(d->reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+    return 0;
+}
+
+/*!
+    \brief Cancels the current HTTP request.
+    
+    If concurrent is true, all operations in progress are canceled.
+*/
+void Request::cancel() {
+    Q_D(Request);
+    
+    if (d->reply) {
+        d->reply->abort();
+    }
+    else if (d->flight) {
+        d->detachFlight();
+        d->setStatus(Canceled);
+        d->setError(NoError);
+        d->setErrorString(QString());
+        emit finished();
+    }
+    else if ((d->refreshingAccessToken) || ((d->retryTimer) && (d->retryTimer->isActive()))) {
+        d->refreshingAccessToken = false;
+        
+        if (d->retryTimer) {
+            d->retryTimer->stop();
+        }
+        
+        d->setStatus(Canceled);
+        d->setError(NoError);
+        d->setErrorString(QString());
+        emit finished();
+    }
+    
+    foreach (const int id, d->operations.keys()) {
+        cancelOperation(id);
+    }
+}
+
+/*!
+    \brief Cancels the operation identified by \a id.
+    
+    \sa concurrent
+*/
+void Request::cancelOperation(int id) {
+    Q_D(Request);
+    
+    d->cancelOperation(id);
+}
+
+/*!
+    \brief Releases the status and result of the operation identified by \a id.
+    
+    If the operation is in progress, it is canceled without emitting operationFinished().
+    
+    \sa concurrent
+*/
+void Request::releaseOperation(int id) {
+    Q_D(Request);
+    
+    if (!d->operations.contains(id)) {
+        return;
+    }
+    
+    const RequestOperation o = d->operations.take(id);
+    d->finishedOperations.removeAll(id);
+    
+    if (o.status == Loading) {
+        d->activeOperations--;
+        d->tokenQueue.removeOne(id);
+        
+        if (o.reply) {
+            d->operationReplies.remove(o.reply);
+            o.reply->disconnect(this);
+            o.reply->abort();
+            o.reply->deleteLater();
+        }
+        else if (o.flight) {
+            RequestOperation released = o;
+            d->detachOperationFlight(released);
+        }
+        else if (o.retryTimer) {
+            RequestOperation released = o;
+            d->clearOperationRetry(released);
+        }
+        
+        if (d->activeOperations == 0) {
+            d->setStatus(Canceled);
+        }
+    }
+}
+
+ReplyTimeout::ReplyTimeout(QNetworkReply *r, int timeout, int inactivityTimeout) :
+    QObject(r),
+    reply(r),
+    deadlineTimer(0),
+    inactivityTimer(0)
+{
+    if (timeout > 0) {
+        deadlineTimer = new QTimer(this);
+        deadlineTimer->setSingleShot(true);
+        deadlineTimer->setInterval(timeout);
+        connect(deadlineTimer, SIGNAL(timeout()), this, SLOT(_q_onTimeout()));
+    }
+    
+    if (inactivityTimeout > 0) {
+        inactivityTimer = new QTimer(this);
+        inactivityTimer->setSingleShot(true);
+        inactivityTimer->setInterval(inactivityTimeout);
+        connect(inactivityTimer, SIGNAL(timeout()), this, SLOT(_q_onTimeout()));
+        connect(reply, SIGNAL(downloadProgress(qint64, qint64)), this, SLOT(_q_onProgress()));
+        connect(reply, SIGNAL(uploadProgress(qint64, qint64)), this, SLOT(_q_onProgress()));
+    }
+    
+    connect(reply, SIGNAL(finished()), this, SLOT(_q_onFinished()));
+    
+    // A reply queued by the per-host connection limit is not timed until it is sent.
+    PendingNetworkReply *pending = qobject_cast<PendingNetworkReply*>(reply);
+    
+    if ((pending) && (!pending->isStarted())) {
+        connect(pending, SIGNAL(started()), this, SLOT(_q_onStarted()));
+    }
+    else {
+        _q_onStarted();
+    }
+}
+
+void ReplyTimeout::watch(QNetworkReply *reply, int timeout, int inactivityTimeout) {
+    if ((reply) && ((timeout > 0) || (inactivityTimeout > 0))) {
+        new ReplyTimeout(reply, timeout, inactivityTimeout);
+    }
+}
+
+bool ReplyTimeout::isTimedOut(QNetworkReply *reply) {
+    return reply->property("qyoutube_timedOut").toBool();
+}
+
+void ReplyTimeout::_q_onStarted() {
+    if (deadlineTimer) {
+        deadlineTimer->start();
+    }
+    
+    if (inactivityTimer) {
+        inactivityTimer->start();
+    }
+}
+
+void ReplyTimeout::_q_onProgress() {
+    if ((inactivityTimer) && (inactivityTimer->isActive())) {
+        inactivityTimer->start();
+    }
+}
+
+void ReplyTimeout::_q_onTimeout() {
+    if (reply->isFinished()) {
+        return;
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::ReplyTimeout::_q_onTimeout" << reply->url();
+#endif
+    reply->setProperty("qyoutube_timedOut", true);
+    reply->abort();
+}
+
+void ReplyTimeout::_q_onFinished() {
+    if (deadlineTimer) {
+        deadlineTimer->stop();
+    }
+    
+    if (inactivityTimer) {
+        inactivityTimer->stop();
+    }
+}
+
+ReplyParser::ReplyParser(QNetworkReply *r, bool keep) :
+    QObject(r),
+    reply(r),
+    keepData(keep)
+{
+    connect(reply, SIGNAL(readyRead()), this, SLOT(_q_onReadyRead()));
+}
+
+void ReplyParser::watch(QNetworkReply *reply, bool keepData) {
+    if ((reply) && (!parser(reply))) {
+        new ReplyParser(reply, keepData);
+    }
+}
+
+ReplyParser* ReplyParser::parser(QNetworkReply *reply) {
+    return reply->findChild<ReplyParser*>();
+}
+
+QVariant ReplyParser::result(bool &ok) {
+    _q_onReadyRead();
+    
+    if (stream.bytesFed() == 0) {
+        ok = true;
+        return QVariant(QString());
+    }
+    
+    return stream.finish(ok);
+}
+
+QByteArray ReplyParser::takeData() {
+    QByteArray data;
+    qSwap(data, response);
+    return data;
+}
+
+void ReplyParser::_q_onReadyRead() {
+    // Invalid data is still read, so that the reply does not buffer the rest of the response.
+    const QByteArray data = reply->readAll();
+    
+    if (keepData) {
+        response.append(data);
+    }
+    
+    if (!stream.hasError()) {
+        stream.feed(data);
+    }
+}
+
+ReplyResult ReplyResult::fromReply(QNetworkReply *reply) {
+    ReplyResult r;
+    QUrl redirect = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+    
+    if (redirect.isEmpty()) {
+        redirect = reply->header(QNetworkRequest::LocationHeader).toUrl();
+    }
+    
+    if (!redirect.isEmpty()) {
+        r.redirect = reply->url().resolved(redirect);
+    }
+    
+    r.statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    r.etag = reply->rawHeader("ETag");
+    r.error = replyError(reply);
+    r.errorString = replyErrorString(reply);
+    
+    if (r.statusCode != 304) {
+        if (ReplyParser *parser = ReplyParser::parser(reply)) {
+            r.result = parser->result(r.ok);
+            r.data = parser->takeData();
+        }
+        else {
+            r.data = reply->readAll();
+            
+            // Error responses are parsed even for lazy replies, so that the reason for the error can be checked.
+            if ((isLazyReply(reply)) && (r.error == QNetworkReply::NoError) && (!r.data.isEmpty())) {
+                r.document = QtJson::JsonDocument::fromJson(r.data, r.ok);
+            }
+            else {
+                r.result = r.data.isEmpty() ? QVariant(QString()) : QtJson::Json::parse(r.data, r.ok);
+            }
+        }
+    }
+    
+    return r;
+}
+
+RequestPrivate::RequestPrivate(Request *parent) :
+    q_ptr(parent),
+    manager(0),
+    responseCache(0),
+    retryPolicy(0),
+    quotaTracker(0),
+    retryTimer(0),
+    reply(0),
+    flight(0),
+    shareReplies(true),
+    parseIncrementally(true),
+    lazyResult(false),
+    conditional(true),
+    operation(Request::UnknownOperation),
+    status(Request::Null),
+    error(Request::NoError),
+    redirects(0),
+    retries(0),
+    quotaCharged(false),
+    timeout(Request::defaultTimeout()),
+    inactivityTimeout(Request::defaultInactivityTimeout()),
+    concurrent(false),
+    lastOperationId(0),
+    activeOperations(0),
+    refreshingAccessToken(false)
+{
+}
+
+RequestPrivate::~RequestPrivate() {}
+
+QNetworkAccessManager* RequestPrivate::networkAccessManager() {    
+    return manager ? manager : NetworkAccessManagerPool::networkAccessManager();
+}
+
+void RequestPrivate::setOperation(Request::Operation op) {
+    if (op != operation) {
+        Q_Q(Request);
+        operation = op;
+        emit q->operationChanged();
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::RequestPrivate::setOperation" << Request::Operation(op);
+#endif
+}
+
+void RequestPrivate::setStatus(Request::Status s) {
+    if (s != status) {
+        Q_Q(Request);
+        status = s;
+        emit q->statusChanged(s);
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::RequestPrivate::setStatus" << Request::Status(s);
+#endif
+}
+
+void RequestPrivate::setError(Request::Error e) {
+    error = e;
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::RequestPrivate::setError" << Request::Error(e);
+#endif
+}
+
+void RequestPrivate::setErrorString(const QString &es) {
+    errorString = es;
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::RequestPrivate::setErrorString" << es;
+#endif
+}
+
+void RequestPrivate::setResult(const QVariant &res) {
     result = res;
+    resultValue = QtJson::JsonValue();
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::RequestPrivate::setResult" << res;
+#endif
+}
+
+void RequestPrivate::setResultValue(const QtJson::JsonValue &value) {
+    result = QVariant();
+    resultValue = value;
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::RequestPrivate::setResultValue" << value.type();
+#endif
+}
+
+QUrl RequestPrivate::authenticatedUrl(QUrl u) const {
+#if QT_VERSION >= 0x050000
+    QUrlQuery query(u);
+    
+    if ((!query.hasQueryItem("key")) && (!apiKey.isEmpty())) {
+        query.addQueryItem("key", apiKey);
+    }
+    
+    if ((!query.hasQueryItem("access_token")) && (!accessToken.isEmpty())) {
+        query.addQueryItem("access_token", accessToken);
+    }
+    
+    u.setQuery(query);
+#else
+    if ((!u.hasQueryItem("key")) && (!apiKey.isEmpty())) {
+        u.addQueryItem("key", apiKey);
+    }
+    
+    if ((!u.hasQueryItem("access_token")) && (!accessToken.isEmpty())) {
+        u.addQueryItem("access_token", accessToken);
+    }
+#endif
+    return u;
+}
+
+QByteArray RequestPrivate::contentType() const {
+    switch (operation) {
+    case Request::PostOperation:
+    case Request::PutOperation:
+        switch (data.type()) {
+        case QVariant::Map:
+        case QVariant::List:
+        case QVariant::StringList:
+            return "application/json";
+        default:
+            return "application/x-www-form-urlencoded";
+        }
+    default:
+        return QByteArray();
+    }
+}
+
+QByteArray RequestPrivate::serializeData(bool &ok) const {
+    ok = true;
+    
+    switch (data.type()) {
+    case QVariant::String:
+    case QVariant::ByteArray:
+    case QVariant::Invalid:
+        return data.toString().toUtf8();
+    default:
+        return QtJson::Json::serialize(data, ok);
+    }
+}
+
+void RequestPrivate::addConditionalHeaders(QNetworkRequest *request, const QUrl &u) const {
+    if (!responseCache) {
+        return;
+    }
+    
+    const QByteArray etag = responseCache->etag(u);
+    
+    if (!etag.isEmpty()) {
+        request->setRawHeader("If-None-Match", etag);
+    }
+}
+
+QNetworkRequest RequestPrivate::buildRequest(bool authRequired) {
+    return buildRequest(url, authRequired);
+}
+
+QNetworkRequest RequestPrivate::buildRequest(QUrl u, bool authRequired) {
+    if (authRequired) {
+        u = authenticatedUrl(u);
+    }
 #ifdef QYOUTUBE_DEBUG
-    qDebug() << "QYouTube::RequestPrivate::setResult" << res;
+    qDebug() << "QYouTube::RequestPrivate::buildRequest" << u;
+#endif
+    QNetworkRequest request(u);
+    const QByteArray type = contentType();
+    
+    if (!type.isEmpty()) {
+        request.setHeader(QNetworkRequest::ContentTypeHeader, type);
+    }
+    
+    if (!headers.isEmpty()) {
+        addRequestHeaders(&request, headers);
+    }
+    
+    return request;
+}
+
+QNetworkReply* RequestPrivate::sendRequest(Request::Operation op, const QNetworkRequest &request,
+                                           const QByteArray &body) {
+    switch (op) {
+    case Request::HeadOperation:
+        return watchReply(networkAccessManager()->head(request));
+    case Request::PostOperation:
+        return watchReply(networkAccessManager()->post(request, body));
+    case Request::PutOperation:
+        return watchReply(networkAccessManager()->put(request, body));
+    case Request::DeleteOperation:
+        return watchReply(networkAccessManager()->deleteResource(request));
+    default:
+        return watchReply(networkAccessManager()->get(request));
+    }
+}
+
+QNetworkReply* RequestPrivate::watchReply(QNetworkReply *r) const {
+    ReplyTimeout::watch(r, timeout, inactivityTimeout);
+    
+    if (lazyResult) {
+        setLazyReply(r);
+    }
+    else if (parseIncrementally) {
+        // The raw response is only kept if it will be cached.
+        ReplyParser::watch(r, (responseCache) && (r->operation() == QNetworkAccessManager::GetOperation));
+    }
+    
+    return r;
+}
+
+/*!
+    \internal
+    \brief Retrieves the cached result for \a u.
+    
+    If lazyResult is true, the raw response is used if it is cached, and \a value is set instead of \a res.
+*/
+bool RequestPrivate::findCachedResult(const QUrl &u, QVariant &res, QtJson::JsonValue &value) {
+    value = QtJson::JsonValue();
+    
+    if (lazyResult) {
+        QByteArray json;
+        
+        if (responseCache->findResponse(u, json)) {
+            bool ok;
+            const QtJson::JsonDocument document = QtJson::JsonDocument::fromJson(json, ok);
+            
+            if (ok) {
+                value = document.root();
+                return true;
+            }
+        }
+    }
+    
+    return responseCache->find(u, res);
+}
+
+void RequestPrivate::followRedirect(const QUrl &redirect) {
+    Q_Q(Request);
+    
+    redirects++;
+    
+    if (reply) {
+        delete reply;
+    }
+        
+    reply = watchReply(networkAccessManager()->get(buildRequest(redirect)));
+    Request::connect(reply, SIGNAL(finished()), q, SLOT(_q_onReplyFinished()));
+}
+
+void RequestPrivate::refreshAccessToken() {
+    if (reply) {
+        delete reply;
+        reply = 0;
+    }
+    
+    refreshingAccessToken = true;
+    TokenManager::instance()->refreshAccessToken(clientId, clientSecret, refreshToken, networkAccessManager());
+}
+
+void RequestPrivate::accessTokenRefreshed(const QVariant &response, Request::Error e, const QString &es) {
+    Q_Q(Request);
+    
+    setResult(response);
+    
+    switch (e) {
+    case Request::NoError:
+        break;
+    case Request::OperationCanceledError:
+        setStatus(Request::Canceled);
+        setError(Request::NoError);
+        setErrorString(QString());
+        emit q->finished();
+        return;
+    default:
+        setStatus(Request::Failed);
+        setError(e);
+        setErrorString(es);
+        emit q->finished();
+        return;
+    }
+    
+    replayOperation(operation);
+}
+
+void RequestPrivate::_q_onAccessTokenRefreshed(const QString &id, const QString &token, const QVariant &response,
+                                               int e, const QString &es) {
+    if ((id != clientId) || (token != refreshToken)) {
+        return;
+    }
+    
+    Q_Q(Request);
+    
+    // Every request using the same credentials receives the new access token, not only those that were waiting.
+    if (e == Request::NoError) {
+        q->setAccessToken(response.toMap().value("access_token").toString());
+    }
+    
+    if (refreshingAccessToken) {
+        refreshingAccessToken = false;
+        accessTokenRefreshed(response, Request::Error(e), es);
+    }
+    
+    if (tokenQueue.isEmpty()) {
+        return;
+    }
+    
+    const QList<int> ids = tokenQueue;
+    tokenQueue.clear();
+    
+    foreach (const int i, ids) {
+        if (!operations.contains(i)) {
+            continue;
+        }
+        
+        switch (e) {
+        case Request::NoError:
+            {
+                RequestOperation &o = operations[i];
+                o.redirects = 0;
+                sendOperation(o, o.url);
+            }
+            
+            break;
+        case Request::OperationCanceledError:
+            finishOperation(i, Request::Canceled);
+            break;
+        default:
+            finishOperation(i, Request::Failed, Request::Error(e), es);
+            break;
+        }
+    }
+}
+
+void RequestPrivate::_q_onReplyFinished() {
+    if (!reply) {
+        return;
+    }
+    
+    const ReplyResult r = ReplyResult::fromReply(reply);
+    reply->deleteLater();
+    reply = 0;
+    handleReplyResult(r);
+}
+
+void RequestPrivate::handleReplyResult(const ReplyResult &r) {
+    Q_Q(Request);
+    
+    if ((redirects < MAX_REDIRECTS) && (!r.redirect.isEmpty())) {
+        followRedirect(r.redirect);
+        return;
+    }
+    
+    if ((responseCache) && (r.statusCode == 304)) {
+        QVariant cached;
+        QtJson::JsonValue cachedValue;
+        
+        if (findCachedResult(url, cached, cachedValue)) {
+            if (cachedValue.isUndefined()) {
+                setResult(cached);
+            }
+            else {
+                setResultValue(cachedValue);
+            }
+            
+            setStatus(Request::Ready);
+            setError(Request::NoError);
+            setErrorString(QString());
+            emit q->finished();
+        }
+        else {
+            // The cached result has been removed since the request was sent, or cannot be read, so request the
+            // full response without If-None-Match. Otherwise a cache that still reports the ETag would cause
+            // another 304 response.
+            responseCache->remove(url);
+            conditional = false;
+            q->get();
+        }
+        
+        return;
+    }
+    
+    if (shouldRetry(operation, retries, r)) {
+        scheduleRetry();
+        return;
+    }
+    
+    if (r.document.isNull()) {
+        setResult(r.result);
+    }
+    else {
+        setResultValue(r.document.root());
+    }
+    
+    switch (r.error) {
+    case QNetworkReply::NoError:
+        break;
+    case QNetworkReply::OperationCanceledError:
+        setStatus(Request::Canceled);
+        setError(Request::NoError);
+        setErrorString(QString());
+        emit q->finished();
+        return;
+    case QNetworkReply::AuthenticationRequiredError:
+        if (refreshToken.isEmpty()) {
+            setStatus(Request::Failed);
+            setError(Request::Error(r.error));
+            setErrorString(r.errorString);
+            emit q->finished();
+        }
+        else {
+            refreshAccessToken();
+        }
+        
+        return;
+    default:
+        setStatus(Request::Failed);
+        setError(Request::Error(r.error));
+        setErrorString(r.errorString);
+        emit q->finished();
+        return;
+    }
+    
+    if (r.ok) {
+        if ((responseCache) && (operation == Request::GetOperation) && (!r.etag.isEmpty())) {
+            responseCache->insertResponse(url, r.etag, result, r.data);
+        }
+        
+        setStatus(Request::Ready);
+        setError(Request::NoError);
+        setErrorString(QString());
+    }
+    else {
+        setStatus(Request::Failed);
+        setError(Request::ParseError);
+        setErrorString(Request::tr("Unable to parse response"));
+    }
+        
+    emit q->finished();
+}
+
+bool RequestPrivate::shouldRetry(Request::Operation op, int attempts, const ReplyResult &r) const {
+    if ((!retryPolicy) || (r.error == QNetworkReply::NoError) || (r.error == QNetworkReply::OperationCanceledError)) {
+        return false;
+    }
+    
+    if (!retryPolicy->isRetryable(op, r.statusCode, Request::Error(r.error), r.result)) {
+        return false;
+    }
+    
+    if (attempts >= retryPolicy->maximumRetries()) {
+        retryPolicy->recordExhausted();
+        return false;
+    }
+    
+    return true;
+}
+
+int RequestPrivate::replayOperation(Request::Operation op) {
+    Q_Q(Request);
+    
+    switch (op) {
+    case Request::HeadOperation:
+        return q->head();
+    case Request::GetOperation:
+        return q->get();
+    case Request::PostOperation:
+        return q->post();
+    case Request::PutOperation:
+        return q->put();
+    case Request::DeleteOperation:
+        return q->deleteResource();
+    default:
+        return 0;
+    }
+}
+
+void RequestPrivate::scheduleRetry() {
+    Q_Q(Request);
+    
+    const int delay = retryPolicy->retryDelay(retries);
+    retries++;
+    quotaCharged = false;
+    retryPolicy->recordRetry();
+    startRetryTimer(delay);
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::RequestPrivate::scheduleRetry" << url << retries << delay;
 #endif
+    emit q->retrying(0, retries, delay);
+}
+
+void RequestPrivate::startRetryTimer(int delay) {
+    if (!retryTimer) {
+        Q_Q(Request);
+        retryTimer = new QTimer(q);
+        retryTimer->setSingleShot(true);
+        Request::connect(retryTimer, SIGNAL(timeout()), q, SLOT(_q_retry()));
+    }
+    
+    retryTimer->start(delay);
+}
+
+void RequestPrivate::_q_retry() {
+    // A new request has been made since the retry was scheduled.
+    if ((reply) || (flight) || (status != Request::Loading)) {
+        return;
+    }
+    
+    // Retries are charged when they are due, unless they have already been charged and delayed, or share a reply.
+    if ((!quotaCharged) && (!sharesReply(operation))) {
+        const int delay = chargeQuota(operation, resourcePath);
+        
+        if (delay > 0) {
+            quotaCharged = true;
+            startRetryTimer(delay);
+            return;
+        }
+        
+        if (delay < 0) {
+            Q_Q(Request);
+            setStatus(Request::Failed);
+            setError(Request::QuotaExceededError);
+            setErrorString(Request::tr("Quota budget exceeded"));
+            emit q->finished();
+            return;
+        }
+    }
+    
+    // The retry count and resource path are reset when the request is replayed, so they are restored afterwards.
+    const int attempts = retries;
+    const QString path = resourcePath;
+    quotaCharged = false;
+    replayOperation(operation);
+    retries = attempts;
+    resourcePath = path;
 }
 
-QNetworkRequest RequestPrivate::buildRequest(bool authRequired) {
-    return buildRequest(url, authRequired);
+void RequestPrivate::detachFlight() {
+    if (flight) {
+        Q_Q(Request);
+        Request::disconnect(flight, SIGNAL(finished()), q, SLOT(_q_onFlightFinished()));
+        flight->release();
+        flight = 0;
+    }
 }
 
-QNetworkRequest RequestPrivate::buildRequest(QUrl u, bool authRequired) {
-    if (authRequired) {
-#if QT_VERSION >= 0x050000
-        QUrlQuery query(u);
+void RequestPrivate::_q_onFlightFinished() {
+    if (!flight) {
+        return;
+    }
     
-        if ((!query.hasQueryItem("key")) && (!apiKey.isEmpty())) {
-            query.addQueryItem("key", apiKey);
-        }
+    const ReplyResult r = flight->result();
+    flight = 0;
+    handleReplyResult(r);
+}
+
+/*!
+    \internal
+    \brief Returns true if a GET request of the url would share a reply that is already in flight.
     
-        if ((!query.hasQueryItem("access_token")) && (!accessToken.isEmpty())) {
-            query.addQueryItem("access_token", accessToken);
-        }
+    A shared reply makes no call to the API, so it is not charged to the QuotaTracker. Any reply of a previous 
+    request is released first, as it would be when the request is sent.
+*/
+bool RequestPrivate::sharesReply(Request::Operation op) {
+    if ((op != Request::GetOperation) || (!shareReplies) || (!quotaTracker)) {
+        return false;
+    }
     
-        u.setQuery(query);
-#else
-        if ((!u.hasQueryItem("key")) && (!apiKey.isEmpty())) {
-            u.addQueryItem("key", apiKey);
-        }
+    if (concurrent) {
+        RequestOperation o;
+        o.operation = op;
+        o.url = url;
+        o.headers = headers;
+        o.contentType = contentType();
+        return sharesReply(o);
+    }
+    
+    detachFlight();
+    QNetworkRequest request = buildRequest();
+    
+    if (conditional) {
+        addConditionalHeaders(&request, url);
+    }
+    
+    return InFlightReply::isInFlight(networkAccessManager(), request, lazyResult, responseCache != 0);
+}
+
+/*!
+    \internal
+    \brief Returns true if the operation \a o would share a reply that is already in flight.
+*/
+bool RequestPrivate::sharesReply(const RequestOperation &o) {
+    if ((o.operation != Request::GetOperation) || (!shareReplies) || (!quotaTracker)) {
+        return false;
+    }
     
-        if ((!u.hasQueryItem("access_token")) && (!accessToken.isEmpty())) {
-            u.addQueryItem("access_token", accessToken);
+    return InFlightReply::isInFlight(networkAccessManager(), buildOperationRequest(o, o.url), lazyResult,
+                                     responseCache != 0);
+}
+
+int RequestPrivate::chargeQuota(Request::Operation op, const QString &path) {
+    if ((!quotaTracker) || (path.isEmpty())) {
+        return 0;
+    }
+    
+    return quotaTracker->admit(apiKey.isEmpty() ? clientId : apiKey, op, path);
+}
+
+int RequestPrivate::admitRequest(Request::Operation op, const QString &path) {
+    const int delay = sharesReply(op) ? 0 : chargeQuota(op, path);
+    
+    if ((delay == 0) || (concurrent)) {
+        const int id = delay == 0 ? replayOperation(op) : startOperation(op, true, delay);
+        
+        if (concurrent) {
+            if (operations.contains(id)) {
+                operations[id].resourcePath = path;
+                operations[id].quotaCharged = (delay > 0);
+            }
+        }
+        else {
+            resourcePath = path;
         }
+        
+        return id;
+    }
+    
+    Q_Q(Request);
+    
+    redirects = 0;
+    retries = 0;
+    resourcePath = path;
+    quotaCharged = true;
+    setOperation(op);
+    detachFlight();
+    
+    if (reply) {
+        delete reply;
+        reply = 0;
+    }
+    
+    if (delay > 0) {
+#ifdef QYOUTUBE_DEBUG
+        qDebug() << "QYouTube::RequestPrivate::admitRequest: Request delayed" << url << delay;
 #endif
+        setStatus(Request::Loading);
+        startRetryTimer(delay);
+    }
+    else {
+        setStatus(Request::Failed);
+        setError(Request::QuotaExceededError);
+        setErrorString(Request::tr("Quota budget exceeded"));
+        emit q->finished();
+    }
+    
+    return 0;
+}
+
+int RequestPrivate::startOperation(Request::Operation op, bool authRequired, int delay) {
+    Q_Q(Request);
+    
+    setOperation(op);
+    
+    RequestOperation o;
+    o.id = ++lastOperationId;
+    o.operation = op;
+    o.status = Request::Loading;
+    o.url = url;
+    o.headers = headers;
+    o.contentType = contentType();
+    o.authRequired = authRequired;
+    
+    bool ok = true;
+    
+    if ((op == Request::PostOperation) || (op == Request::PutOperation)) {
+        o.body = serializeData(ok);
     }
 #ifdef QYOUTUBE_DEBUG
-    qDebug() << "QYouTube::RequestPrivate::buildRequest" << u;
+    qDebug() << "QYouTube::RequestPrivate::startOperation" << o.id << Request::Operation(op) << o.url << o.body;
 #endif
-    QNetworkRequest request(u);
+    operations.insert(o.id, o);
+    activeOperations++;
+    setStatus(Request::Loading);
     
-    switch (operation) {
-    case Request::PostOperation:
-    case Request::PutOperation:
-        switch (data.type()) {
-        case QVariant::Map:
-        case QVariant::List:
-        case QVariant::StringList:
-            request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-            break;
-        default:
-            request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
-            break;
+    if ((ok) && (delay == 0)) {
+        sendOperation(operations[o.id], o.url);
+    }
+    else if ((ok) && (delay > 0)) {
+        startOperationRetryTimer(operations[o.id], delay);
+    }
+    else {
+        // The operation id has not yet been returned to the caller, so operationFinished() is emitted later.
+        RequestOperation &failed = operations[o.id];
+        failed.status = Request::Failed;
+        
+        if (ok) {
+            failed.error = Request::QuotaExceededError;
+            failed.errorString = Request::tr("Quota budget exceeded");
+        }
+        else {
+            failed.error = Request::ParseError;
+            failed.errorString = Request::tr("Unable to serialize the request data");
         }
         
-        break;
-    default:
-        break;
+        activeOperations--;
+        setStatus(activeOperations > 0 ? Request::Loading : Request::Failed);
+        finishedOperations << o.id;
+        QMetaObject::invokeMethod(q, "_q_emitOperationsFinished", Qt::QueuedConnection);
     }
     
-    if (!headers.isEmpty()) {
-        addRequestHeaders(&request, headers);
+    return o.id;
+}
+
+QNetworkRequest RequestPrivate::buildOperationRequest(const RequestOperation &o, const QUrl &u) {
+    QNetworkRequest request(o.authRequired ? authenticatedUrl(u) : u);
+    
+    if (!o.contentType.isEmpty()) {
+        request.setHeader(QNetworkRequest::ContentTypeHeader, o.contentType);
+    }
+    
+    if (!o.headers.isEmpty()) {
+        addRequestHeaders(&request, o.headers);
+    }
+    
+    if ((o.operation == Request::GetOperation) && (o.redirects == 0) && (o.conditional)) {
+        addConditionalHeaders(&request, o.url);
     }
     
     return request;
 }
 
-void RequestPrivate::followRedirect(const QUrl &redirect) {
+void RequestPrivate::sendOperation(RequestOperation &o, const QUrl &u) {
     Q_Q(Request);
     
-    redirects++;
+    const QNetworkRequest request = buildOperationRequest(o, u);
+    const Request::Operation op = o.redirects > 0 ? Request::GetOperation : o.operation;
     
-    if (reply) {
-        delete reply;
+    if ((shareReplies) && (op == Request::GetOperation)) {
+        o.flight = InFlightReply::get(networkAccessManager(), request, timeout, inactivityTimeout, lazyResult,
+                                      responseCache != 0);
+        operationFlights.insert(o.flight, o.id);
+        Request::connect(o.flight, SIGNAL(finished()), q, SLOT(_q_onOperationFlightFinished()), Qt::UniqueConnection);
+    }
+    else {
+        o.reply = sendRequest(op, request, o.body);
+        operationReplies.insert(o.reply, o.id);
+        Request::connect(o.reply, SIGNAL(finished()), q, SLOT(_q_onOperationReplyFinished()));
     }
-        
-    reply = networkAccessManager()->get(buildRequest(redirect));
-    Request::connect(reply, SIGNAL(finished()), q, SLOT(_q_onReplyFinished()));
 }
 
-void RequestPrivate::refreshAccessToken() {
-    Q_Q(Request);
-    
-    QNetworkRequest request(TOKEN_URL);
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
-    const QByteArray body("client_id=" + clientId.toUtf8() +
-                          "&client_secret=" + clientSecret.toUtf8() +
-                          "&refresh_token=" + refreshToken.toUtf8() +
-                          "&grant_type=refresh_token");
-                    
-    if (reply) {
-        delete reply;
+void RequestPrivate::cancelOperation(int id) {
+    if (!operations.contains(id)) {
+        return;
     }
     
-    reply = networkAccessManager()->post(request, body);
-    Request::connect(reply, SIGNAL(finished()), q, SLOT(_q_onAccessTokenRefreshed()));
+    RequestOperation &o = operations[id];
+    
+    if (o.reply) {
+        o.reply->abort();
+    }
+    else if (o.flight) {
+        detachOperationFlight(o);
+        finishOperation(id, Request::Canceled);
+    }
+    else if (o.retryTimer) {
+        clearOperationRetry(o);
+        finishOperation(id, Request::Canceled);
+    }
+    else if (tokenQueue.removeOne(id)) {
+        finishOperation(id, Request::Canceled);
+    }
 }
 
-void RequestPrivate::_q_onAccessTokenRefreshed() {
-    if (!reply) {
+void RequestPrivate::finishOperation(int id, Request::Status s, Request::Error e, const QString &es) {
+    if (!operations.contains(id)) {
         return;
     }
     
+    RequestOperation &o = operations[id];
+    o.status = s;
+    o.error = e;
+    o.errorString = es;
+    activeOperations--;
+    setStatus(activeOperations > 0 ? Request::Loading : s);
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::RequestPrivate::finishOperation" << id << Request::Status(s) << Request::Error(e) << es;
+#endif
+    operationFinished(id);
+}
+
+void RequestPrivate::operationFinished(int id) {
     Q_Q(Request);
+    
+    emit q->operationFinished(id);
+}
+
+void RequestPrivate::refreshOperationsAccessToken() {
+    TokenManager::instance()->refreshAccessToken(clientId, clientSecret, refreshToken, networkAccessManager());
+}
+
+void RequestPrivate::handleOperationReplyResult(int id, const ReplyResult &r) {
+    if (!operations.contains(id)) {
+        return;
+    }
+    
+    RequestOperation &o = operations[id];
+    
+    if ((o.redirects < MAX_REDIRECTS) && (!r.redirect.isEmpty())) {
+        o.redirects++;
+        sendOperation(o, r.redirect);
+        return;
+    }
+    
+    if ((responseCache) && (r.statusCode == 304)) {
+        if (findCachedResult(o.url, o.result, o.resultValue)) {
+            finishOperation(id, Request::Ready);
+        }
+        else {
+            responseCache->remove(o.url);
+            o.redirects = 0;
+            o.conditional = false;
+            sendOperation(o, o.url);
+        }
         
-    bool ok;
-    setResult(QtJson::Json::parse(reply->readAll(), ok));
+        return;
+    }
     
-    const QNetworkReply::NetworkError e = reply->error();
-    const QString es = reply->errorString();
-    reply->deleteLater();
-    reply = 0;
+    if (shouldRetry(o.operation, o.retries, r)) {
+        scheduleOperationRetry(o);
+        return;
+    }
     
-    switch (e) {
+    o.result = r.result;
+    o.resultValue = r.document.isNull() ? QtJson::JsonValue() : r.document.root();
+    
+    switch (r.error) {
     case QNetworkReply::NoError:
         break;
     case QNetworkReply::OperationCanceledError:
-        setStatus(Request::Canceled);
-        setError(Request::NoError);
-        setErrorString(QString());
-        emit q->finished();
+        finishOperation(id, Request::Canceled);
+        return;
+    case QNetworkReply::AuthenticationRequiredError:
+        if ((!refreshToken.isEmpty()) && (!o.accessTokenRefreshed)) {
+            o.accessTokenRefreshed = true;
+            tokenQueue << id;
+            refreshOperationsAccessToken();
+            return;
+        }
+        
+        finishOperation(id, Request::Failed, Request::Error(r.error), r.errorString);
         return;
     default:
-        setStatus(Request::Failed);
-        setError(Request::Error(e));
-        setErrorString(es);
-        emit q->finished();
+        finishOperation(id, Request::Failed, Request::Error(r.error), r.errorString);
         return;
     }
-        
-    if (ok) {
-        const QString token = result.toMap().value("access_token").toString();
-        
-        if (token.isEmpty()) {
-            setStatus(Request::Failed);
-            setError(Request::ContentAccessDenied);
-            setErrorString(Request::tr("Unable to refresh access token"));
-            emit q->finished();
-        }
-        else {
-            q->setAccessToken(token);
-            
-            switch (operation) {
-            case Request::GetOperation:
-                q->get();
-                break;
-            case Request::PostOperation:
-                q->post();
-                break;
-            case Request::PutOperation:
-                q->put();
-                break;
-            case Request::DeleteOperation:
-                q->deleteResource();
-                break;
-            default:
-                break;
-            }
+    
+    if (r.ok) {
+        if ((responseCache) && (o.operation == Request::GetOperation) && (!r.etag.isEmpty())) {
+            responseCache->insertResponse(o.url, r.etag, o.result, r.data);
         }
+        
+        finishOperation(id, Request::Ready);
     }
     else {
-        setStatus(Request::Failed);
-        setError(Request::ParseError);
-        setErrorString(Request::tr("Unable to parse response"));
-        emit q->finished();
+        finishOperation(id, Request::Failed, Request::ParseError, Request::tr("Unable to parse response"));
     }
 }
 
-void RequestPrivate::_q_onReplyFinished() {
-    if (!reply) {
+void RequestPrivate::detachOperationFlight(RequestOperation &o) {
+    if (!o.flight) {
         return;
     }
     
+    operationFlights.remove(o.flight, o.id);
+    
+    if (!operationFlights.contains(o.flight)) {
+        Q_Q(Request);
+        Request::disconnect(o.flight, SIGNAL(finished()), q, SLOT(_q_onOperationFlightFinished()));
+    }
+    
+    o.flight->release();
+    o.flight = 0;
+}
+
+void RequestPrivate::scheduleOperationRetry(RequestOperation &o) {
     Q_Q(Request);
     
-    if (redirects < MAX_REDIRECTS) {
-        QUrl redirect = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toString();
+    const int delay = retryPolicy->retryDelay(o.retries);
+    o.retries++;
+    o.quotaCharged = false;
+    retryPolicy->recordRetry();
+    startOperationRetryTimer(o, delay);
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::RequestPrivate::scheduleOperationRetry" << o.id << o.url << o.retries << delay;
+#endif
+    emit q->retrying(o.id, o.retries, delay);
+}
+
+void RequestPrivate::startOperationRetryTimer(RequestOperation &o, int delay) {
+    Q_Q(Request);
     
-        if (redirect.isEmpty()) {
-            redirect = reply->header(QNetworkRequest::LocationHeader).toString();
-        }
+    o.retryTimer = new QTimer(q);
+    o.retryTimer->setSingleShot(true);
+    operationRetryTimers.insert(o.retryTimer, o.id);
+    Request::connect(o.retryTimer, SIGNAL(timeout()), q, SLOT(_q_onOperationRetryTimeout()));
+    o.retryTimer->start(delay);
+}
+
+void RequestPrivate::clearOperationRetry(RequestOperation &o) {
+    if (!o.retryTimer) {
+        return;
+    }
     
-        if (!redirect.isEmpty()) {
-            reply->deleteLater();
-            reply = 0;
-            followRedirect(redirect);
-            return;
-        }
+    operationRetryTimers.remove(o.retryTimer);
+    o.retryTimer->deleteLater();
+    o.retryTimer = 0;
+}
+
+void RequestPrivate::_q_onOperationReplyFinished() {
+    Q_Q(Request);
+    
+    QNetworkReply *r = qobject_cast<QNetworkReply*>(q->sender());
+    
+    if ((!r) || (!operationReplies.contains(r))) {
+        return;
     }
     
-    bool ok = true;
-    const QString response = QString::fromUtf8(reply->readAll());
-    setResult(response.isEmpty() ? response : QtJson::Json::parse(response, ok));
+    const int id = operationReplies.take(r);
+    operations[id].reply = 0;
+    r->deleteLater();
+    handleOperationReplyResult(id, ReplyResult::fromReply(r));
+}
+
+void RequestPrivate::_q_onOperationFlightFinished() {
+    Q_Q(Request);
     
-    const QNetworkReply::NetworkError e = reply->error();
-    const QString es = reply->errorString();
-    reply->deleteLater();
-    reply = 0;
+    InFlightReply *f = qobject_cast<InFlightReply*>(q->sender());
     
-    switch (e) {
-    case QNetworkReply::NoError:
-        break;
-    case QNetworkReply::OperationCanceledError:
-        setStatus(Request::Canceled);
-        setError(Request::NoError);
-        setErrorString(QString());
-        emit q->finished();
+    if ((!f) || (!operationFlights.contains(f))) {
         return;
-    case QNetworkReply::AuthenticationRequiredError:
-        if (refreshToken.isEmpty()) {
-            setStatus(Request::Failed);
-            setError(Request::Error(e));
-            setErrorString(es);
-            emit q->finished();
-        }
-        else {
-            refreshAccessToken();
+    }
+    
+    const ReplyResult r = f->result();
+    const QList<int> ids = operationFlights.values(f);
+    operationFlights.remove(f);
+    
+    foreach (const int id, ids) {
+        if (operations.contains(id)) {
+            operations[id].flight = 0;
+            handleOperationReplyResult(id, r);
         }
-        
-        return;
-    default:
-        setStatus(Request::Failed);
-        setError(Request::Error(e));
-        setErrorString(es);
-        emit q->finished();
+    }
+}
+
+void RequestPrivate::_q_onOperationRetryTimeout() {
+    Q_Q(Request);
+    
+    QTimer *timer = qobject_cast<QTimer*>(q->sender());
+    
+    if ((!timer) || (!operationRetryTimers.contains(timer))) {
         return;
     }
     
-    if (ok) {
-        setStatus(Request::Ready);
-        setError(Request::NoError);
-        setErrorString(QString());
+    const int id = operationRetryTimers.take(timer);
+    timer->deleteLater();
+    
+    if (operations.contains(id)) {
+        RequestOperation &o = operations[id];
+        o.retryTimer = 0;
+        
+        // Retries are charged when they are due, unless they have already been charged and delayed, or share a reply.
+        o.redirects = 0;
+        
+        if ((!o.quotaCharged) && (!sharesReply(o))) {
+            const int delay = chargeQuota(o.operation, o.resourcePath);
+            
+            if (delay > 0) {
+                o.quotaCharged = true;
+                startOperationRetryTimer(o, delay);
+                return;
+            }
+            
+            if (delay < 0) {
+                finishOperation(id, Request::Failed, Request::QuotaExceededError,
+                                Request::tr("Quota budget exceeded"));
+                return;
+            }
+        }
+        
+        o.quotaCharged = false;
+        sendOperation(o, o.url);
     }
-    else {
-        setStatus(Request::Failed);
-        setError(Request::ParseError);
-        setErrorString(Request::tr("Unable to parse response"));
+}
+
+void RequestPrivate::_q_emitOperationsFinished() {
+    const QList<int> ids = finishedOperations;
+    finishedOperations.clear();
+    
+    foreach (const int id, ids) {
+        operationFinished(id);
     }
-        
-    emit q->finished();
 }
 
 }
 
 #include "moc_request.cpp"
+#include "moc_request_p.cpp"
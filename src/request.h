@@ -25,9 +25,16 @@ class QUrl;
 class QString;
 class QNetworkAccessManager;
 
+namespace QtJson {
+    class JsonValue;
+}
+
 namespace QYouTube {
 
 class RequestPrivate;
+class QuotaTracker;
+class ResponseCache;
+class RetryPolicy;
 
 class QYOUTUBESHARED_EXPORT Request : public QObject
 {
@@ -46,6 +53,10 @@ class QYOUTUBESHARED_EXPORT Request : public QObject
     Q_PROPERTY(QVariant result READ result NOTIFY finished)
     Q_PROPERTY(Error error READ error NOTIFY finished)
     Q_PROPERTY(QString errorString READ errorString NOTIFY finished)
+    Q_PROPERTY(bool concurrent READ isConcurrent WRITE setConcurrent NOTIFY concurrentChanged)
+    Q_PROPERTY(bool lazyResult READ lazyResult WRITE setLazyResult NOTIFY lazyResultChanged)
+    Q_PROPERTY(int timeout READ timeout WRITE setTimeout NOTIFY timeoutChanged)
+    Q_PROPERTY(int inactivityTimeout READ inactivityTimeout WRITE setInactivityTimeout NOTIFY inactivityTimeoutChanged)
     
     Q_ENUMS(Operation Status Error)
     
@@ -103,7 +114,10 @@ public:
         ProtocolFailure = 399,
         
         // Json parser error
-        ParseError = 401
+        ParseError = 401,
+        
+        // Quota tracker error
+        QuotaExceededError = 402
     };
     
     explicit Request(QObject *parent = 0);
@@ -135,14 +149,50 @@ public:
     Status status() const;
     
     QVariant result() const;
+    QtJson::JsonValue resultValue() const;
     
     Error error() const;
     QString errorString() const;
     
     void setNetworkAccessManager(QNetworkAccessManager *manager);
     
+    ResponseCache* responseCache() const;
+    void setResponseCache(ResponseCache *cache);
+    
+    RetryPolicy* retryPolicy() const;
+    void setRetryPolicy(RetryPolicy *policy);
+    
+    QuotaTracker* quotaTracker() const;
+    void setQuotaTracker(QuotaTracker *tracker);
+    
+    bool isConcurrent() const;
+    void setConcurrent(bool enabled);
+    
+    bool lazyResult() const;
+    void setLazyResult(bool enabled);
+    
+    int timeout() const;
+    void setTimeout(int msecs);
+    
+    int inactivityTimeout() const;
+    void setInactivityTimeout(int msecs);
+    
+    static int defaultTimeout();
+    static void setDefaultTimeout(int msecs);
+    
+    static int defaultInactivityTimeout();
+    static void setDefaultInactivityTimeout(int msecs);
+    
+    Q_INVOKABLE Status operationStatus(int id) const;
+    Q_INVOKABLE QVariant operationResult(int id) const;
+    QtJson::JsonValue operationResultValue(int id) const;
+    Q_INVOKABLE Error operationError(int id) const;
+    Q_INVOKABLE QString operationErrorString(int id) const;
+    
 public Q_SLOTS:
     void cancel();
+    void cancelOperation(int id);
+    void releaseOperation(int id);
     
 protected:
     void setUrl(const QUrl &url);
@@ -150,11 +200,11 @@ protected:
     void setData(const QVariant &data);
     
 protected Q_SLOTS:
-    void head(bool authRequired = true);
-    void get(bool authRequired = true);
-    void post(bool authRequired = true);
-    void put(bool authRequired = true);
-    void deleteResource(bool authRequired = true);
+    int head(bool authRequired = true);
+    int get(bool authRequired = true);
+    int post(bool authRequired = true);
+    int put(bool authRequired = true);
+    int deleteResource(bool authRequired = true);
     
 Q_SIGNALS:
     void apiKeyChanged();
@@ -167,7 +217,13 @@ Q_SIGNALS:
     void headersChanged();
     void operationChanged();
     void statusChanged(Status s);
+    void concurrentChanged();
+    void lazyResultChanged();
+    void timeoutChanged();
+    void inactivityTimeoutChanged();
     void finished();
+    void operationFinished(int id);
+    void retrying(int id, int retry, int delay);
     
 protected:
     Request(RequestPrivate &dd, QObject *parent = 0);
@@ -176,8 +232,14 @@ protected:
     
     Q_DECLARE_PRIVATE(Request)
     
-    Q_PRIVATE_SLOT(d_func(), void _q_onAccessTokenRefreshed())
+    Q_PRIVATE_SLOT(d_func(), void _q_onAccessTokenRefreshed(QString, QString, QVariant, int, QString))
     Q_PRIVATE_SLOT(d_func(), void _q_onReplyFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onFlightFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_retry())
+    Q_PRIVATE_SLOT(d_func(), void _q_onOperationReplyFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onOperationFlightFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onOperationRetryTimeout())
+    Q_PRIVATE_SLOT(d_func(), void _q_emitOperationsFinished())
     
 private:
     Q_DISABLE_COPY(Request)
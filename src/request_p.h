@@ -19,9 +19,14 @@
 
 #include "request.h"
 #include "json.h"
+#include "urls.h"
+#include <QHash>
+#include <QStringList>
 #include <QUrl>
 #include <QVariantMap>
 #include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QTimer>
 #if QT_VERSION >= 0x050000
 #include <QUrlQuery>
 #endif
@@ -29,10 +34,12 @@
 #include <QDebug>
 #endif
 
-class QNetworkReply;
-
 namespace QYouTube {
 
+class InFlightReply;
+class QuotaTracker;
+class RetryPolicy;
+
 static const int MAX_REDIRECTS = 8;
 
 #if QT_VERSION >= 0x050000
@@ -79,6 +86,37 @@ inline void addUrlQueryItems(QUrl *url, const QVariantMap &map) {
 }
 #endif
 
+inline QUrl resourcesUrl(const QString &resourcePath, const QStringList &part, const QVariantMap &filters,
+                         const QVariantMap &params) {
+    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
+                            .arg(resourcePath));
+#if QT_VERSION >= 0x050000
+    QUrlQuery query(u);
+    query.addQueryItem("part", part.join(","));
+    
+    if (!filters.isEmpty()) {
+        addUrlQueryItems(&query, filters);
+    }
+    
+    if (!params.isEmpty()) {
+        addUrlQueryItems(&query, params);
+    }
+    
+    u.setQuery(query);
+#else
+    u.addQueryItem("part", part.join(","));
+    
+    if (!filters.isEmpty()) {
+        addUrlQueryItems(&u, filters);
+    }
+    
+    if (!params.isEmpty()) {
+        addUrlQueryItems(&u, params);
+    }
+#endif
+    return u;
+}
+
 inline void addRequestHeaders(QNetworkRequest *request, const QVariantMap &map) {
 #ifdef QYOUTUBE_DEBUG
     qDebug() << "addRequestHeaders:" << request->url() << map;
@@ -125,6 +163,196 @@ inline void addPostBody(QString *body, const QVariantMap &map) {
     }
 }
 
+/*!
+    \internal
+    \brief Aborts a QNetworkReply that exceeds its deadline, or that receives no data for too long.
+    
+    The timers start when the reply is sent. The ReplyTimeout is a child of the reply, so it is deleted with it.
+*/
+class ReplyTimeout : public QObject
+{
+    Q_OBJECT
+    
+public:
+    static void watch(QNetworkReply *reply, int timeout, int inactivityTimeout);
+    
+    static bool isTimedOut(QNetworkReply *reply);
+    
+private Q_SLOTS:
+    void _q_onStarted();
+    void _q_onProgress();
+    void _q_onTimeout();
+    void _q_onFinished();
+    
+private:
+    ReplyTimeout(QNetworkReply *reply, int timeout, int inactivityTimeout);
+    
+    QNetworkReply *reply;
+    
+    QTimer *deadlineTimer;
+    QTimer *inactivityTimer;
+};
+
+// A reply aborted by its ReplyTimeout reports TimeoutError instead of OperationCanceledError.
+inline QNetworkReply::NetworkError replyError(QNetworkReply *reply) {
+    return ReplyTimeout::isTimedOut(reply) ? QNetworkReply::TimeoutError : reply->error();
+}
+
+inline QString replyErrorString(QNetworkReply *reply) {
+    return ReplyTimeout::isTimedOut(reply) ? Request::tr("The request timed out") : reply->errorString();
+}
+
+// The response of a lazy reply is indexed when it is finished, instead of being parsed.
+inline void setLazyReply(QNetworkReply *reply) {
+    reply->setProperty("qyoutube_lazyResult", true);
+}
+
+inline bool isLazyReply(QNetworkReply *reply) {
+    return reply->property("qyoutube_lazyResult").toBool();
+}
+
+/*!
+    \internal
+    \brief Parses the JSON response of a QNetworkReply as each chunk of data arrives.
+    
+    Parsing overlaps the download, so only the remaining data is parsed when the reply is finished.
+    The raw response is only kept if keepData is true, for a ResponseCache, and is released by takeData().
+    The ReplyParser is a child of the reply, so it is deleted with it.
+*/
+class ReplyParser : public QObject
+{
+    Q_OBJECT
+    
+public:
+    static void watch(QNetworkReply *reply, bool keepData = false);
+    
+    static ReplyParser* parser(QNetworkReply *reply);
+    
+    QVariant result(bool &ok);
+    
+    QByteArray takeData();
+    
+private Q_SLOTS:
+    void _q_onReadyRead();
+    
+private:
+    ReplyParser(QNetworkReply *reply, bool keepData);
+    
+    QNetworkReply *reply;
+    
+    QtJson::JsonStreamParser stream;
+    
+    bool keepData;
+    
+    QByteArray response;
+};
+
+/*!
+    \internal
+    \brief The outcome of a finished QNetworkReply.
+
+    The result is not parsed if the response is 304 Not Modified. A successful lazy reply has a document instead of
+    a result.
+*/
+class ReplyResult
+{
+
+public:
+    ReplyResult() :
+        statusCode(0),
+        ok(true),
+        error(QNetworkReply::NoError)
+    {
+    }
+    
+    static ReplyResult fromReply(QNetworkReply *reply);
+    
+    QUrl redirect;
+    
+    int statusCode;
+    
+    QByteArray etag;
+    
+    QByteArray data;
+    
+    QVariant result;
+    
+    QtJson::JsonDocument document;
+    
+    bool ok;
+    
+    QNetworkReply::NetworkError error;
+    
+    QString errorString;
+};
+
+class RequestOperation
+{
+
+public:
+    RequestOperation() :
+        id(0),
+        operation(Request::UnknownOperation),
+        status(Request::Null),
+        error(Request::NoError),
+        authRequired(true),
+        accessTokenRefreshed(false),
+        conditional(true),
+        redirects(0),
+        retries(0),
+        reply(0),
+        flight(0),
+        retryTimer(0),
+        quotaCharged(false)
+    {
+    }
+    
+    int id;
+    
+    Request::Operation operation;
+    
+    Request::Status status;
+    
+    Request::Error error;
+    
+    QString errorString;
+    
+    // Converted from resultValue when it is first read.
+    mutable QVariant result;
+    
+    QtJson::JsonValue resultValue;
+    
+    QUrl url;
+    
+    QVariantMap headers;
+    
+    QByteArray contentType;
+    
+    QByteArray body;
+    
+    bool authRequired;
+    
+    bool accessTokenRefreshed;
+    
+    // False if If-None-Match must not be sent, since the cached result could not be used after a 304 response.
+    bool conditional;
+    
+    int redirects;
+    
+    int retries;
+    
+    QNetworkReply *reply;
+    
+    InFlightReply *flight;
+    
+    // Also used to delay operations held back by a QuotaTracker.
+    QTimer *retryTimer;
+    
+    // The resource path charged to the QuotaTracker, and whether the next attempt has already been charged.
+    QString resourcePath;
+    bool quotaCharged;
+};
+
 class RequestPrivate
 {
 
@@ -143,24 +371,104 @@ public:
     void setErrorString(const QString &es);
     
     void setResult(const QVariant &res);
+    void setResultValue(const QtJson::JsonValue &value);
+    
+    QUrl authenticatedUrl(QUrl u) const;
+    
+    QByteArray contentType() const;
+    
+    QByteArray serializeData(bool &ok) const;
+    
+    void addConditionalHeaders(QNetworkRequest *request, const QUrl &u) const;
     
     virtual QNetworkRequest buildRequest(bool authRequired = true);
     virtual QNetworkRequest buildRequest(QUrl u, bool authRequired = true);
     
+    QNetworkReply* sendRequest(Request::Operation op, const QNetworkRequest &request,
+                               const QByteArray &body = QByteArray());
+    
+    QNetworkReply* watchReply(QNetworkReply *r) const;
+    
+    bool findCachedResult(const QUrl &u, QVariant &res, QtJson::JsonValue &value);
+    
     virtual void followRedirect(const QUrl &redirect);
         
     void refreshAccessToken();
-    virtual void _q_onAccessTokenRefreshed();
+    virtual void accessTokenRefreshed(const QVariant &response, Request::Error e, const QString &es);
+    void _q_onAccessTokenRefreshed(const QString &id, const QString &token, const QVariant &response, int e,
+                                   const QString &es);
     
     virtual void _q_onReplyFinished();
     
+    void handleReplyResult(const ReplyResult &r);
+    
+    bool shouldRetry(Request::Operation op, int attempts, const ReplyResult &r) const;
+    int replayOperation(Request::Operation op);
+    void scheduleRetry();
+    void startRetryTimer(int delay);
+    void _q_retry();
+    
+    void detachFlight();
+    void _q_onFlightFinished();
+    
+    bool sharesReply(Request::Operation op);
+    bool sharesReply(const RequestOperation &o);
+    
+    int chargeQuota(Request::Operation op, const QString &path);
+    
+    int admitRequest(Request::Operation op, const QString &path);
+    
+    int startOperation(Request::Operation op, bool authRequired, int delay = 0);
+    
+    QNetworkRequest buildOperationRequest(const RequestOperation &o, const QUrl &u);
+    void sendOperation(RequestOperation &o, const QUrl &u);
+    
+    virtual void cancelOperation(int id);
+    
+    void finishOperation(int id, Request::Status s, Request::Error e = Request::NoError,
+                         const QString &es = QString());
+    
+    virtual void operationFinished(int id);
+    
+    void refreshOperationsAccessToken();
+    
+    void handleOperationReplyResult(int id, const ReplyResult &r);
+    
+    void detachOperationFlight(RequestOperation &o);
+    
+    void scheduleOperationRetry(RequestOperation &o);
+    void startOperationRetryTimer(RequestOperation &o, int delay);
+    void clearOperationRetry(RequestOperation &o);
+    
+    void _q_onOperationReplyFinished();
+    void _q_onOperationFlightFinished();
+    void _q_onOperationRetryTimeout();
+    void _q_emitOperationsFinished();
+    
     Request *q_ptr;
     
     QNetworkAccessManager *manager;
     
+    ResponseCache *responseCache;
+    
+    RetryPolicy *retryPolicy;
+    
+    QuotaTracker *quotaTracker;
+    
+    QTimer *retryTimer;
+    
     QNetworkReply *reply;
     
-    bool ownNetworkAccessManager;
+    InFlightReply *flight;
+    
+    bool shareReplies;
+    
+    bool parseIncrementally;
+    
+    bool lazyResult;
+    
+    // False if If-None-Match must not be sent with the next GET request.
+    bool conditional;
     
     QString apiKey;
     QString clientId;
@@ -174,7 +482,10 @@ public:
     
     QVariant data;
     
-    QVariant result;
+    // Converted from resultValue when it is first read.
+    mutable QVariant result;
+    
+    QtJson::JsonValue resultValue;
     
     Request::Operation operation;
     
@@ -186,6 +497,34 @@ public:
     
     int redirects;
     
+    int retries;
+    
+    QString resourcePath;
+    bool quotaCharged;
+    
+    int timeout;
+    int inactivityTimeout;
+    
+    bool concurrent;
+    
+    int lastOperationId;
+    
+    int activeOperations;
+    
+    QHash<int, RequestOperation> operations;
+    
+    QHash<QNetworkReply*, int> operationReplies;
+    
+    QMultiHash<InFlightReply*, int> operationFlights;
+    
+    QHash<QTimer*, int> operationRetryTimers;
+    
+    bool refreshingAccessToken;
+    
+    QList<int> tokenQueue;
+    
+    QList<int> finishedOperations;
+    
     Q_DECLARE_PUBLIC(Request)
 };
 
@@ -0,0 +1,707 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resources.h"
+#include "json.h"
+#include <string.h>
+
+namespace QYouTube {
+
+/*!
+    \internal
+    \brief Fields are described by their path within a resource and the member they are decoded into.
+
+    The tables are constant data, so they are built by the compiler rather than when the library is loaded.
+    Fields with the same parent object are listed together, so that the parent is only looked up once.
+*/
+template <typename T>
+struct StringField
+{
+    const char *path;
+    QString T::*member;
+};
+
+template <typename T>
+struct IntegerField
+{
+    const char *path;
+    qint64 T::*member;
+};
+
+template <typename T>
+struct DateTimeField
+{
+    const char *path;
+    QDateTime T::*member;
+};
+
+template <typename T>
+struct StringListField
+{
+    const char *path;
+    QStringList T::*member;
+};
+
+template <typename T>
+struct ResourceSchema
+{
+    const StringField<T> *strings;
+    int stringCount;
+
+    const IntegerField<T> *integers;
+    int integerCount;
+
+    const DateTimeField<T> *dateTimes;
+    int dateTimeCount;
+
+    const StringListField<T> *stringLists;
+    int stringListCount;
+};
+
+#define QYOUTUBE_FIELD_COUNT(fields) int(sizeof(fields) / sizeof(fields[0]))
+
+static const StringField<Video> videoStrings[] = {
+    { "id", &Video::id },
+    { "etag", &Video::etag },
+    { "snippet.channelId", &Video::channelId },
+    { "snippet.channelTitle", &Video::channelTitle },
+    { "snippet.title", &Video::title },
+    { "snippet.description", &Video::description },
+    { "snippet.categoryId", &Video::categoryId },
+    { "snippet.thumbnails.default.url", &Video::defaultThumbnailUrl },
+    { "snippet.thumbnails.medium.url", &Video::mediumThumbnailUrl },
+    { "snippet.thumbnails.high.url", &Video::highThumbnailUrl },
+    { "contentDetails.duration", &Video::duration },
+    { "contentDetails.definition", &Video::definition },
+    { "status.privacyStatus", &Video::privacyStatus }
+};
+
+static const IntegerField<Video> videoIntegers[] = {
+    { "statistics.viewCount", &Video::viewCount },
+    { "statistics.likeCount", &Video::likeCount },
+    { "statistics.dislikeCount", &Video::dislikeCount },
+    { "statistics.favoriteCount", &Video::favoriteCount },
+    { "statistics.commentCount", &Video::commentCount }
+};
+
+static const DateTimeField<Video> videoDateTimes[] = {
+    { "snippet.publishedAt", &Video::publishedAt }
+};
+
+static const StringListField<Video> videoStringLists[] = {
+    { "snippet.tags", &Video::tags }
+};
+
+static const ResourceSchema<Video> videoSchema = {
+    videoStrings, QYOUTUBE_FIELD_COUNT(videoStrings),
+    videoIntegers, QYOUTUBE_FIELD_COUNT(videoIntegers),
+    videoDateTimes, QYOUTUBE_FIELD_COUNT(videoDateTimes),
+    videoStringLists, QYOUTUBE_FIELD_COUNT(videoStringLists)
+};
+
+static const StringField<Channel> channelStrings[] = {
+    { "id", &Channel::id },
+    { "etag", &Channel::etag },
+    { "snippet.title", &Channel::title },
+    { "snippet.description", &Channel::description },
+    { "snippet.thumbnails.default.url", &Channel::defaultThumbnailUrl },
+    { "snippet.thumbnails.medium.url", &Channel::mediumThumbnailUrl },
+    { "snippet.thumbnails.high.url", &Channel::highThumbnailUrl },
+    { "contentDetails.relatedPlaylists.uploads", &Channel::uploadsPlaylistId }
+};
+
+static const IntegerField<Channel> channelIntegers[] = {
+    { "statistics.viewCount", &Channel::viewCount },
+    { "statistics.subscriberCount", &Channel::subscriberCount },
+    { "statistics.videoCount", &Channel::videoCount }
+};
+
+static const DateTimeField<Channel> channelDateTimes[] = {
+    { "snippet.publishedAt", &Channel::publishedAt }
+};
+
+static const ResourceSchema<Channel> channelSchema = {
+    channelStrings, QYOUTUBE_FIELD_COUNT(channelStrings),
+    channelIntegers, QYOUTUBE_FIELD_COUNT(channelIntegers),
+    channelDateTimes, QYOUTUBE_FIELD_COUNT(channelDateTimes),
+    0, 0
+};
+
+static const StringField<Playlist> playlistStrings[] = {
+    { "id", &Playlist::id },
+    { "etag", &Playlist::etag },
+    { "snippet.channelId", &Playlist::channelId },
+    { "snippet.channelTitle", &Playlist::channelTitle },
+    { "snippet.title", &Playlist::title },
+    { "snippet.description", &Playlist::description },
+    { "snippet.thumbnails.default.url", &Playlist::defaultThumbnailUrl },
+    { "snippet.thumbnails.medium.url", &Playlist::mediumThumbnailUrl },
+    { "snippet.thumbnails.high.url", &Playlist::highThumbnailUrl },
+    { "status.privacyStatus", &Playlist::privacyStatus }
+};
+
+static const IntegerField<Playlist> playlistIntegers[] = {
+    { "contentDetails.itemCount", &Playlist::itemCount }
+};
+
+static const DateTimeField<Playlist> playlistDateTimes[] = {
+    { "snippet.publishedAt", &Playlist::publishedAt }
+};
+
+static const ResourceSchema<Playlist> playlistSchema = {
+    playlistStrings, QYOUTUBE_FIELD_COUNT(playlistStrings),
+    playlistIntegers, QYOUTUBE_FIELD_COUNT(playlistIntegers),
+    playlistDateTimes, QYOUTUBE_FIELD_COUNT(playlistDateTimes),
+    0, 0
+};
+
+static const StringField<PlaylistItem> playlistItemStrings[] = {
+    { "id", &PlaylistItem::id },
+    { "etag", &PlaylistItem::etag },
+    { "snippet.playlistId", &PlaylistItem::playlistId },
+    { "snippet.channelId", &PlaylistItem::channelId },
+    { "snippet.channelTitle", &PlaylistItem::channelTitle },
+    { "snippet.title", &PlaylistItem::title },
+    { "snippet.description", &PlaylistItem::description },
+    { "snippet.resourceId.videoId", &PlaylistItem::videoId },
+    { "snippet.thumbnails.default.url", &PlaylistItem::defaultThumbnailUrl },
+    { "snippet.thumbnails.medium.url", &PlaylistItem::mediumThumbnailUrl },
+    { "snippet.thumbnails.high.url", &PlaylistItem::highThumbnailUrl }
+};
+
+static const IntegerField<PlaylistItem> playlistItemIntegers[] = {
+    { "snippet.position", &PlaylistItem::position }
+};
+
+static const DateTimeField<PlaylistItem> playlistItemDateTimes[] = {
+    { "snippet.publishedAt", &PlaylistItem::publishedAt }
+};
+
+static const ResourceSchema<PlaylistItem> playlistItemSchema = {
+    playlistItemStrings, QYOUTUBE_FIELD_COUNT(playlistItemStrings),
+    playlistItemIntegers, QYOUTUBE_FIELD_COUNT(playlistItemIntegers),
+    playlistItemDateTimes, QYOUTUBE_FIELD_COUNT(playlistItemDateTimes),
+    0, 0
+};
+
+static const StringField<SearchResult> searchResultStrings[] = {
+    { "etag", &SearchResult::etag },
+    { "id.kind", &SearchResult::kind },
+    { "id.videoId", &SearchResult::videoId },
+    { "id.playlistId", &SearchResult::playlistId },
+    { "snippet.channelId", &SearchResult::channelId },
+    { "snippet.channelTitle", &SearchResult::channelTitle },
+    { "snippet.title", &SearchResult::title },
+    { "snippet.description", &SearchResult::description },
+    { "snippet.liveBroadcastContent", &SearchResult::liveBroadcastContent },
+    { "snippet.thumbnails.default.url", &SearchResult::defaultThumbnailUrl },
+    { "snippet.thumbnails.medium.url", &SearchResult::mediumThumbnailUrl },
+    { "snippet.thumbnails.high.url", &SearchResult::highThumbnailUrl }
+};
+
+static const DateTimeField<SearchResult> searchResultDateTimes[] = {
+    { "snippet.publishedAt", &SearchResult::publishedAt }
+};
+
+static const ResourceSchema<SearchResult> searchResultSchema = {
+    searchResultStrings, QYOUTUBE_FIELD_COUNT(searchResultStrings),
+    0, 0,
+    searchResultDateTimes, QYOUTUBE_FIELD_COUNT(searchResultDateTimes),
+    0, 0
+};
+
+static const StringField<Comment> commentStrings[] = {
+    { "id", &Comment::id },
+    { "etag", &Comment::etag },
+    { "snippet.videoId", &Comment::videoId },
+    { "snippet.parentId", &Comment::parentId },
+    { "snippet.authorDisplayName", &Comment::authorDisplayName },
+    { "snippet.authorProfileImageUrl", &Comment::authorProfileImageUrl },
+    { "snippet.textDisplay", &Comment::textDisplay },
+    { "snippet.textOriginal", &Comment::textOriginal },
+    { "snippet.authorChannelId.value", &Comment::authorChannelId }
+};
+
+static const IntegerField<Comment> commentIntegers[] = {
+    { "snippet.likeCount", &Comment::likeCount }
+};
+
+static const DateTimeField<Comment> commentDateTimes[] = {
+    { "snippet.publishedAt", &Comment::publishedAt },
+    { "snippet.updatedAt", &Comment::updatedAt }
+};
+
+static const ResourceSchema<Comment> commentSchema = {
+    commentStrings, QYOUTUBE_FIELD_COUNT(commentStrings),
+    commentIntegers, QYOUTUBE_FIELD_COUNT(commentIntegers),
+    commentDateTimes, QYOUTUBE_FIELD_COUNT(commentDateTimes),
+    0, 0
+};
+
+#undef QYOUTUBE_FIELD_COUNT
+
+/*!
+    \internal
+    \brief Accesses a resource indexed by QtJson::JsonDocument, so that fields are decoded directly from the response.
+*/
+struct JsonValueAccess
+{
+    typedef QtJson::JsonValue Value;
+
+    static Value child(const Value &value, const char *key, int size) {
+        return value.value(key, size);
+    }
+
+    static bool isArray(const Value &value) {
+        return value.type() == QtJson::JsonValue::Array;
+    }
+
+    static bool isObject(const Value &value) {
+        return value.type() == QtJson::JsonValue::Object;
+    }
+
+    static bool isUndefined(const Value &value) {
+        return value.isUndefined();
+    }
+
+    static QList<Value> values(const Value &value) {
+        return value.values();
+    }
+
+    static QString toString(const Value &value) {
+        return value.toString();
+    }
+
+    static qint64 toInteger(const Value &value) {
+        return value.toLongLong();
+    }
+};
+
+/*!
+    \internal
+    \brief Accesses a resource that has already been parsed into a QVariant, such as a cached result.
+*/
+struct VariantAccess
+{
+    typedef QVariant Value;
+
+    static Value child(const Value &value, const char *key, int size) {
+        return value.toMap().value(QString::fromLatin1(key, size));
+    }
+
+    static bool isArray(const Value &value) {
+        return value.type() == QVariant::List;
+    }
+
+    static bool isObject(const Value &value) {
+        return value.type() == QVariant::Map;
+    }
+
+    static bool isUndefined(const Value &value) {
+        return !value.isValid();
+    }
+
+    static QList<Value> values(const Value &value) {
+        return value.toList();
+    }
+
+    static QString toString(const Value &value) {
+        return value.toString();
+    }
+
+    static qint64 toInteger(const Value &value) {
+        return value.toLongLong();
+    }
+};
+
+/*!
+    \internal
+    \brief Finds the fields of a resource, remembering each parent object that has been looked up.
+
+    Parents are resolved from their own parents, so that snippet is looked up once for snippet.title and
+    snippet.thumbnails.default.url, and snippet.thumbnails once for each thumbnail.
+*/
+template <typename A>
+class FieldFinder
+{
+
+public:
+    typedef typename A::Value Value;
+
+    explicit FieldFinder(const Value &resource) :
+        resource(resource),
+        parentCount(0)
+    {
+    }
+
+    Value find(const char *path) {
+        const int size = int(strlen(path));
+        const char *dot = lastDot(path, size);
+
+        if (!dot) {
+            return A::child(resource, path, size);
+        }
+
+        return A::child(parent(path, int(dot - path)), dot + 1, int(path + size - dot - 1));
+    }
+
+private:
+    static const char* lastDot(const char *path, int size) {
+        for (int i = size - 1; i >= 0; i--) {
+            if (path[i] == '.') {
+                return path + i;
+            }
+        }
+
+        return 0;
+    }
+
+    Value parent(const char *path, int size) {
+        for (int i = parentCount - 1; i >= 0; i--) {
+            if ((parents[i].size == size) && (!strncmp(parents[i].path, path, size))) {
+                return parents[i].value;
+            }
+        }
+
+        const char *dot = lastDot(path, size);
+        const Value value = dot ? A::child(parent(path, int(dot - path)), dot + 1, int(path + size - dot - 1))
+                                : A::child(resource, path, size);
+
+        if (parentCount == MAX_PARENTS) {
+            parentCount = 0;
+        }
+
+        parents[parentCount].path = path;
+        parents[parentCount].size = size;
+        parents[parentCount].value = value;
+        parentCount++;
+        return value;
+    }
+
+    struct Parent
+    {
+        const char *path;
+        int size;
+        Value value;
+    };
+
+    enum { MAX_PARENTS = 16 };
+
+    Value resource;
+
+    Parent parents[MAX_PARENTS];
+    int parentCount;
+};
+
+// Parses dates such as 2015-06-10T12:00:00.000Z, which QDateTime::fromString() does not accept in Qt 4.
+static QDateTime parseDateTime(const QString &s) {
+    if ((s.size() < 19) || (s.at(4) != QLatin1Char('-')) || (s.at(10) != QLatin1Char('T'))) {
+        return QDateTime();
+    }
+
+    const QDate date(s.mid(0, 4).toInt(), s.mid(5, 2).toInt(), s.mid(8, 2).toInt());
+    const QTime time(s.mid(11, 2).toInt(), s.mid(14, 2).toInt(), s.mid(17, 2).toInt());
+    return QDateTime(date, time, Qt::UTC);
+}
+
+template <typename A, typename T>
+static void decodeFields(const typename A::Value &value, const ResourceSchema<T> &schema, T &resource) {
+    FieldFinder<A> finder(value);
+
+    for (int i = 0; i < schema.stringCount; i++) {
+        resource.*(schema.strings[i].member) = A::toString(finder.find(schema.strings[i].path));
+    }
+
+    for (int i = 0; i < schema.integerCount; i++) {
+        resource.*(schema.integers[i].member) = A::toInteger(finder.find(schema.integers[i].path));
+    }
+
+    for (int i = 0; i < schema.dateTimeCount; i++) {
+        resource.*(schema.dateTimes[i].member) = parseDateTime(A::toString(finder.find(schema.dateTimes[i].path)));
+    }
+
+    for (int i = 0; i < schema.stringListCount; i++) {
+        QStringList &list = resource.*(schema.stringLists[i].member);
+
+        foreach (const typename A::Value &v, A::values(finder.find(schema.stringLists[i].path))) {
+            list << A::toString(v);
+        }
+    }
+}
+
+template <typename A, typename T>
+struct ResourceDecoder
+{
+    static void decode(const typename A::Value &value, const ResourceSchema<T> &schema, T &resource) {
+        decodeFields<A, T>(value, schema, resource);
+    }
+};
+
+template <typename A>
+struct ResourceDecoder<A, Comment>
+{
+    typedef typename A::Value Value;
+
+    static void decode(const Value &value, const ResourceSchema<Comment> &schema, Comment &comment) {
+        // A comment thread is decoded as its top level comment.
+        if (A::toString(A::child(value, "kind", 4)) == QLatin1String("youtube#commentThread")) {
+            const Value snippet = A::child(value, "snippet", 7);
+            decodeFields<A, Comment>(A::child(snippet, "topLevelComment", 15), schema, comment);
+            comment.totalReplyCount = A::toInteger(A::child(snippet, "totalReplyCount", 15));
+
+            if (comment.videoId.isEmpty()) {
+                comment.videoId = A::toString(A::child(snippet, "videoId", 7));
+            }
+
+            return;
+        }
+
+        decodeFields<A, Comment>(value, schema, comment);
+    }
+};
+
+template <typename A, typename T>
+static bool decodeRoot(const typename A::Value &root, const ResourceSchema<T> &schema, QList<T> &resources) {
+    if (!A::isObject(root)) {
+        return false;
+    }
+
+    const typename A::Value items = A::child(root, "items", 5);
+
+    if (A::isArray(items)) {
+        const QList<typename A::Value> values = A::values(items);
+        resources.reserve(resources.size() + values.size());
+
+        foreach (const typename A::Value &value, values) {
+            T resource;
+            ResourceDecoder<A, T>::decode(value, schema, resource);
+            resources << resource;
+        }
+
+        return true;
+    }
+
+    // The response to an insert or update, or a single item of a batch, is the resource itself. An empty list
+    // response has no items, and is not decoded as a resource.
+    const typename A::Value kind = A::child(root, "kind", 4);
+
+    if ((A::isUndefined(kind)) || (A::toString(kind).endsWith(QLatin1String("ListResponse")))) {
+        return false;
+    }
+
+    T resource;
+    ResourceDecoder<A, T>::decode(root, schema, resource);
+    resources << resource;
+    return true;
+}
+
+template <typename T>
+static bool decodeResources(const QByteArray &json, const ResourceSchema<T> &schema, QList<T> &resources) {
+    bool ok = false;
+    const QtJson::JsonDocument document = QtJson::JsonDocument::fromJson(json, ok);
+    return (ok) && (decodeRoot<JsonValueAccess, T>(document.root(), schema, resources));
+}
+
+/*!
+    \class Video
+    \brief A YouTube video resource, decoded from the snippet, contentDetails, statistics and status parts.
+
+    \ingroup resources
+
+    \sa decodeResources(), ResourcesRequest::resultItems()
+*/
+
+/*!
+    \class Channel
+    \brief A YouTube channel resource, decoded from the snippet, contentDetails and statistics parts.
+
+    \ingroup resources
+*/
+
+/*!
+    \class Playlist
+    \brief A YouTube playlist resource, decoded from the snippet, contentDetails and status parts.
+
+    \ingroup resources
+*/
+
+/*!
+    \class PlaylistItem
+    \brief A YouTube playlist item resource, decoded from the snippet part.
+
+    \ingroup resources
+*/
+
+/*!
+    \class SearchResult
+    \brief A YouTube search result, decoded from the id and snippet parts.
+
+    \ingroup resources
+*/
+
+/*!
+    \class Comment
+    \brief A YouTube comment resource, decoded from the snippet part.
+
+    A comment thread is decoded as its top level comment, with the totalReplyCount of the thread.
+
+    \ingroup resources
+*/
+
+/*!
+    \brief Decodes the videos in the JSON response \a json and appends them to \a resources.
+
+    Each field is decoded directly from the response text, without building a QVariant for the response. Fields
+    that are not present in the response are left empty.
+
+    Returns true if the response contains a list of items or a single resource.
+
+    \sa ResourcesRequest::resultItems()
+*/
+bool decodeResources(const QByteArray &json, QList<Video> &resources) {
+    return decodeResources<Video>(json, videoSchema, resources);
+}
+
+/*!
+    \brief Decodes the channels in the JSON response \a json and appends them to \a resources.
+*/
+bool decodeResources(const QByteArray &json, QList<Channel> &resources) {
+    return decodeResources<Channel>(json, channelSchema, resources);
+}
+
+/*!
+    \brief Decodes the playlists in the JSON response \a json and appends them to \a resources.
+*/
+bool decodeResources(const QByteArray &json, QList<Playlist> &resources) {
+    return decodeResources<Playlist>(json, playlistSchema, resources);
+}
+
+/*!
+    \brief Decodes the playlist items in the JSON response \a json and appends them to \a resources.
+*/
+bool decodeResources(const QByteArray &json, QList<PlaylistItem> &resources) {
+    return decodeResources<PlaylistItem>(json, playlistItemSchema, resources);
+}
+
+/*!
+    \brief Decodes the search results in the JSON response \a json and appends them to \a resources.
+*/
+bool decodeResources(const QByteArray &json, QList<SearchResult> &resources) {
+    return decodeResources<SearchResult>(json, searchResultSchema, resources);
+}
+
+/*!
+    \brief Decodes the comments or comment threads in the JSON response \a json and appends them to \a resources.
+*/
+bool decodeResources(const QByteArray &json, QList<Comment> &resources) {
+    return decodeResources<Comment>(json, commentSchema, resources);
+}
+
+/*!
+    \brief Decodes the videos in the indexed response \a value and appends them to \a resources.
+
+    This is used to decode the resultValue() of a request with lazyResult enabled, so that the fields are decoded
+    directly from the response text, and the response is not parsed again.
+
+    \sa Request::resultValue(), Request::lazyResult
+*/
+bool decodeResources(const QtJson::JsonValue &value, QList<Video> &resources) {
+    return decodeRoot<JsonValueAccess, Video>(value, videoSchema, resources);
+}
+
+/*!
+    \brief Decodes the channels in the indexed response \a value and appends them to \a resources.
+*/
+bool decodeResources(const QtJson::JsonValue &value, QList<Channel> &resources) {
+    return decodeRoot<JsonValueAccess, Channel>(value, channelSchema, resources);
+}
+
+/*!
+    \brief Decodes the playlists in the indexed response \a value and appends them to \a resources.
+*/
+bool decodeResources(const QtJson::JsonValue &value, QList<Playlist> &resources) {
+    return decodeRoot<JsonValueAccess, Playlist>(value, playlistSchema, resources);
+}
+
+/*!
+    \brief Decodes the playlist items in the indexed response \a value and appends them to \a resources.
+*/
+bool decodeResources(const QtJson::JsonValue &value, QList<PlaylistItem> &resources) {
+    return decodeRoot<JsonValueAccess, PlaylistItem>(value, playlistItemSchema, resources);
+}
+
+/*!
+    \brief Decodes the search results in the indexed response \a value and appends them to \a resources.
+*/
+bool decodeResources(const QtJson::JsonValue &value, QList<SearchResult> &resources) {
+    return decodeRoot<JsonValueAccess, SearchResult>(value, searchResultSchema, resources);
+}
+
+/*!
+    \brief Decodes the comments or comment threads in the indexed response \a value and appends them to \a resources.
+*/
+bool decodeResources(const QtJson::JsonValue &value, QList<Comment> &resources) {
+    return decodeRoot<JsonValueAccess, Comment>(value, commentSchema, resources);
+}
+
+/*!
+    \brief Decodes the videos in the parsed response \a value and appends them to \a resources.
+
+    This is used to decode a result that has already been parsed into a QVariant, such as the result() of a request
+    or a cached result, without serializing it again.
+
+    \sa Request::result()
+*/
+bool decodeResources(const QVariant &value, QList<Video> &resources) {
+    return decodeRoot<VariantAccess, Video>(value, videoSchema, resources);
+}
+
+/*!
+    \brief Decodes the channels in the parsed response \a value and appends them to \a resources.
+*/
+bool decodeResources(const QVariant &value, QList<Channel> &resources) {
+    return decodeRoot<VariantAccess, Channel>(value, channelSchema, resources);
+}
+
+/*!
+    \brief Decodes the playlists in the parsed response \a value and appends them to \a resources.
+*/
+bool decodeResources(const QVariant &value, QList<Playlist> &resources) {
+    return decodeRoot<VariantAccess, Playlist>(value, playlistSchema, resources);
+}
+
+/*!
+    \brief Decodes the playlist items in the parsed response \a value and appends them to \a resources.
+*/
+bool decodeResources(const QVariant &value, QList<PlaylistItem> &resources) {
+    return decodeRoot<VariantAccess, PlaylistItem>(value, playlistItemSchema, resources);
+}
+
+/*!
+    \brief Decodes the search results in the parsed response \a value and appends them to \a resources.
+*/
+bool decodeResources(const QVariant &value, QList<SearchResult> &resources) {
+    return decodeRoot<VariantAccess, SearchResult>(value, searchResultSchema, resources);
+}
+
+/*!
+    \brief Decodes the comments or comment threads in the parsed response \a value and appends them to \a resources.
+*/
+bool decodeResources(const QVariant &value, QList<Comment> &resources) {
+    return decodeRoot<VariantAccess, Comment>(value, commentSchema, resources);
+}
+
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_RESOURCES_H
+#define QYOUTUBE_RESOURCES_H
+
+#include "qyoutube_global.h"
+#include <QDateTime>
+#include <QList>
+#include <QStringList>
+#include <QVariant>
+
+namespace QtJson {
+    class JsonValue;
+}
+
+namespace QYouTube {
+
+class Video
+{
+
+public:
+    Video() :
+        viewCount(0),
+        likeCount(0),
+        dislikeCount(0),
+        favoriteCount(0),
+        commentCount(0)
+    {
+    }
+
+    QString id;
+    QString etag;
+
+    QString channelId;
+    QString channelTitle;
+
+    QString title;
+    QString description;
+
+    QDateTime publishedAt;
+
+    QString defaultThumbnailUrl;
+    QString mediumThumbnailUrl;
+    QString highThumbnailUrl;
+
+    QString categoryId;
+
+    QStringList tags;
+
+    QString duration;
+    QString definition;
+
+    QString privacyStatus;
+
+    qint64 viewCount;
+    qint64 likeCount;
+    qint64 dislikeCount;
+    qint64 favoriteCount;
+    qint64 commentCount;
+};
+
+class Channel
+{
+
+public:
+    Channel() :
+        viewCount(0),
+        subscriberCount(0),
+        videoCount(0)
+    {
+    }
+
+    QString id;
+    QString etag;
+
+    QString title;
+    QString description;
+
+    QDateTime publishedAt;
+
+    QString defaultThumbnailUrl;
+    QString mediumThumbnailUrl;
+    QString highThumbnailUrl;
+
+    QString uploadsPlaylistId;
+
+    qint64 viewCount;
+    qint64 subscriberCount;
+    qint64 videoCount;
+};
+
+class Playlist
+{
+
+public:
+    Playlist() :
+        itemCount(0)
+    {
+    }
+
+    QString id;
+    QString etag;
+
+    QString channelId;
+    QString channelTitle;
+
+    QString title;
+    QString description;
+
+    QDateTime publishedAt;
+
+    QString defaultThumbnailUrl;
+    QString mediumThumbnailUrl;
+    QString highThumbnailUrl;
+
+    QString privacyStatus;
+
+    qint64 itemCount;
+};
+
+class PlaylistItem
+{
+
+public:
+    PlaylistItem() :
+        position(0)
+    {
+    }
+
+    QString id;
+    QString etag;
+
+    QString playlistId;
+    QString videoId;
+
+    QString channelId;
+    QString channelTitle;
+
+    QString title;
+    QString description;
+
+    QDateTime publishedAt;
+
+    QString defaultThumbnailUrl;
+    QString mediumThumbnailUrl;
+    QString highThumbnailUrl;
+
+    qint64 position;
+};
+
+class SearchResult
+{
+
+public:
+    QString kind;
+    QString etag;
+
+    QString videoId;
+    QString channelId;
+    QString playlistId;
+
+    QString channelTitle;
+
+    QString title;
+    QString description;
+
+    QDateTime publishedAt;
+
+    QString defaultThumbnailUrl;
+    QString mediumThumbnailUrl;
+    QString highThumbnailUrl;
+
+    QString liveBroadcastContent;
+};
+
+class Comment
+{
+
+public:
+    Comment() :
+        likeCount(0),
+        totalReplyCount(0)
+    {
+    }
+
+    QString id;
+    QString etag;
+
+    QString videoId;
+    QString parentId;
+
+    QString authorDisplayName;
+    QString authorProfileImageUrl;
+    QString authorChannelId;
+
+    QString textDisplay;
+    QString textOriginal;
+
+    qint64 likeCount;
+    qint64 totalReplyCount;
+
+    QDateTime publishedAt;
+    QDateTime updatedAt;
+};
+
+QYOUTUBESHARED_EXPORT bool decodeResources(const QByteArray &json, QList<Video> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QByteArray &json, QList<Channel> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QByteArray &json, QList<Playlist> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QByteArray &json, QList<PlaylistItem> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QByteArray &json, QList<SearchResult> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QByteArray &json, QList<Comment> &resources);
+
+QYOUTUBESHARED_EXPORT bool decodeResources(const QtJson::JsonValue &value, QList<Video> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QtJson::JsonValue &value, QList<Channel> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QtJson::JsonValue &value, QList<Playlist> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QtJson::JsonValue &value, QList<PlaylistItem> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QtJson::JsonValue &value, QList<SearchResult> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QtJson::JsonValue &value, QList<Comment> &resources);
+
+QYOUTUBESHARED_EXPORT bool decodeResources(const QVariant &value, QList<Video> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QVariant &value, QList<Channel> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QVariant &value, QList<Playlist> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QVariant &value, QList<PlaylistItem> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QVariant &value, QList<SearchResult> &resources);
+QYOUTUBESHARED_EXPORT bool decodeResources(const QVariant &value, QList<Comment> &resources);
+
+}
+
+#endif // QYOUTUBE_RESOURCES_H
@@ -15,8 +15,12 @@
  */
 
 #include "resourcesmodel.h"
+#include "json.h"
 #include "model_p.h"
+#include <QElapsedTimer>
+#include <QSet>
 #include <QStringList>
+#include <QTimer>
 #ifdef QYOUTUBE_DEBUG
 #include <QDebug>
 #endif
@@ -29,9 +33,556 @@ class ResourcesModelPrivate : public ModelPrivate
 public:
     ResourcesModelPrivate(ResourcesModel *parent) :
         ModelPrivate(parent),
-        request(0)
+        request(0),
+        pageRequest(0),
+        windowSize(0),
+        loadingPage(-1),
+        loadScheduled(false),
+        firstRow(0),
+        lastRow(0),
+        fetchingPage(false),
+        prefetchDistance(0),
+        prefetchDepth(1),
+        prefetching(false),
+        prefetchScheduled(false),
+        stallTime(0),
+        stallCount(0),
+        incrementalReload(false),
+        reloading(false),
+        reloadCount(0)
     {
     }
+    
+    // Items are matched by their id, which is an object for search results.
+    static QString itemKey(const QVariant &id) {
+        return id.type() == QVariant::String ? id.toString() : QString::fromUtf8(QtJson::Json::serialize(id));
+    }
+    
+    // Returns the indices of the longest increasing subsequence of positions.
+    static QSet<int> longestIncreasingSubsequence(const QVector<int> &positions) {
+        QVector<int> tails;
+        QVector<int> previous(positions.size(), -1);
+        
+        for (int i = 0; i < positions.size(); i++) {
+            int low = 0;
+            int high = tails.size();
+            
+            while (low < high) {
+                const int middle = (low + high) / 2;
+                
+                if (positions.at(tails.at(middle)) < positions.at(i)) {
+                    low = middle + 1;
+                }
+                else {
+                    high = middle;
+                }
+            }
+            
+            if (low > 0) {
+                previous[i] = tails.at(low - 1);
+            }
+            
+            if (low == tails.size()) {
+                tails << i;
+            }
+            else {
+                tails[low] = i;
+            }
+        }
+        
+        QSet<int> sequence;
+        
+        for (int i = tails.isEmpty() ? -1 : tails.last(); i >= 0; i = previous.at(i)) {
+            sequence << i;
+        }
+        
+        return sequence;
+    }
+    
+    void requestReloadPage(const QString &pageToken) {
+        Q_Q(ResourcesModel);
+        
+        QVariantMap pageParams = params;
+        
+        if (!pageToken.isEmpty()) {
+            pageParams["pageToken"] = pageToken;
+        }
+        
+        reloadPageToken = pageToken;
+        ResourcesModel::connect(request, SIGNAL(finished()), q, SLOT(_q_onReloadRequestFinished()));
+        request->list(resourcePath, part, filters, pageParams);
+    }
+    
+    void _q_onReloadRequestFinished() {
+        if (!request) {
+            return;
+        }
+        
+        Q_Q(ResourcesModel);
+        
+        ResourcesModel::disconnect(request, SIGNAL(finished()), q, SLOT(_q_onReloadRequestFinished()));
+        
+        if (request->status() == ResourcesRequest::Ready) {
+            const QVariantMap result = request->result().toMap();
+            const QVariantList list = result.value("items").toList();
+            const QString token = result.value("nextPageToken").toString();
+            reloadPageTokens << reloadPageToken;
+            reloadPageSizes << list.size();
+            reloadItems << list;
+            
+            // As many pages are fetched as are needed to cover the items already in the model.
+            if ((reloadItems.size() < reloadCount) && (!token.isEmpty())) {
+                requestReloadPage(token);
+                emit q->statusChanged(request->status());
+                return;
+            }
+            
+            nextPageToken = token;
+            applyReload();
+        }
+        
+        reloadItems.clear();
+        reloadPageTokens.clear();
+        reloadPageSizes.clear();
+        reloading = false;
+        evictPages();
+        emit q->statusChanged(request->status());
+    }
+    
+    // Updates the items to match reloadItems, emitting only the signals for the rows that have changed.
+    void applyReload() {
+        Q_Q(ResourcesModel);
+        
+        const int oldCount = count();
+        QStringList keys;
+        QHash<QString, int> newRows;
+        
+        for (int i = 0; i < reloadItems.size(); i++) {
+            const QString key = itemKey(reloadItems.at(i).toMap().value("id"));
+            keys << key;
+            newRows.insert(key, i);
+        }
+        
+        // Remove the rows that are no longer in the list, or that are duplicates.
+        QStringList current;
+        
+        for (int i = 0; i < count(); i++) {
+            current << itemKey(itemValue(i, "id"));
+        }
+        
+        QSet<QString> kept;
+        QList<int> removed;
+        
+        for (int i = 0; i < current.size(); i++) {
+            if ((!newRows.contains(current.at(i))) || (kept.contains(current.at(i)))) {
+                removed.prepend(i);
+            }
+            else {
+                kept << current.at(i);
+            }
+        }
+        
+        // Contiguous rows are removed together, starting with the last run, so that the rows before it keep their 
+        // positions.
+        int run = 0;
+        
+        while (run < removed.size()) {
+            const int last = removed.at(run);
+            int first = last;
+            run++;
+            
+            while ((run < removed.size()) && (removed.at(run) == first - 1)) {
+                first--;
+                run++;
+            }
+            
+            q->beginRemoveRows(QModelIndex(), first, last);
+            
+            for (int i = last; i >= first; i--) {
+                removeItem(i);
+                current.removeAt(i);
+            }
+            
+            q->endRemoveRows();
+        }
+        
+        // Move the remaining rows into the new order, leaving the longest run that is already in order in place.
+        QHash<QString, int> oldRows;
+        
+        for (int i = 0; i < current.size(); i++) {
+            oldRows.insert(current.at(i), i);
+        }
+        
+        QStringList common;
+        QVector<int> positions;
+        
+        foreach (const QString &key, keys) {
+            if (kept.remove(key)) {
+                common << key;
+                positions << oldRows.value(key);
+            }
+        }
+        
+        const QSet<int> inPlace = longestIncreasingSubsequence(positions);
+        
+        for (int i = 0; i < common.size(); i++) {
+            if (inPlace.contains(i)) {
+                continue;
+            }
+            
+            const int from = current.indexOf(common.at(i));
+            int to = i > 0 ? current.indexOf(common.at(i - 1)) + 1 : 0;
+            
+            if (from < to) {
+                to--;
+            }
+            
+            if (from != to) {
+                q->beginMoveRows(QModelIndex(), from, from, QModelIndex(), from < to ? to + 1 : to);
+                moveItem(from, to);
+                current.move(from, to);
+                q->endMoveRows();
+            }
+        }
+        
+        // Insert the new rows, and update the rows whose etag has changed.
+        for (int i = 0; i < keys.size(); i++) {
+            const QVariantMap item = flatten(reloadItems.at(i).toMap());
+            
+            if ((i >= current.size()) || (current.at(i) != keys.at(i))) {
+                if (count() == 0) {
+                    setItemRoles(item);
+                }
+                
+                q->beginInsertRows(QModelIndex(), i, i);
+                insertItem(i, item);
+                current.insert(i, keys.at(i));
+                q->endInsertRows();
+            }
+            else {
+                const QString etag = itemValue(i, "etag").toString();
+                
+                if ((etag.isEmpty()) || (etag != item.value("etag").toString())) {
+                    setItem(i, item);
+                    const QModelIndex index = q->index(i);
+                    emit q->dataChanged(index, index);
+                }
+            }
+        }
+        
+        // Each page is stored as a block of rows.
+        pageTokens = reloadPageTokens;
+        setBlockSizes(reloadPageSizes);
+#ifdef QYOUTUBE_DEBUG
+        qDebug() << "QYouTube::ResourcesModelPrivate::applyReload" << oldCount << count();
+#endif
+        if (count() != oldCount) {
+            emit q->countChanged(q->rowCount());
+        }
+    }
+    
+    // Returns true if the next page should be fetched before the view reaches the end of the model.
+    bool shouldPrefetch() {
+        if ((prefetchDistance <= 0) || (fetchingPage) || (nextPageToken.isEmpty())
+            || (request->status() == ResourcesRequest::Loading)) {
+            return false;
+        }
+        
+        if (count() - 1 - lastRow < prefetchDistance) {
+            prefetching = true;
+            return true;
+        }
+        
+        // Once started, pages are fetched one after another until prefetchDepth pages are ahead of the view.
+        if ((prefetching) && (pageTokens.size() - 1 - qMax(0, blockOfRow(qMin(lastRow, count() - 1))) < prefetchDepth)) {
+            return true;
+        }
+        
+        prefetching = false;
+        return false;
+    }
+    
+    void schedulePrefetch() {
+        if ((prefetchDistance > 0) && (!prefetchScheduled)) {
+            Q_Q(ResourcesModel);
+            
+            prefetchScheduled = true;
+            QTimer::singleShot(0, q, SLOT(_q_prefetch()));
+        }
+    }
+    
+    void _q_prefetch() {
+        prefetchScheduled = false;
+        
+        if (shouldPrefetch()) {
+            Q_Q(ResourcesModel);
+#ifdef QYOUTUBE_DEBUG
+            qDebug() << "QYouTube::ResourcesModelPrivate::_q_prefetch" << lastRow << q->rowCount();
+#endif
+            q->fetchMore();
+        }
+    }
+    
+    // The view is waiting for data when it shows the last row while another page is expected.
+    void startStall() {
+        if ((!stallTimer.isValid()) && ((fetchingPage) || (!nextPageToken.isEmpty()))) {
+            stallTimer.start();
+        }
+    }
+    
+    void finishStall() {
+        if (stallTimer.isValid()) {
+            Q_Q(ResourcesModel);
+            
+            stallTime += stallTimer.elapsed();
+            stallCount++;
+            stallTimer.invalidate();
+            emit q->stallTimeChanged();
+        }
+    }
+    
+    // Pages are only evicted while each block of rows belongs to a known page, and the rows are not being reloaded.
+    bool isWindowed() const {
+        return (windowSize > 0) && (!reloading) && (!pageTokens.isEmpty()) && (pageTokens.size() == blocks.size());
+    }
+    
+    // The items of each page are appended as a new block.
+    void addPage(const QString &pageToken) {
+        pageTokens << pageToken;
+        evictPages();
+    }
+    
+    void resetPages() {
+        clearItems();
+        pageTokens.clear();
+        pageQueue.clear();
+        
+        if (loadingPage >= 0) {
+            loadingPage = -1;
+            pageRequest->cancel();
+        }
+    }
+    
+    // Returns the number of pages between page and the pages shown by the view.
+    int pageDistance(int page) const {
+        const int first = qMax(0, blockOfRow(qMin(firstRow, count() - 1)));
+        const int last = qMax(first, blockOfRow(qMin(lastRow, count() - 1)));
+        return page < first ? first - page : qMax(0, page - last);
+    }
+    
+    // Releases the items of the resident pages furthest from the pages shown by the view. Pages that are shown are 
+    // never released, even if there are more of them than windowSize.
+    void evictPages() {
+        if (!isWindowed()) {
+            return;
+        }
+        
+        Q_Q(ResourcesModel);
+        
+        int resident = 0;
+        
+        foreach (const ModelBlock &block, blocks) {
+            if (!block.released) {
+                resident++;
+            }
+        }
+        
+        while (resident > windowSize) {
+            int furthest = -1;
+            
+            for (int i = 0; i < blocks.size(); i++) {
+                if ((!blocks.at(i).released) && ((furthest < 0) || (pageDistance(i) > pageDistance(furthest)))) {
+                    furthest = i;
+                }
+            }
+            
+            if (pageDistance(furthest) == 0) {
+                return;
+            }
+            
+            const int first = blockOffsets.at(furthest);
+            const int last = first + blocks.at(furthest).count - 1;
+            releaseBlock(furthest);
+            resident--;
+#ifdef QYOUTUBE_DEBUG
+            qDebug() << "QYouTube::ResourcesModelPrivate::evictPages" << furthest << first << last;
+#endif
+            if (last >= first) {
+                emit q->dataChanged(q->index(first), q->index(last));
+            }
+        }
+    }
+    
+    // Records the rows shown by the view, starting a prefetch if needed, and queues the pages containing them to be 
+    // fetched again if they have been evicted.
+    void setViewport(int first, int last) {
+        firstRow = first;
+        lastRow = last;
+        
+        if ((count() > 0) && (last >= count() - 1)) {
+            startStall();
+        }
+        
+        if (shouldPrefetch()) {
+            schedulePrefetch();
+        }
+        
+        if (!isWindowed()) {
+            return;
+        }
+        
+        const int firstPage = blockOfRow(first);
+        const int lastPage = blockOfRow(qMin(last, count() - 1));
+        
+        if (firstPage < 0) {
+            return;
+        }
+        
+        for (int page = firstPage; page <= qMax(firstPage, lastPage); page++) {
+            if ((blocks.at(page).released) && (page != loadingPage) && (!pageQueue.contains(page))) {
+                pageQueue << page;
+            }
+        }
+        
+        if ((!pageQueue.isEmpty()) && (loadingPage < 0) && (!loadScheduled)) {
+            Q_Q(ResourcesModel);
+            
+            loadScheduled = true;
+            QTimer::singleShot(0, q, SLOT(_q_loadEvictedPages()));
+        }
+    }
+    
+    void _q_loadEvictedPages() {
+        loadScheduled = false;
+        
+        if (loadingPage >= 0) {
+            return;
+        }
+        
+        while (!pageQueue.isEmpty()) {
+            const int page = pageQueue.takeFirst();
+            
+            // Pages that the view has scrolled past are not fetched.
+            if ((page >= blocks.size()) || (!blocks.at(page).released) || (pageDistance(page) > 0)) {
+                continue;
+            }
+            
+            // The credentials may have been refreshed by the main request.
+            pageRequest->setApiKey(request->apiKey());
+            pageRequest->setClientId(request->clientId());
+            pageRequest->setClientSecret(request->clientSecret());
+            pageRequest->setAccessToken(request->accessToken());
+            pageRequest->setRefreshToken(request->refreshToken());
+            
+            QVariantMap pageParams = params;
+            
+            if (!pageTokens.at(page).isEmpty()) {
+                pageParams["pageToken"] = pageTokens.at(page);
+            }
+            
+            loadingPage = page;
+            pageRequest->list(resourcePath, part, filters, pageParams);
+#ifdef QYOUTUBE_DEBUG
+            qDebug() << "QYouTube::ResourcesModelPrivate::_q_loadEvictedPages" << page;
+#endif
+            return;
+        }
+    }
+    
+    void _q_onPageRequestFinished() {
+        const int page = loadingPage;
+        loadingPage = -1;
+        
+        if ((page >= 0) && (page < blocks.size()) && (blocks.at(page).released) && (isWindowed())
+            && (pageRequest->status() == ResourcesRequest::Ready)) {
+            Q_Q(ResourcesModel);
+            
+            // The rows of the page are kept, even if the number of items has changed since it was first fetched.
+            const QVariantList list = pageRequest->result().toMap().value("items").toList();
+            const int first = blockOffsets.at(page);
+            const int rows = blocks.at(page).count;
+            QList<QVariantMap> items;
+            
+            for (int i = 0; (i < rows) && (i < list.size()); i++) {
+                items << flatten(list.at(i).toMap());
+            }
+            
+            setBlock(page, items);
+            
+            if (rows > 0) {
+                emit q->dataChanged(q->index(first), q->index(first + rows - 1));
+            }
+            
+            evictPages();
+        }
+        
+        _q_loadEvictedPages();
+    }
+    
+    static QString fieldRoleName(const QString &path) {
+        return QString(path).replace(QLatin1Char('.'), QLatin1Char('_'));
+    }
+    
+    static QVariant fieldValue(const QVariantMap &item, const QString &path) {
+        const QStringList keys = path.split(QLatin1Char('.'));
+        QVariant value = item.value(keys.first());
+        
+        for (int i = 1; (i < keys.size()) && (value.isValid()); i++) {
+            value = value.toMap().value(keys.at(i));
+        }
+        
+        return value;
+    }
+    
+    // Creates the roles from the first item, or from the fields if they are set.
+    void setItemRoles(const QVariantMap &item) {
+        if (fields.isEmpty()) {
+            setRoleNames(item);
+            return;
+        }
+        
+        roles.clear();
+        int role = Qt::UserRole + 1;
+        
+        foreach (const QString &path, fields) {
+            roles[role] = fieldRoleName(path).toUtf8();
+            role++;
+        }
+        
+        // The id is needed to find the item when it is updated or deleted, and the etag to find changes on reload.
+        if (!fields.contains("id")) {
+            roles[role] = "id";
+            role++;
+        }
+        
+        if (!fields.contains("etag")) {
+            roles[role] = "etag";
+        }
+        
+        updateColumns();
+#if QT_VERSION < 0x050000
+        Q_Q(ResourcesModel);
+        
+        q->setRoleNames(roles);
+#endif
+    }
+    
+    // Extracts the value of each field from item, so that the rest of the item is not kept.
+    QVariantMap flatten(const QVariantMap &item) const {
+        if (fields.isEmpty()) {
+            return item;
+        }
+        
+        QVariantMap flat;
+        flat["id"] = item.value("id");
+        flat["etag"] = item.value("etag");
+        
+        foreach (const QString &path, fields) {
+            flat[fieldRoleName(path)] = fieldValue(item, path);
+        }
+        
+        return flat;
+    }
         
     void _q_onListRequestFinished() {
         if (!request) {
@@ -39,6 +590,8 @@ public:
         }
     
         Q_Q(ResourcesModel);
+        
+        fetchingPage = false;
     
         if (request->status() == ResourcesRequest::Ready) {
             QVariantMap result = request->result().toMap();
@@ -49,17 +602,19 @@ public:
                 const QVariantList list = result.value("items").toList();
             
                 if (!list.isEmpty()) {
-                    if (items.isEmpty()) {
-                        setRoleNames(list.first().toMap());
+                    if (count() == 0) {
+                        setItemRoles(list.first().toMap());
                     }
                     
-                    q->beginInsertRows(QModelIndex(), items.size(), items.size() + list.size() - 1);
+                    q->beginInsertRows(QModelIndex(), count(), count() + list.size() - 1);
+                    appendBlock();
                     
                     foreach (const QVariant &item, list) {
-                        items << item.toMap();
+                        appendItem(flatten(item.toMap()));
                     }
                     
                     q->endInsertRows();
+                    addPage(requestedPageToken);
                     emit q->countChanged(q->rowCount());
                 }
             }
@@ -68,6 +623,15 @@ public:
         ResourcesModel::disconnect(request, SIGNAL(finished()), q, SLOT(_q_onListRequestFinished()));
     
         emit q->statusChanged(request->status());
+        finishStall();
+        
+        // The next page is requested as soon as this one arrives, up to prefetchDepth pages ahead of the view.
+        if (request->status() == ResourcesRequest::Ready) {
+            schedulePrefetch();
+        }
+        else {
+            prefetching = false;
+        }
     }
     
     void _q_onInsertRequestFinished() {
@@ -81,12 +645,12 @@ public:
             const QVariantMap result = request->result().toMap();
         
             if (!result.isEmpty()) {
-                if (items.isEmpty()) {
-                    setRoleNames(result);
+                if (count() == 0) {
+                    setItemRoles(result);
                 }
                 
                 q->beginInsertRows(QModelIndex(), 0, 0);
-                items.prepend(result);
+                insertItem(0, flatten(result));
                 q->endInsertRows();
                 emit q->countChanged(q->rowCount());
             }
@@ -111,9 +675,9 @@ public:
                 const QVariant id = result.value("id");
                 
                 if (!id.isNull()) {
-                    for (int i = 0; i < items.size(); i++) {
-                        if (items.at(i).value("id") == id) {
-                            q->set(i, result);
+                    for (int i = 0; i < count(); i++) {
+                        if (itemValue(i, "id") == id) {
+                            q->set(i, flatten(result));
                             break;
                         }
                     }
@@ -135,10 +699,10 @@ public:
     
         if ((request->status() == ResourcesRequest::Ready) &&
             ((writeResourcePath == resourcePath) || (writeResourcePath.isEmpty()))) {
-            for (int i = 0; i < items.size(); i++) {
-                if (items.at(i).value("id") == delId) {
+            for (int i = 0; i < count(); i++) {
+                if (itemValue(i, "id") == delId) {
                     q->beginRemoveRows(QModelIndex(), i, i);
-                    items.removeAt(i);
+                    removeItem(i);
                     q->endRemoveRows();
                     emit q->countChanged(q->rowCount());
                     break;
@@ -159,8 +723,46 @@ public:
     QVariantMap params;
     QString writeResourcePath;
     QString delId;
+    
+    QStringList fields;
         
     QString nextPageToken;
+    QString requestedPageToken;
+    
+    ResourcesRequest *pageRequest;
+    
+    int windowSize;
+    
+    QStringList pageTokens;
+    QList<int> pageQueue;
+    
+    int loadingPage;
+    bool loadScheduled;
+    
+    // The rows shown by the view, set with setViewport().
+    int firstRow;
+    int lastRow;
+    
+    bool fetchingPage;
+    
+    int prefetchDistance;
+    int prefetchDepth;
+    bool prefetching;
+    bool prefetchScheduled;
+    
+    QElapsedTimer stallTimer;
+    qint64 stallTime;
+    int stallCount;
+    
+    bool incrementalReload;
+    
+    bool reloading;
+    
+    QVariantList reloadItems;
+    QStringList reloadPageTokens;
+    QVector<int> reloadPageSizes;
+    QString reloadPageToken;
+    int reloadCount;
     
     Q_DECLARE_PUBLIC(ResourcesModel)
 };
@@ -181,6 +783,10 @@ public:
     are created by iterating through the keys of the first item in alphabetical order, starting at Qt::UserRole + 1.
     The role names are the keys themselves.
     
+    Alternatively, the fields property can be set to the paths of the values that are needed, such as 
+    "snippet.title". Each value is then extracted into its own role when an item is added, and the rest of the item 
+    is discarded, so delegates only read the values they use. See fields for details.
+    
     Example usage:
     
     C++
@@ -239,6 +845,8 @@ ResourcesModel::ResourcesModel(QObject *parent) :
     Q_D(ResourcesModel);
 
     d->request = new ResourcesRequest(this);
+    d->pageRequest = new ResourcesRequest(this);
+    connect(d->pageRequest, SIGNAL(finished()), this, SLOT(_q_onPageRequestFinished()));
     connect(d->request, SIGNAL(apiKeyChanged()), this, SIGNAL(apiKeyChanged()));
     connect(d->request, SIGNAL(clientIdChanged()), this, SIGNAL(clientIdChanged()));
     connect(d->request, SIGNAL(clientSecretChanged()), this, SIGNAL(clientSecretChanged()));
@@ -422,12 +1030,320 @@ QString ResourcesModel::errorString() const {
     return d->request->errorString();
 }
 
+/*!
+    \property QStringList ResourcesModel::fields
+    \brief The paths of the values that are stored for each item.
+    
+    Each path is a dot-separated list of keys, such as "snippet.title", "snippet.thumbnails.medium.url" or 
+    "contentDetails.duration". When the fields are set, the roles are created from the paths in the order given, 
+    starting at Qt::UserRole + 1, and each role name is its path with the dots replaced by underscores. The id of 
+    each item is always stored in the "id" role, so that items can be updated and deleted, and the etag in the "etag" 
+    role.
+    
+    \code
+    ResourcesModel {
+        id: resourcesModel
+        
+        fields: ["snippet.title", "snippet.thumbnails.medium.url", "contentDetails.duration"]
+    }
+    
+    ...
+    
+    delegate: Text {
+        text: snippet_title + " (" + contentDetails_duration + ")"
+    }
+    \endcode
+    
+    Only the values of the fields are kept, so get() returns an item containing the flattened values. The fields 
+    should be set before calling list(), and changing them clears the model.
+    
+    The default value is an empty list, in which case each item is stored as it is received.
+*/
+
+/*!
+    \fn void ResourcesModel::fieldsChanged()
+    \brief Emitted when the fields change.
+*/
+QStringList ResourcesModel::fields() const {
+    Q_D(const ResourcesModel);
+    
+    return d->fields;
+}
+
+void ResourcesModel::setFields(const QStringList &f) {
+    Q_D(ResourcesModel);
+    
+    if (f != d->fields) {
+        clear();
+        d->resetPages();
+        d->fields = f;
+        emit fieldsChanged();
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::ResourcesModel::setFields" << f;
+#endif
+}
+
+/*!
+    \property int ResourcesModel::windowSize
+    \brief The maximum number of pages whose items are kept in memory.
+    
+    When windowSize is greater than 0, the model remembers the page token used to fetch each page. If more than 
+    windowSize pages are held, the items of the pages furthest from the rows passed to setViewport() are released, 
+    while their rows remain in the model. When a released page is shown by the view again, it is fetched again 
+    using its page token, and dataChanged() is emitted for its rows when it arrives. If a ResponseCache is set, the 
+    page is revalidated using its ETag rather than downloaded again.
+    
+    The items of each page are stored together, and a released page keeps only its page token and number of rows. 
+    This keeps the memory used by long lists, such as the items of a large playlist, roughly constant however far 
+    the list is scrolled. The values of rows in released pages are invalid until the page is fetched.
+    
+    The default value is 0, meaning that all pages are kept.
+    
+    \sa setResponseCache()
+*/
+
+/*!
+    \fn void ResourcesModel::windowSizeChanged()
+    \brief Emitted when the windowSize changes.
+*/
+int ResourcesModel::windowSize() const {
+    Q_D(const ResourcesModel);
+    
+    return d->windowSize;
+}
+
+void ResourcesModel::setWindowSize(int size) {
+    Q_D(ResourcesModel);
+    
+    size = qMax(0, size);
+    
+    if (size != d->windowSize) {
+        d->windowSize = size;
+        d->evictPages();
+        emit windowSizeChanged();
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::ResourcesModel::setWindowSize" << size;
+#endif
+}
+
+/*!
+    \property int ResourcesModel::prefetchDistance
+    \brief The number of rows before the end of the model at which the next page is fetched.
+    
+    When prefetchDistance is greater than 0 and setViewport() is called with a last row less than prefetchDistance 
+    rows from the end, the next page is fetched without waiting for the view to call fetchMore(). Further pages are then fetched as 
+    soon as each one arrives, until prefetchDepth pages are ahead of the page being viewed.
+    
+    The default value is 0, meaning that pages are only fetched when fetchMore() is called.
+    
+    \sa prefetchDepth, stallTime
+*/
+
+/*!
+    \fn void ResourcesModel::prefetchDistanceChanged()
+    \brief Emitted when the prefetchDistance changes.
+*/
+int ResourcesModel::prefetchDistance() const {
+    Q_D(const ResourcesModel);
+    
+    return d->prefetchDistance;
+}
+
+void ResourcesModel::setPrefetchDistance(int distance) {
+    Q_D(ResourcesModel);
+    
+    distance = qMax(0, distance);
+    
+    if (distance != d->prefetchDistance) {
+        d->prefetchDistance = distance;
+        emit prefetchDistanceChanged();
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::ResourcesModel::setPrefetchDistance" << distance;
+#endif
+}
+
+/*!
+    \property int ResourcesModel::prefetchDepth
+    \brief The maximum number of pages fetched ahead of the page being viewed.
+    
+    The default value is 1.
+    
+    \sa prefetchDistance
+*/
+
+/*!
+    \fn void ResourcesModel::prefetchDepthChanged()
+    \brief Emitted when the prefetchDepth changes.
+*/
+int ResourcesModel::prefetchDepth() const {
+    Q_D(const ResourcesModel);
+    
+    return d->prefetchDepth;
+}
+
+void ResourcesModel::setPrefetchDepth(int depth) {
+    Q_D(ResourcesModel);
+    
+    depth = qMax(1, depth);
+    
+    if (depth != d->prefetchDepth) {
+        d->prefetchDepth = depth;
+        emit prefetchDepthChanged();
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::ResourcesModel::setPrefetchDepth" << depth;
+#endif
+}
+
+/*!
+    \property qint64 ResourcesModel::stallTime
+    \brief The total time in milliseconds for which the view has waited for a page.
+    
+    A stall begins when setViewport() is called with the last row of the model while another page is being fetched or is 
+    available, and ends when the page arrives. It can be compared with stallCount to tune prefetchDistance.
+    
+    \sa stallCount
+*/
+
+/*!
+    \property int ResourcesModel::stallCount
+    \brief The number of times the view has waited for a page.
+    
+    \sa stallTime
+*/
+
+/*!
+    \fn void ResourcesModel::stallTimeChanged()
+    \brief Emitted when the stallTime and stallCount change.
+*/
+qint64 ResourcesModel::stallTime() const {
+    Q_D(const ResourcesModel);
+    
+    return d->stallTime;
+}
+
+int ResourcesModel::stallCount() const {
+    Q_D(const ResourcesModel);
+    
+    return d->stallCount;
+}
+
+/*!
+    \property bool ResourcesModel::incrementalReload
+    \brief Whether reload() updates the existing items rather than resetting the model.
+    
+    When incrementalReload is true, reload() fetches as many pages as are needed to cover the existing items, and 
+    compares the new items with the existing ones by their id. Only the changes are signalled: rows that are no longer 
+    present are removed, rows whose position has changed are moved, new rows are inserted, and dataChanged() is 
+    emitted for rows whose etag has changed. Rows with an unchanged etag are left untouched, so delegates and the 
+    scroll position of the view are kept.
+    
+    The default value is false.
+    
+    \sa reload()
+*/
+
+/*!
+    \fn void ResourcesModel::incrementalReloadChanged()
+    \brief Emitted when incrementalReload changes.
+*/
+bool ResourcesModel::incrementalReload() const {
+    Q_D(const ResourcesModel);
+    
+    return d->incrementalReload;
+}
+
+void ResourcesModel::setIncrementalReload(bool enabled) {
+    Q_D(ResourcesModel);
+    
+    if (enabled != d->incrementalReload) {
+        d->incrementalReload = enabled;
+        emit incrementalReloadChanged();
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::ResourcesModel::setIncrementalReload" << enabled;
+#endif
+}
+
+/*!
+    \brief Sets the rows shown by the view to \a first to \a last.
+    
+    The view should call this method whenever it scrolls. If \a last is within prefetchDistance rows of the end, the 
+    next page is fetched, and any pages between \a first and \a last that have been released are fetched again. 
+    Pages are released in order of their distance from these rows.
+    
+    The rows are not taken from data(), since proxy models, match() and other callers read rows that are not shown.
+    
+    \code
+    ListView {
+        id: view
+        
+        model: ResourcesModel {
+            id: resourcesModel
+            
+            windowSize: 5
+            prefetchDistance: 20
+        }
+        onContentYChanged: resourcesModel.setViewport(indexAt(0, contentY),
+                                                      indexAt(0, contentY + height - 1))
+    }
+    \endcode
+    
+    \sa viewportFirst, viewportLast, prefetchDistance, windowSize
+*/
+void ResourcesModel::setViewport(int first, int last) {
+    Q_D(ResourcesModel);
+    
+    first = qMax(0, first);
+    last = qMax(first, last);
+    
+    const bool changed = (first != d->firstRow) || (last != d->lastRow);
+    d->setViewport(first, last);
+    
+    if (changed) {
+        emit viewportChanged();
+    }
+}
+
+/*!
+    \property int ResourcesModel::viewportFirst
+    \brief The first row shown by the view, as set by setViewport().
+    
+    The default value is 0.
+*/
+
+/*!
+    \property int ResourcesModel::viewportLast
+    \brief The last row shown by the view, as set by setViewport().
+    
+    The default value is 0.
+*/
+
+/*!
+    \fn void ResourcesModel::viewportChanged()
+    \brief Emitted when viewportFirst or viewportLast changes.
+*/
+int ResourcesModel::viewportFirst() const {
+    Q_D(const ResourcesModel);
+    
+    return d->firstRow;
+}
+
+int ResourcesModel::viewportLast() const {
+    Q_D(const ResourcesModel);
+    
+    return d->lastRow;
+}
+
 /*!
     \brief Sets the QNetworkAccessManager instance to be used when making requests to the YouTube Data API.
     
     ResourcesModel does not take ownership of \a manager.
     
-    If no QNetworkAccessManager is set, one will be created when required.
+    If no QNetworkAccessManager is set, the manager shared by all requests in the current thread is used.
     
     \sa ResourcesRequest::setNetworkAccessManager()
 */
@@ -435,6 +1351,49 @@ void ResourcesModel::setNetworkAccessManager(QNetworkAccessManager *manager) {
     Q_D(ResourcesModel);
     
     d->request->setNetworkAccessManager(manager);
+    d->pageRequest->setNetworkAccessManager(manager);
+}
+
+/*!
+    \brief Sets the ResponseCache used to store the results of HTTP GET requests to \a cache.
+    
+    ResourcesModel does not take ownership of \a cache.
+    
+    \sa ResourcesRequest::setResponseCache()
+*/
+void ResourcesModel::setResponseCache(ResponseCache *cache) {
+    Q_D(ResourcesModel);
+    
+    d->request->setResponseCache(cache);
+    d->pageRequest->setResponseCache(cache);
+}
+
+/*!
+    \brief Sets the RetryPolicy used to retry failed HTTP requests to \a policy.
+    
+    ResourcesModel does not take ownership of \a policy.
+    
+    \sa ResourcesRequest::setRetryPolicy()
+*/
+void ResourcesModel::setRetryPolicy(RetryPolicy *policy) {
+    Q_D(ResourcesModel);
+    
+    d->request->setRetryPolicy(policy);
+    d->pageRequest->setRetryPolicy(policy);
+}
+
+/*!
+    \brief Sets the QuotaTracker used to account for the quota used by requests to \a tracker.
+    
+    ResourcesModel does not take ownership of \a tracker.
+    
+    \sa ResourcesRequest::setQuotaTracker()
+*/
+void ResourcesModel::setQuotaTracker(QuotaTracker *tracker) {
+    Q_D(ResourcesModel);
+    
+    d->request->setQuotaTracker(tracker);
+    d->pageRequest->setQuotaTracker(tracker);
 }
 
 bool ResourcesModel::canFetchMore(const QModelIndex &) const {
@@ -453,6 +1412,8 @@ void ResourcesModel::fetchMore(const QModelIndex &) {
         
         QVariantMap params = d->params;
         params["pageToken"] = d->nextPageToken;
+        d->requestedPageToken = d->nextPageToken;
+        d->fetchingPage = true;
         
         connect(d->request, SIGNAL(finished()), this, SLOT(_q_onListRequestFinished()));
         d->request->list(d->resourcePath, d->part, d->filters, params);
@@ -470,6 +1431,10 @@ void ResourcesModel::list(const QString &resourcePath, const QStringList &part,
     if (status() != ResourcesRequest::Loading) {
         Q_D(ResourcesModel);
         clear();
+        d->resetPages();
+        d->requestedPageToken = QString();
+        d->fetchingPage = true;
+        d->prefetching = false;
         d->resourcePath = resourcePath;
         d->part = part;
         d->filters = filters;
@@ -511,12 +1476,23 @@ void ResourcesModel::insert(int row, const QString &resourcePath, const QStringL
 
 /*!
     \brief Updates the YouTube resource at \a row with \a resource.
+    
+    If fields are set, only the id of the stored item is added to \a resource, so \a resource should contain every 
+    value of the parts being updated.
 */
 void ResourcesModel::update(int row, const QVariantMap &resource, const QStringList &part) {    
     if (status() != ResourcesRequest::Loading) {
         Q_D(ResourcesModel);
         d->writeResourcePath = d->resourcePath;
-        QVariantMap item = get(row);
+        QVariantMap item;
+        
+        if (d->fields.isEmpty()) {
+            item = get(row);
+        }
+        else {
+            item["id"] = d->itemValue(row, "id");
+        }
+        
         QMapIterator<QString, QVariant> iterator(resource);
         
         while (iterator.hasNext()) {
@@ -573,11 +1549,41 @@ void ResourcesModel::cancel() {
 
 /*!
     \brief Clears any existing data and retreives a new list of YouTube resources using the existing parameters.
+    
+    If incrementalReload is true, the existing data is not cleared. Instead, the new list is compared with the 
+    existing items when it arrives.
+    
+    \sa incrementalReload
 */
 void ResourcesModel::reload() {
     if (status() != ResourcesRequest::Loading) {
         Q_D(ResourcesModel);
+        
+        bool resident = true;
+        
+        foreach (const ModelBlock &block, d->blocks) {
+            resident = resident && (!block.released);
+        }
+        
+        // Items released by the window cannot be compared, so the model is reset instead.
+        if ((d->incrementalReload) && (rowCount() > 0) && (resident)) {
+            d->reloadItems.clear();
+            d->reloadPageTokens.clear();
+            d->reloadPageSizes.clear();
+            d->reloading = true;
+            d->reloadCount = rowCount();
+            d->pageQueue.clear();
+            d->prefetching = false;
+            d->requestReloadPage(QString());
+            emit statusChanged(d->request->status());
+            return;
+        }
+        
         clear();
+        d->resetPages();
+        d->requestedPageToken = QString();
+        d->fetchingPage = true;
+        d->prefetching = false;
         connect(d->request, SIGNAL(finished()), this, SLOT(_q_onListRequestFinished()));
         d->request->list(d->resourcePath, d->part, d->filters, d->params);
         emit statusChanged(d->request->status());
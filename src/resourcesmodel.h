@@ -38,6 +38,16 @@ class QYOUTUBESHARED_EXPORT ResourcesModel : public Model
     Q_PROPERTY(QVariant result READ result NOTIFY statusChanged)
     Q_PROPERTY(QYouTube::ResourcesRequest::Error error READ error NOTIFY statusChanged)
     Q_PROPERTY(QString errorString READ errorString NOTIFY statusChanged)
+    Q_PROPERTY(QStringList fields READ fields WRITE setFields NOTIFY fieldsChanged)
+    Q_PROPERTY(int windowSize READ windowSize WRITE setWindowSize NOTIFY windowSizeChanged)
+    Q_PROPERTY(int prefetchDistance READ prefetchDistance WRITE setPrefetchDistance NOTIFY prefetchDistanceChanged)
+    Q_PROPERTY(int prefetchDepth READ prefetchDepth WRITE setPrefetchDepth NOTIFY prefetchDepthChanged)
+    Q_PROPERTY(qint64 stallTime READ stallTime NOTIFY stallTimeChanged)
+    Q_PROPERTY(int stallCount READ stallCount NOTIFY stallTimeChanged)
+    Q_PROPERTY(bool incrementalReload READ incrementalReload WRITE setIncrementalReload
+               NOTIFY incrementalReloadChanged)
+    Q_PROPERTY(int viewportFirst READ viewportFirst NOTIFY viewportChanged)
+    Q_PROPERTY(int viewportLast READ viewportLast NOTIFY viewportChanged)
                 
 public: 
     explicit ResourcesModel(QObject *parent = 0);
@@ -64,8 +74,35 @@ public:
     ResourcesRequest::Error error() const;
     QString errorString() const;
     
+    QStringList fields() const;
+    void setFields(const QStringList &f);
+    
+    int windowSize() const;
+    void setWindowSize(int size);
+    
+    int prefetchDistance() const;
+    void setPrefetchDistance(int distance);
+    
+    int prefetchDepth() const;
+    void setPrefetchDepth(int depth);
+    
+    qint64 stallTime() const;
+    int stallCount() const;
+    
+    bool incrementalReload() const;
+    void setIncrementalReload(bool enabled);
+    
+    int viewportFirst() const;
+    int viewportLast() const;
+    
     void setNetworkAccessManager(QNetworkAccessManager *manager);
     
+    void setResponseCache(ResponseCache *cache);
+    
+    void setRetryPolicy(RetryPolicy *policy);
+    
+    void setQuotaTracker(QuotaTracker *tracker);
+    
     bool canFetchMore(const QModelIndex &parent = QModelIndex()) const;
     Q_INVOKABLE void fetchMore(const QModelIndex &parent = QModelIndex());
     
@@ -87,6 +124,8 @@ public Q_SLOTS:
     void cancel();
     void reload();
     
+    void setViewport(int first, int last);
+    
 Q_SIGNALS:
     void apiKeyChanged();
     void clientIdChanged();
@@ -94,6 +133,13 @@ Q_SIGNALS:
     void accessTokenChanged(const QString &token);
     void refreshTokenChanged(const QString &token);
     void statusChanged(QYouTube::ResourcesRequest::Status s);
+    void fieldsChanged();
+    void windowSizeChanged();
+    void prefetchDistanceChanged();
+    void prefetchDepthChanged();
+    void stallTimeChanged();
+    void incrementalReloadChanged();
+    void viewportChanged();
     
 private:        
     Q_DECLARE_PRIVATE(ResourcesModel)
@@ -103,6 +149,10 @@ private:
     Q_PRIVATE_SLOT(d_func(), void _q_onInsertRequestFinished())
     Q_PRIVATE_SLOT(d_func(), void _q_onUpdateRequestFinished())
     Q_PRIVATE_SLOT(d_func(), void _q_onDeleteRequestFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_onPageRequestFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_loadEvictedPages())
+    Q_PRIVATE_SLOT(d_func(), void _q_prefetch())
+    Q_PRIVATE_SLOT(d_func(), void _q_onReloadRequestFinished())
 };
 
 }
@@ -84,6 +84,20 @@ namespace QYouTube {
     }
     \endcode
     
+    If a QuotaTracker is set, the quota cost of each call is charged to it before the request is made.
+    
+    In C++, the result can also be decoded into typed resources using resultItems() or operationResultItems(). If
+    lazyResult is true, the fields are decoded directly from the response text, which avoids creating a QVariant for 
+    each value when many items are processed:
+    
+    \code
+    request.setLazyResult(true);
+    ...
+    foreach (const Video &video, request.resultItems<Video>()) {
+        qDebug() << video.id << video.title << video.viewCount;
+    }
+    \endcode
+    
     For more details about YouTube resources, see the YouTube reference documentation 
     <a target="_blank" href="https://developers.google.com/youtube/v3/docs">here</a>.
 */
@@ -92,6 +106,31 @@ ResourcesRequest::ResourcesRequest(QObject *parent) :
 {
 }
 
+ResourcesRequest::ResourcesRequest(RequestPrivate &dd, QObject *parent) :
+    Request(dd, parent)
+{
+}
+
+/*!
+    \fn QList<T> ResourcesRequest::resultItems() const
+    \brief Returns the result decoded as a list of resources of type T.
+    
+    T can be Video, Channel, Playlist, PlaylistItem, SearchResult or Comment. The result of a list() call is decoded 
+    as its items, and the result of an insert() or update() call as a single resource.
+    
+    If lazyResult is true, the resources are decoded directly from the response text, and no QVariant is built for 
+    the result. Otherwise, they are decoded from result().
+    
+    \sa decodeResources(), Request::lazyResult
+*/
+
+/*!
+    \fn QList<T> ResourcesRequest::operationResultItems(int id) const
+    \brief Returns the result of the operation identified by \a id decoded as a list of resources of type T.
+    
+    \sa resultItems(), Request::concurrent
+*/
+
 /*!
     \brief Requests a list of YouTube resources from \a resourcePath.
     
@@ -106,42 +145,22 @@ ResourcesRequest::ResourcesRequest(QObject *parent) :
     params["type"] = "video";
     request.list("/videos", QStringList() << "snippet", QVariantMap(), params);
     \endcode
-*/
-void ResourcesRequest::list(const QString &resourcePath, const QStringList &part, const QVariantMap &filters,
-                            const QVariantMap &params) {
-    if (status() == Loading) {
-        return;
-    }
     
-    QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
-                            .arg(resourcePath));
-#if QT_VERSION >= 0x050000
-    QUrlQuery query(u);
-    query.addQueryItem("part", part.join(","));
-    
-    if (!filters.isEmpty()) {
-        addUrlQueryItems(&query, filters);
-    }
-    
-    if (!params.isEmpty()) {
-        addUrlQueryItems(&query, params);
-    }
-    
-    u.setQuery(query);
-#else
-    u.addQueryItem("part", part.join(","));
+    Returns the id of the operation if concurrent is true, otherwise 0.
     
-    if (!filters.isEmpty()) {
-        addUrlQueryItems(&u, filters);
+    \sa Request::concurrent
+*/
+int ResourcesRequest::list(const QString &resourcePath, const QStringList &part, const QVariantMap &filters,
+                           const QVariantMap &params) {
+    if ((!isConcurrent()) && (status() == Loading)) {
+        return 0;
     }
     
-    if (!params.isEmpty()) {
-        addUrlQueryItems(&u, params);
-    }
-#endif
+    const QUrl u = resourcesUrl(resourcePath, part, filters, params);
     setUrl(u);
     setData(QVariant());
-    get();
+    Q_D(Request);
+    return d->admitRequest(GetOperation, resourcePath);
 }
 
 /*!
@@ -161,11 +180,13 @@ void ResourcesRequest::list(const QString &resourcePath, const QStringList &part
     playlist["status"] = status;
     request.insert(playlist, "/playlists", QStringList() << "snippet" << "status");
     \endcode
+    
+    Returns the id of the operation if concurrent is true, otherwise 0.
 */
-void ResourcesRequest::insert(const QVariantMap &resource, const QString &resourcePath, const QStringList &part,
-                              const QVariantMap &params) {
-    if (status() == Loading) {
-        return;
+int ResourcesRequest::insert(const QVariantMap &resource, const QString &resourcePath, const QStringList &part,
+                             const QVariantMap &params) {
+    if ((!isConcurrent()) && (status() == Loading)) {
+        return 0;
     }
     
     QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
@@ -188,7 +209,8 @@ void ResourcesRequest::insert(const QVariantMap &resource, const QString &resour
 #endif
     setUrl(u);
     setData(resource);
-    post();
+    Q_D(Request);
+    return d->admitRequest(PostOperation, resourcePath);
 }
 
 /*!
@@ -206,10 +228,12 @@ void ResourcesRequest::insert(const QVariantMap &resource, const QString &resour
     playlist["id"] = PLAYLIST_ID;
     request.update("/playlists", playlist, QStringList() << "snippet");
     \endcode
+    
+    Returns the id of the operation if concurrent is true, otherwise 0.
 */
-void ResourcesRequest::update(const QString &resourcePath, const QVariantMap &resource, const QStringList &part) {
-    if (status() == Loading) {
-        return;
+int ResourcesRequest::update(const QString &resourcePath, const QVariantMap &resource, const QStringList &part) {
+    if ((!isConcurrent()) && (status() == Loading)) {
+        return 0;
     }
     
     QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
@@ -223,7 +247,8 @@ void ResourcesRequest::update(const QString &resourcePath, const QVariantMap &re
 #endif
     setUrl(u);
     setData(resource);
-    put();
+    Q_D(Request);
+    return d->admitRequest(PutOperation, resourcePath);
 }
 
 /*!
@@ -235,10 +260,12 @@ void ResourcesRequest::update(const QString &resourcePath, const QVariantMap &re
     ResourcesRequest request;
     request.del(FAVOURITE_PLAYLIST_ITEM_ID, "/playlistItems");
     \endcode
+    
+    Returns the id of the operation if concurrent is true, otherwise 0.
 */
-void ResourcesRequest::del(const QString &id, const QString &resourcePath) {
-    if (status() == Loading) {
-        return;
+int ResourcesRequest::del(const QString &id, const QString &resourcePath) {
+    if ((!isConcurrent()) && (status() == Loading)) {
+        return 0;
     }
     
     QUrl u(QString("%1%2%3").arg(API_URL).arg(resourcePath.startsWith("/") ? QString() : QString("/"))
@@ -252,7 +279,8 @@ void ResourcesRequest::del(const QString &id, const QString &resourcePath) {
 #endif
     setUrl(u);
     setData(QVariant());
-    deleteResource();
+    Q_D(Request);
+    return d->admitRequest(DeleteOperation, resourcePath);
 }
 
 }
@@ -17,7 +17,9 @@
 #ifndef QYOUTUBE_RESOURCESREQUEST_H
 #define QYOUTUBE_RESOURCESREQUEST_H
 
+#include "json.h"
 #include "request.h"
+#include "resources.h"
 
 namespace QYouTube {
 
@@ -28,16 +30,49 @@ class QYOUTUBESHARED_EXPORT ResourcesRequest : public Request
 public:
     explicit ResourcesRequest(QObject *parent = 0);
     
+    template <typename T>
+    QList<T> resultItems() const {
+        QList<T> items;
+        const QtJson::JsonValue value = resultValue();
+        
+        if (value.isUndefined()) {
+            decodeResources(result(), items);
+        }
+        else {
+            decodeResources(value, items);
+        }
+        
+        return items;
+    }
+    
+    template <typename T>
+    QList<T> operationResultItems(int id) const {
+        QList<T> items;
+        const QtJson::JsonValue value = operationResultValue(id);
+        
+        if (value.isUndefined()) {
+            decodeResources(operationResult(id), items);
+        }
+        else {
+            decodeResources(value, items);
+        }
+        
+        return items;
+    }
+    
 public Q_SLOTS:
-    void list(const QString &resourcePath, const QStringList &part, const QVariantMap &filters = QVariantMap(),
-              const QVariantMap &params = QVariantMap());
+    int list(const QString &resourcePath, const QStringList &part, const QVariantMap &filters = QVariantMap(),
+             const QVariantMap &params = QVariantMap());
         
-    void insert(const QVariantMap &resource, const QString &resourcePath, const QStringList &part,
-                const QVariantMap &params = QVariantMap());
+    int insert(const QVariantMap &resource, const QString &resourcePath, const QStringList &part,
+               const QVariantMap &params = QVariantMap());
+    
+    int update(const QString &resourcePath, const QVariantMap &resource, const QStringList &part);
     
-    void update(const QString &resourcePath, const QVariantMap &resource, const QStringList &part);
+    int del(const QString &id, const QString &resourcePath);
     
-    void del(const QString &id, const QString &resourcePath);
+protected:
+    ResourcesRequest(RequestPrivate &dd, QObject *parent = 0);
     
 private:
     Q_DISABLE_COPY(ResourcesRequest)
@@ -0,0 +1,551 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "responsecache_p.h"
+#include "json.h"
+#include <QMutexLocker>
+#include <QStringList>
+#include <QUrl>
+#if QT_VERSION >= 0x050000
+#include <QUrlQuery>
+#endif
+#ifdef QYOUTUBE_DEBUG
+#include <QDebug>
+#endif
+
+namespace QYouTube {
+
+/*!
+    \class ResponseCache
+    \brief An in-memory cache of parsed responses to HTTP GET requests.
+
+    \ingroup requests
+
+    ResponseCache stores the parsed result of each HTTP GET request together with the ETag returned by the YouTube
+    Data API. When a request is repeated, the ETag is sent in the If-None-Match header, and if the resource is
+    unchanged, the API responds with 304 Not Modified and the cached result is used without downloading or parsing
+    the response again.
+
+    Requests store the raw JSON response rather than the parsed result, so that a cached page uses far less memory.
+    The response is parsed when the entry is first used, outside the lock shared by other threads, and the parsed
+    result is kept for later use. Requests with Request::lazyResult enabled use the raw response directly, without
+    parsing it.
+
+    Entries are keyed by the request URL, ignoring the order of query items and the 'key' and 'access_token' query
+    items. The least recently used entries are removed when either maximumSize or maximumCount is exceeded.
+
+    A single ResponseCache can be shared between any number of requests and models, including those in different
+    threads:
+
+    \code
+    ResponseCache *cache = new ResponseCache;
+    cache->setMaximumSize(20 * 1024 * 1024);
+
+    ResourcesRequest *request = new ResourcesRequest(this);
+    request->setResponseCache(cache);
+
+    ResourcesModel *model = new ResourcesModel(this);
+    model->setResponseCache(cache);
+    \endcode
+
+    \sa Request::setResponseCache()
+*/
+ResponseCache::ResponseCache() :
+    d_ptr(new ResponseCachePrivate(this))
+{
+}
+
+ResponseCache::ResponseCache(ResponseCachePrivate &dd) :
+    d_ptr(&dd)
+{
+}
+
+ResponseCache::~ResponseCache() {
+    clear();
+}
+
+/*!
+    \brief Returns the maximum size of the cache in bytes.
+
+    The size of each entry is the size of its raw response, plus an estimate of the memory used by its parsed result
+    once the entry has been used.
+
+    The default value is 5242880 (5MB).
+*/
+int ResponseCache::maximumSize() const {
+    Q_D(const ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->maximumSize;
+}
+
+/*!
+    \brief Sets the maximum size of the cache in bytes to \a size.
+*/
+void ResponseCache::setMaximumSize(int size) {
+    Q_D(ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->maximumSize = qMax(0, size);
+    d->trim();
+}
+
+/*!
+    \brief Returns the maximum number of entries in the cache.
+
+    The default value is 100.
+*/
+int ResponseCache::maximumCount() const {
+    Q_D(const ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->maximumCount;
+}
+
+/*!
+    \brief Sets the maximum number of entries in the cache to \a count.
+*/
+void ResponseCache::setMaximumCount(int count) {
+    Q_D(ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->maximumCount = qMax(0, count);
+    d->trim();
+}
+
+/*!
+    \brief Returns the current size of the cache in bytes.
+*/
+int ResponseCache::size() const {
+    Q_D(const ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->size;
+}
+
+/*!
+    \brief Returns the number of entries in the cache.
+*/
+int ResponseCache::count() const {
+    Q_D(const ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->nodes.size();
+}
+
+/*!
+    \brief Returns the number of responses that were served from the cache.
+*/
+qint64 ResponseCache::hitCount() const {
+    Q_D(const ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->hits;
+}
+
+/*!
+    \brief Returns the number of responses that had to be downloaded in full and were added to the cache.
+*/
+qint64 ResponseCache::missCount() const {
+    Q_D(const ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->misses;
+}
+
+/*!
+    \brief Resets the hit and miss counters to zero.
+*/
+void ResponseCache::resetStatistics() {
+    Q_D(ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->hits = 0;
+    d->misses = 0;
+}
+
+/*!
+    \brief Returns the ETag of the cached response for \a url.
+
+    If there is no cached response for \a url, an empty QByteArray is returned.
+*/
+QByteArray ResponseCache::etag(const QUrl &url) {
+    Q_D(ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    if (ResponseCacheNode *n = d->node(cacheKey(url))) {
+        return n->etag;
+    }
+
+    return QByteArray();
+}
+
+/*!
+    \brief Retrieves the cached result for \a url.
+
+    This method is called when the YouTube Data API reports that the resource at \a url has not been modified.
+
+    Returns true if \a result was found in the cache.
+*/
+bool ResponseCache::find(const QUrl &url, QVariant &result) {
+    Q_D(ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->findResult(cacheKey(url), result, locker);
+}
+
+/*!
+    \brief Retrieves the cached raw JSON response for \a url.
+
+    This method is called instead of find() by requests with Request::lazyResult enabled, so that the response is not
+    parsed.
+
+    Returns false if there is no cached response for \a url, or if only its parsed result is cached.
+*/
+bool ResponseCache::findResponse(const QUrl &url, QByteArray &response) {
+    Q_D(ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->findResponse(cacheKey(url), response);
+}
+
+/*!
+    \brief Adds \a result to the cache for \a url, replacing any existing entry.
+*/
+void ResponseCache::insert(const QUrl &url, const QByteArray &etag, const QVariant &result) {
+    Q_D(ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->insertNode(cacheKey(url), etag, result);
+    d->misses++;
+}
+
+/*!
+    \brief Adds \a result to the cache for \a url, replacing any existing entry.
+
+    \a response is the raw JSON from which \a result was parsed. The cache keeps \a response instead of \a result,
+    which typically uses an order of magnitude less memory, and parses it when the entry is first used. \a result
+    may be invalid if the response has not been parsed. If \a response is empty, this is the same as insert().
+
+    The default implementation does not call insert(). Subclasses that reimplement insert() should also reimplement
+    this method.
+*/
+void ResponseCache::insertResponse(const QUrl &url, const QByteArray &etag, const QVariant &result,
+                                   const QByteArray &response) {
+    Q_D(ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->insertNode(cacheKey(url), etag, result, response);
+    d->misses++;
+}
+
+/*!
+    \brief Removes the cached result for \a url.
+*/
+void ResponseCache::remove(const QUrl &url) {
+    Q_D(ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    if (ResponseCacheNode *n = d->nodes.value(cacheKey(url))) {
+        d->removeNode(n);
+    }
+}
+
+/*!
+    \brief Removes all entries from the cache.
+*/
+void ResponseCache::clear() {
+    Q_D(ResponseCache);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->clearNodes();
+}
+
+/*!
+    \brief Returns the key used to store the response for \a url.
+
+    The key consists of the URL without the query, followed by the query items sorted by name. The 'key' and
+    'access_token' query items are omitted.
+*/
+QString ResponseCache::cacheKey(const QUrl &url) {
+#if QT_VERSION >= 0x050000
+    QList< QPair<QString, QString> > items = QUrlQuery(url).queryItems(QUrl::FullyDecoded);
+    QUrl u(url);
+    u.setQuery(QString());
+    u.setFragment(QString());
+#else
+    QList< QPair<QString, QString> > items = url.queryItems();
+    QUrl u(url);
+    u.setEncodedQuery(QByteArray());
+    u.setFragment(QString());
+#endif
+    qSort(items);
+
+    QString key = u.toString();
+    QChar separator('?');
+
+    for (int i = 0; i < items.size(); i++) {
+        const QPair<QString, QString> &item = items.at(i);
+
+        if ((item.first != "key") && (item.first != "access_token")) {
+            key.append(separator);
+            key.append(item.first);
+            key.append('=');
+            key.append(item.second);
+            separator = '&';
+        }
+    }
+
+    return key;
+}
+
+ResponseCachePrivate::ResponseCachePrivate(ResponseCache *parent) :
+    q_ptr(parent),
+    first(0),
+    last(0),
+    maximumSize(5242880),
+    maximumCount(100),
+    size(0),
+    hits(0),
+    misses(0)
+{
+}
+
+ResponseCachePrivate::~ResponseCachePrivate() {}
+
+/*!
+    \internal
+    \brief Returns a rough estimate of the memory used by \a v in bytes.
+*/
+int ResponseCachePrivate::estimatedSize(const QVariant &v) {
+    switch (v.type()) {
+    case QVariant::Map:
+    {
+        const QVariantMap map = v.toMap();
+        int s = 32;
+        QMapIterator<QString, QVariant> iterator(map);
+
+        while (iterator.hasNext()) {
+            iterator.next();
+            s += 48 + iterator.key().size() * 2 + estimatedSize(iterator.value());
+        }
+
+        return s;
+    }
+    case QVariant::List:
+    {
+        const QVariantList list = v.toList();
+        int s = 32;
+
+        foreach (const QVariant &item, list) {
+            s += 8 + estimatedSize(item);
+        }
+
+        return s;
+    }
+    case QVariant::String:
+        return 32 + v.toString().size() * 2;
+    case QVariant::ByteArray:
+        return 32 + v.toByteArray().size();
+    default:
+        return 16;
+    }
+}
+
+ResponseCacheNode* ResponseCachePrivate::node(const QString &key) {
+    ResponseCacheNode *n = nodes.value(key);
+
+    if ((n) && (n != first)) {
+        unlink(n);
+        prepend(n);
+    }
+
+    return n;
+}
+
+void ResponseCachePrivate::insertNode(const QString &key, const QByteArray &etag, const QVariant &result) {
+    ResponseCacheNode *n = new ResponseCacheNode;
+    n->key = key;
+    n->etag = etag;
+    n->result = result;
+    n->size = estimatedSize(result);
+    insertNode(n);
+}
+
+void ResponseCachePrivate::insertNode(const QString &key, const QByteArray &etag, const QVariant &result,
+                                      const QByteArray &response) {
+    if (response.isEmpty()) {
+        insertNode(key, etag, result);
+        return;
+    }
+
+    ResponseCacheNode *n = new ResponseCacheNode;
+    n->key = key;
+    n->etag = etag;
+    n->response = response;
+    n->size = response.size();
+    insertNode(n);
+}
+
+/*!
+    \internal
+    \brief Retrieves the result for \a key, with the mutex locked by \a locker.
+
+    If only the raw response is cached, the mutex is released while it is parsed, so that other threads are not
+    blocked. The parsed result is then kept in the entry.
+*/
+bool ResponseCachePrivate::findResult(const QString &key, QVariant &result, QMutexLocker &locker) {
+    ResponseCacheNode *n = node(key);
+
+    if (!n) {
+        return false;
+    }
+
+    if ((n->response.isEmpty()) || (n->result.isValid())) {
+        result = n->result;
+        hits++;
+        return true;
+    }
+
+    const QByteArray response = n->response;
+    locker.unlock();
+    bool ok;
+    const QVariant parsed = QtJson::Json::parse(response, ok);
+    const int parsedSize = ok ? estimatedSize(parsed) : 0;
+    locker.relock();
+
+    if (!ok) {
+        return false;
+    }
+
+    result = parsed;
+    hits++;
+
+    // The entry may have been replaced or removed while the response was parsed.
+    n = nodes.value(key);
+
+    if ((n) && (n->response.constData() == response.constData()) && (!n->result.isValid())) {
+        n->result = parsed;
+        n->size += parsedSize;
+        size += parsedSize;
+        trim();
+    }
+
+    return true;
+}
+
+/*!
+    \internal
+    \brief Retrieves the raw response for \a key, with the mutex locked.
+*/
+bool ResponseCachePrivate::findResponse(const QString &key, QByteArray &response) {
+    ResponseCacheNode *n = node(key);
+
+    if ((!n) || (n->response.isEmpty())) {
+        return false;
+    }
+
+    response = n->response;
+    hits++;
+    return true;
+}
+
+void ResponseCachePrivate::insertNode(ResponseCacheNode *n) {
+    if (ResponseCacheNode *existing = nodes.value(n->key)) {
+        removeNode(existing);
+    }
+
+    nodes.insert(n->key, n);
+    prepend(n);
+    size += n->size;
+    trim();
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::ResponseCachePrivate::insertNode" << n->key << n->etag << n->size;
+#endif
+}
+
+void ResponseCachePrivate::removeNode(ResponseCacheNode *n) {
+    unlink(n);
+    nodes.remove(n->key);
+    size -= n->size;
+    delete n;
+}
+
+void ResponseCachePrivate::clearNodes() {
+    qDeleteAll(nodes);
+    nodes.clear();
+    first = 0;
+    last = 0;
+    size = 0;
+}
+
+void ResponseCachePrivate::unlink(ResponseCacheNode *n) {
+    if (n->previous) {
+        n->previous->next = n->next;
+    }
+    else {
+        first = n->next;
+    }
+
+    if (n->next) {
+        n->next->previous = n->previous;
+    }
+    else {
+        last = n->previous;
+    }
+
+    n->previous = 0;
+    n->next = 0;
+}
+
+void ResponseCachePrivate::prepend(ResponseCacheNode *n) {
+    n->previous = 0;
+    n->next = first;
+
+    if (first) {
+        first->previous = n;
+    }
+
+    first = n;
+
+    if (!last) {
+        last = n;
+    }
+}
+
+void ResponseCachePrivate::trim() {
+    while ((last) && ((size > maximumSize) || (nodes.size() > maximumCount))) {
+        removeNode(last);
+    }
+}
+
+}
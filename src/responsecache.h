@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_RESPONSECACHE_H
+#define QYOUTUBE_RESPONSECACHE_H
+
+#include "qyoutube_global.h"
+#include <QScopedPointer>
+#include <QVariant>
+
+class QUrl;
+
+namespace QYouTube {
+
+class ResponseCachePrivate;
+
+class QYOUTUBESHARED_EXPORT ResponseCache
+{
+
+public:
+    ResponseCache();
+    virtual ~ResponseCache();
+
+    int maximumSize() const;
+    void setMaximumSize(int size);
+
+    int maximumCount() const;
+    void setMaximumCount(int count);
+
+    int size() const;
+    int count() const;
+
+    qint64 hitCount() const;
+    qint64 missCount() const;
+    void resetStatistics();
+
+    virtual QByteArray etag(const QUrl &url);
+    virtual bool find(const QUrl &url, QVariant &result);
+    virtual bool findResponse(const QUrl &url, QByteArray &response);
+    virtual void insert(const QUrl &url, const QByteArray &etag, const QVariant &result);
+    virtual void insertResponse(const QUrl &url, const QByteArray &etag, const QVariant &result,
+                                const QByteArray &response);
+    virtual void remove(const QUrl &url);
+    virtual void clear();
+
+    static QString cacheKey(const QUrl &url);
+
+protected:
+    ResponseCache(ResponseCachePrivate &dd);
+
+    QScopedPointer<ResponseCachePrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(ResponseCache)
+
+private:
+    Q_DISABLE_COPY(ResponseCache)
+};
+
+}
+
+#endif // QYOUTUBE_RESPONSECACHE_H
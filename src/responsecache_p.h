@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_RESPONSECACHE_P_H
+#define QYOUTUBE_RESPONSECACHE_P_H
+
+#include "responsecache.h"
+#include <QHash>
+#include <QMutex>
+
+class QMutexLocker;
+
+namespace QYouTube {
+
+class ResponseCacheNode
+{
+
+public:
+    ResponseCacheNode() :
+        size(0),
+        previous(0),
+        next(0)
+    {
+    }
+
+    QString key;
+
+    QByteArray etag;
+
+    // The parsed result, which is kept once the entry has been used.
+    QVariant result;
+
+    // The raw response, which is not parsed until the entry is used.
+    QByteArray response;
+
+    int size;
+
+    ResponseCacheNode *previous;
+    ResponseCacheNode *next;
+};
+
+class ResponseCachePrivate
+{
+
+public:
+    ResponseCachePrivate(ResponseCache *parent);
+    virtual ~ResponseCachePrivate();
+
+    static int estimatedSize(const QVariant &v);
+
+    ResponseCacheNode* node(const QString &key);
+
+    bool findResult(const QString &key, QVariant &result, QMutexLocker &locker);
+    bool findResponse(const QString &key, QByteArray &response);
+
+    void insertNode(const QString &key, const QByteArray &etag, const QVariant &result);
+    void insertNode(const QString &key, const QByteArray &etag, const QVariant &result, const QByteArray &response);
+    void insertNode(ResponseCacheNode *n);
+    void removeNode(ResponseCacheNode *n);
+    void clearNodes();
+
+    void unlink(ResponseCacheNode *n);
+    void prepend(ResponseCacheNode *n);
+
+    void trim();
+
+    ResponseCache *q_ptr;
+
+    mutable QMutex mutex;
+
+    QHash<QString, ResponseCacheNode*> nodes;
+
+    ResponseCacheNode *first;
+    ResponseCacheNode *last;
+
+    int maximumSize;
+    int maximumCount;
+    int size;
+
+    qint64 hits;
+    qint64 misses;
+
+    Q_DECLARE_PUBLIC(ResponseCache)
+};
+
+}
+
+#endif // QYOUTUBE_RESPONSECACHE_P_H
@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "retrypolicy_p.h"
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadStorage>
+#ifdef QYOUTUBE_DEBUG
+#include <QDebug>
+#endif
+
+namespace QYouTube {
+
+static QThreadStorage<quint32*> randomStates;
+
+// A per-thread xorshift generator, seeded from the clock so that clients retrying at the same time spread out.
+static quint32 randomNumber() {
+    if (!randomStates.hasLocalData()) {
+        const quint32 seed = quint32(QDateTime::currentDateTime().toMSecsSinceEpoch())
+                             ^ quint32(quintptr(QThread::currentThread()));
+        randomStates.setLocalData(new quint32(seed ? seed : 2463534242u));
+    }
+
+    quint32 &x = *randomStates.localData();
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/*!
+    \class RetryPolicy
+    \brief Determines whether and when failed requests are retried.
+
+    \ingroup requests
+
+    When a RetryPolicy is set on a Request, HTTP requests that fail with a transient error are repeated after a delay,
+    up to maximumRetries times. The delay before each retry is chosen at random between zero and an exponentially
+    increasing limit ('full jitter'), so that many clients that fail at the same time do not retry at the same time.
+
+    The following failures are retried:
+
+    <ul>
+        <li>Network errors that are normally temporary, such as TimeoutError and TemporaryNetworkFailureError.</li>
+        <li>HTTP 429 and 5xx responses.</li>
+        <li>YouTube Data API errors with reason backendError, rateLimitExceeded or userRateLimitExceeded.</li>
+    </ul>
+
+    Errors with reason quotaExceeded, dailyLimitExceeded or forbidden are never retried, since repeating the request
+    cannot succeed.
+
+    Only idempotent requests are retried. HTTP GET, HEAD, PUT and DELETE requests are retried, but HTTP POST requests
+    are retried only if retryPostRequests() is true.
+
+    Each retry is reported by Request::retrying() and counted by retryCount(), so that the number of additional
+    requests caused by retries can be measured. A single RetryPolicy can be shared between any number of requests and
+    models, including those in different threads.
+
+    \code
+    RetryPolicy *policy = new RetryPolicy;
+    policy->setMaximumRetries(5);
+
+    ResourcesRequest *request = new ResourcesRequest(this);
+    request->setRetryPolicy(policy);
+    \endcode
+
+    \sa Request::setRetryPolicy()
+*/
+RetryPolicy::RetryPolicy() :
+    d_ptr(new RetryPolicyPrivate(this))
+{
+}
+
+RetryPolicy::RetryPolicy(RetryPolicyPrivate &dd) :
+    d_ptr(&dd)
+{
+}
+
+RetryPolicy::~RetryPolicy() {}
+
+/*!
+    \brief Returns the maximum number of times that a failed request is retried.
+
+    The default value is 3.
+*/
+int RetryPolicy::maximumRetries() const {
+    Q_D(const RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->maximumRetries;
+}
+
+/*!
+    \brief Sets the maximum number of times that a failed request is retried to \a retries.
+*/
+void RetryPolicy::setMaximumRetries(int retries) {
+    Q_D(RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->maximumRetries = qMax(0, retries);
+}
+
+/*!
+    \brief Returns the limit in milliseconds of the delay before the first retry.
+
+    The limit is doubled for each subsequent retry, up to maximumDelay().
+
+    The default value is 500.
+*/
+int RetryPolicy::baseDelay() const {
+    Q_D(const RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->baseDelay;
+}
+
+/*!
+    \brief Sets the limit in milliseconds of the delay before the first retry to \a msecs.
+*/
+void RetryPolicy::setBaseDelay(int msecs) {
+    Q_D(RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->baseDelay = qMax(0, msecs);
+}
+
+/*!
+    \brief Returns the maximum delay in milliseconds before a retry.
+
+    The default value is 32000.
+*/
+int RetryPolicy::maximumDelay() const {
+    Q_D(const RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->maximumDelay;
+}
+
+/*!
+    \brief Sets the maximum delay in milliseconds before a retry to \a msecs.
+*/
+void RetryPolicy::setMaximumDelay(int msecs) {
+    Q_D(RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->maximumDelay = qMax(0, msecs);
+}
+
+/*!
+    \brief Returns true if failed HTTP POST requests are retried.
+
+    HTTP POST requests are not idempotent, so repeating a request that reached the server may, for example, insert
+    the same resource twice. The default value is false.
+*/
+bool RetryPolicy::retryPostRequests() const {
+    Q_D(const RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->retryPostRequests;
+}
+
+/*!
+    \brief Sets whether failed HTTP POST requests are retried to \a enabled.
+*/
+void RetryPolicy::setRetryPostRequests(bool enabled) {
+    Q_D(RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->retryPostRequests = enabled;
+}
+
+/*!
+    \brief Returns the number of retries that have been made.
+*/
+qint64 RetryPolicy::retryCount() const {
+    Q_D(const RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->retries;
+}
+
+/*!
+    \brief Returns the number of requests that failed with a retryable error after maximumRetries() retries.
+*/
+qint64 RetryPolicy::exhaustedCount() const {
+    Q_D(const RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->exhausted;
+}
+
+/*!
+    \brief Resets the retry counters to zero.
+*/
+void RetryPolicy::resetStatistics() {
+    Q_D(RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->retries = 0;
+    d->exhausted = 0;
+}
+
+/*!
+    \brief Returns true if a request with \a operation that failed with \a statusCode, \a error and \a response can
+    be retried.
+
+    Reimplement this method to change which failures are retried.
+*/
+bool RetryPolicy::isRetryable(Request::Operation operation, int statusCode, Request::Error error,
+                              const QVariant &response) const {
+    switch (operation) {
+    case Request::HeadOperation:
+    case Request::GetOperation:
+    case Request::PutOperation:
+    case Request::DeleteOperation:
+        break;
+    case Request::PostOperation:
+        if (!retryPostRequests()) {
+            return false;
+        }
+
+        break;
+    default:
+        return false;
+    }
+
+    const QString reason = errorReason(response);
+
+    if ((reason == "quotaExceeded") || (reason == "dailyLimitExceeded") || (reason == "forbidden")) {
+        return false;
+    }
+
+    if ((reason == "backendError") || (reason == "rateLimitExceeded") || (reason == "userRateLimitExceeded")) {
+        return true;
+    }
+
+    if ((statusCode == 429) || (statusCode >= 500)) {
+        return true;
+    }
+
+    switch (error) {
+    case Request::RemoteHostClosedError:
+    case Request::TimeoutError:
+    case Request::TemporaryNetworkFailureError:
+    case Request::ProxyTimeoutError:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*!
+    \brief Returns the delay in milliseconds before retry number \a retry, starting from 0.
+
+    The delay is chosen at random between 0 and the lesser of maximumDelay() and baseDelay() * 2 ^ \a retry.
+
+    Reimplement this method to change the delay between retries.
+*/
+int RetryPolicy::retryDelay(int retry) const {
+    Q_D(const RetryPolicy);
+
+    qint64 limit;
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        limit = qMin(qint64(d->maximumDelay), qint64(d->baseDelay) << qBound(0, retry, 30));
+    }
+
+    return limit > 0 ? int(randomNumber() % quint32(limit + 1)) : 0;
+}
+
+/*!
+    \brief Records that a request has been retried.
+
+    This is called by Request, and does not normally need to be called.
+*/
+void RetryPolicy::recordRetry() {
+    Q_D(RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->retries++;
+}
+
+/*!
+    \brief Records that a request failed with a retryable error after maximumRetries() retries.
+
+    This is called by Request, and does not normally need to be called.
+*/
+void RetryPolicy::recordExhausted() {
+    Q_D(RetryPolicy);
+
+    QMutexLocker locker(&d->mutex);
+
+    d->exhausted++;
+}
+
+/*!
+    \brief Returns the reason of the first error in a YouTube Data API error \a response.
+
+    Returns an empty string if \a response is not an error response.
+*/
+QString RetryPolicy::errorReason(const QVariant &response) {
+    const QVariantList errors = response.toMap().value("error").toMap().value("errors").toList();
+    return errors.isEmpty() ? QString() : errors.first().toMap().value("reason").toString();
+}
+
+RetryPolicyPrivate::RetryPolicyPrivate(RetryPolicy *parent) :
+    q_ptr(parent),
+    maximumRetries(3),
+    baseDelay(500),
+    maximumDelay(32000),
+    retryPostRequests(false),
+    retries(0),
+    exhausted(0)
+{
+}
+
+RetryPolicyPrivate::~RetryPolicyPrivate() {}
+
+}
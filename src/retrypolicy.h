@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_RETRYPOLICY_H
+#define QYOUTUBE_RETRYPOLICY_H
+
+#include "request.h"
+#include <QScopedPointer>
+
+namespace QYouTube {
+
+class RetryPolicyPrivate;
+
+class QYOUTUBESHARED_EXPORT RetryPolicy
+{
+
+public:
+    RetryPolicy();
+    virtual ~RetryPolicy();
+
+    int maximumRetries() const;
+    void setMaximumRetries(int retries);
+
+    int baseDelay() const;
+    void setBaseDelay(int msecs);
+
+    int maximumDelay() const;
+    void setMaximumDelay(int msecs);
+
+    bool retryPostRequests() const;
+    void setRetryPostRequests(bool enabled);
+
+    qint64 retryCount() const;
+    qint64 exhaustedCount() const;
+    void resetStatistics();
+
+    virtual bool isRetryable(Request::Operation operation, int statusCode, Request::Error error,
+                             const QVariant &response) const;
+    virtual int retryDelay(int retry) const;
+
+    void recordRetry();
+    void recordExhausted();
+
+    static QString errorReason(const QVariant &response);
+
+protected:
+    RetryPolicy(RetryPolicyPrivate &dd);
+
+    QScopedPointer<RetryPolicyPrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(RetryPolicy)
+
+private:
+    Q_DISABLE_COPY(RetryPolicy)
+};
+
+}
+
+#endif // QYOUTUBE_RETRYPOLICY_H
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_RETRYPOLICY_P_H
+#define QYOUTUBE_RETRYPOLICY_P_H
+
+#include "retrypolicy.h"
+#include <QMutex>
+
+namespace QYouTube {
+
+class RetryPolicyPrivate
+{
+
+public:
+    RetryPolicyPrivate(RetryPolicy *parent);
+    virtual ~RetryPolicyPrivate();
+
+    RetryPolicy *q_ptr;
+
+    mutable QMutex mutex;
+
+    int maximumRetries;
+    int baseDelay;
+    int maximumDelay;
+
+    bool retryPostRequests;
+
+    qint64 retries;
+    qint64 exhausted;
+
+    Q_DECLARE_PUBLIC(RetryPolicy)
+};
+
+}
+
+#endif // QYOUTUBE_RETRYPOLICY_P_H
@@ -11,43 +11,78 @@ DESTDIR = ../lib
 
 HEADERS += \
     authenticationrequest.h \
+    batchrequest.h \
+    diskresponsecache.h \
+    diskresponsecache_p.h \
+    inflightrequests.h \
+    inflightrequests_p.h \
     json.h \
     model.h \
     model_p.h \
+    networkaccessmanagerpool.h \
+    networkaccessmanagerpool_p.h \
     qyoutube_global.h \
+    quotatracker.h \
+    quotatracker_p.h \
     request.h \
     request_p.h \
+    resources.h \
     resourcesmodel.h \
     resourcesrequest.h \
+    responsecache.h \
+    responsecache_p.h \
+    retrypolicy.h \
+    retrypolicy_p.h \
     streamsmodel.h \
     streamsrequest.h \
     subtitlesmodel.h \
     subtitlesrequest.h \
+    tokenmanager.h \
+    tokenmanager_p.h \
     urls.h
 
 SOURCES += \
     authenticationrequest.cpp \
+    batchrequest.cpp \
+    diskresponsecache.cpp \
+    inflightrequests.cpp \
     json.cpp \
     model.cpp \
+    networkaccessmanagerpool.cpp \
+    quotatracker.cpp \
     request.cpp \
+    resources.cpp \
     resourcesmodel.cpp \
     resourcesrequest.cpp \
+    responsecache.cpp \
+    retrypolicy.cpp \
     streamsmodel.cpp \
     streamsrequest.cpp \
     subtitlesmodel.cpp \
-    subtitlesrequest.cpp
+    subtitlesrequest.cpp \
+    tokenmanager.cpp
     
 headers.files += \
     authenticationrequest.h \
+    batchrequest.h \
+    diskresponsecache.h \
+    inflightrequests.h \
+    json.h \
     model.h \
+    networkaccessmanagerpool.h \
     qyoutube_global.h \
+    quotatracker.h \
     request.h \
+    resources.h \
     resourcesmodel.h \
     resourcesrequest.h \
+    responsecache.h \
+    retrypolicy.h \
     streamsmodel.h \
     streamsrequest.h \
     subtitlesmodel.h \
     subtitlesrequest.h \
+    tokenmanager.h \
     urls.h
     
 symbian {
@@ -41,10 +41,10 @@ public:
             QVariantList list = request->result().toList();
         
             if (!list.isEmpty()) {
-                q->beginInsertRows(QModelIndex(), items.size(), items.size() + list.size());
+                q->beginInsertRows(QModelIndex(), count(), count() + list.size());
                 
                 foreach (QVariant item, list) {
-                    items << item.toMap();
+                    appendItem(item.toMap());
                 }
                 
                 q->endInsertRows();
@@ -168,6 +168,7 @@ StreamsModel::StreamsModel(QObject *parent) :
     d->roles[WidthRole] = "width";
     d->roles[HeightRole] = "height";
     d->roles[UrlRole] = "url";
+    d->updateColumns();
 #if QT_VERSION < 0x050000
     setRoleNames(d->roles);
 #endif
@@ -232,7 +233,7 @@ QString StreamsModel::errorString() const {
     
     StreamsModel does not take ownership of \a manager.
     
-    If no QNetworkAccessManager is set, one will be created when required.
+    If no QNetworkAccessManager is set, the manager shared by all requests in the current thread is used.
     
     \sa StreamsRequest::setNetworkAccessManager()
 */
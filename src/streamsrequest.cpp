@@ -143,6 +143,9 @@ public:
     StreamsRequestPrivate(StreamsRequest *parent) :
         RequestPrivate(parent)
     {
+        // The responses are read by _q_onReplyFinished(), so they are not parsed as they arrive.
+        parseIncrementally = false;
+        
         if (!decryptionEngine) {
             decryptionEngine = new QScriptEngine;
         }
@@ -179,7 +182,7 @@ public:
         q->setUrl(u);
         setOperation(StreamsRequest::GetOperation);
         setStatus(StreamsRequest::Loading);
-        reply = networkAccessManager()->get(buildRequest(false));
+        reply = watchReply(networkAccessManager()->get(buildRequest(false)));
         StreamsRequest::connect(reply, SIGNAL(finished()), q, SLOT(_q_onVideoInfoLoaded()));
     }
     
@@ -212,7 +215,7 @@ public:
         request.setRawHeader("User-Agent", "Wget/1.13.4 (linux-gnu)");
         setOperation(StreamsRequest::GetOperation);
         setStatus(StreamsRequest::Loading);
-        reply = networkAccessManager()->get(request);
+        reply = watchReply(networkAccessManager()->get(request));
         StreamsRequest::connect(reply, SIGNAL(finished()), q, SLOT(_q_onVideoWebPageLoaded()));
     }
     
@@ -232,7 +235,7 @@ public:
         q->setUrl(playerUrl);
         setOperation(StreamsRequest::GetOperation);
         setStatus(StreamsRequest::Loading);
-        reply = networkAccessManager()->get(buildRequest(false));
+        reply = watchReply(networkAccessManager()->get(buildRequest(false)));
         StreamsRequest::connect(reply, SIGNAL(finished()), q, SLOT(_q_onPlayerJSLoaded()));
         
         return QScriptValue();
@@ -361,8 +364,8 @@ public:
         Q_Q(StreamsRequest);
         
         response = reply->readAll();
-        const QNetworkReply::NetworkError e = reply->error();
-        const QString es = reply->errorString();
+        const QNetworkReply::NetworkError e = replyError(reply);
+        const QString es = replyErrorString(reply);
         reply->deleteLater();
         reply = 0;
         
@@ -419,8 +422,8 @@ public:
         Q_Q(StreamsRequest);
         
         response = reply->readAll();
-        const QNetworkReply::NetworkError e = reply->error();
-        const QString es = reply->errorString();
+        const QNetworkReply::NetworkError e = replyError(reply);
+        const QString es = replyErrorString(reply);
         reply->deleteLater();
         reply = 0;
         
@@ -521,8 +524,8 @@ public:
         Q_Q(StreamsRequest);
         
         const QString jsresponse(reply->readAll());
-        const QNetworkReply::NetworkError e = reply->error();
-        const QString es = reply->errorString();
+        const QNetworkReply::NetworkError e = replyError(reply);
+        const QString es = replyErrorString(reply);
         const QUrl playerUrl = reply->request().url();
         reply->deleteLater();
         reply = 0;
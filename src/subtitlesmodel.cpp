@@ -40,10 +40,10 @@ public:
             QVariantList list = request->result().toList();
         
             if (!list.isEmpty()) {
-                q->beginInsertRows(QModelIndex(), items.size(), items.size() + list.size());
+                q->beginInsertRows(QModelIndex(), count(), count() + list.size());
                 
                 foreach (QVariant item, list) {
-                    items << item.toMap();
+                    appendItem(item.toMap());
                 }
                 
                 q->endInsertRows();
@@ -162,6 +162,7 @@ SubtitlesModel::SubtitlesModel(QObject *parent) :
     d->roles[OriginalLanguageRole] = "originalLanguage";
     d->roles[TranslatedLanguageRole] = "translatedLanguage";
     d->roles[UrlRole] = "url";
+    d->updateColumns();
 #if QT_VERSION < 0x050000
     setRoleNames(d->roles);
 #endif
@@ -226,7 +227,7 @@ QString SubtitlesModel::errorString() const {
     
     SubtitlesModel does not take ownership of \a manager.
     
-    If no QNetworkAccessManager is set, one will be created when required.
+    If no QNetworkAccessManager is set, the manager shared by all requests in the current thread is used.
     
     \sa SubtitlesRequest::setNetworkAccessManager()
 */
@@ -30,6 +30,10 @@ public:
     SubtitlesRequestPrivate(SubtitlesRequest *parent) :
         RequestPrivate(parent)
     {
+        // Replies are handled by _q_onReplyFinished(), so they cannot be shared with other requests.
+        shareReplies = false;
+        // The responses are read by _q_onReplyFinished(), so they are not parsed as they arrive.
+        parseIncrementally = false;
     }
     
     void _q_onReplyFinished() {
@@ -54,8 +58,8 @@ public:
         }
         
         const QByteArray response = reply->readAll();
-        const QNetworkReply::NetworkError e = reply->error();
-        const QString es = reply->errorString();
+        const QNetworkReply::NetworkError e = replyError(reply);
+        const QString es = replyErrorString(reply);
         const QUrl subtitlesUrl = reply->request().url();
         reply->deleteLater();
         reply = 0;
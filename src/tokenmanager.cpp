@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tokenmanager_p.h"
+#include "json.h"
+#include "networkaccessmanagerpool.h"
+#include "request_p.h"
+#include "urls.h"
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QThread>
+#include <QTimer>
+#ifdef QYOUTUBE_DEBUG
+#include <QDebug>
+#endif
+
+namespace QYouTube {
+
+Q_GLOBAL_STATIC(QMutex, instanceMutex)
+
+static TokenManager *self = 0;
+
+// The delay in seconds before a failed renewal is retried, which is doubled after each further failure.
+static const int RENEWAL_RETRY_DELAY = 30;
+
+/*!
+    \class TokenManager
+    \brief Refreshes access tokens on behalf of all requests.
+
+    \ingroup requests
+
+    When a request is rejected because its access token has expired, the request asks the TokenManager to refresh
+    the token. Only one refresh is made at a time for each combination of client id and refresh token, regardless of
+    how many requests need the new token, or in which threads they were made. Each request waits for the refresh to
+    complete, then repeats its HTTP request using the new token.
+
+    When a token is refreshed, the accessTokenRefreshed() signal is emitted, and the new access token is set on
+    every request and model using the same client id and refresh token.
+
+    The lifetime of each access token issued by a refresh or by AuthenticationRequest is recorded, and the token is
+    renewed in the background renewalMargin seconds before it expires, so that requests are not normally rejected
+    because of an expired token. If a renewal fails, it is retried after 30 seconds, with the delay doubling after
+    each further failure, until the token expires.
+
+    There is normally no need to use TokenManager directly.
+*/
+TokenManager::TokenManager() :
+    QObject(),
+    d_ptr(new TokenManagerPrivate(this))
+{
+    Q_D(TokenManager);
+
+    d->timer = new QTimer(this);
+    d->timer->setSingleShot(true);
+    connect(d->timer, SIGNAL(timeout()), this, SLOT(_q_renewAccessTokens()));
+}
+
+TokenManager::~TokenManager() {}
+
+/*!
+    \brief Returns the TokenManager instance.
+*/
+TokenManager* TokenManager::instance() {
+    QMutexLocker locker(instanceMutex());
+
+    if (!self) {
+        self = new TokenManager;
+
+        // Requests in any thread can use the instance, so it belongs to the main thread.
+        if ((QCoreApplication::instance()) && (self->thread() != QCoreApplication::instance()->thread())) {
+            self->moveToThread(QCoreApplication::instance()->thread());
+        }
+    }
+
+    return self;
+}
+
+/*!
+    \brief Returns true if the access token for \a clientId and \a refreshToken is being refreshed.
+*/
+bool TokenManager::isRefreshing(const QString &clientId, const QString &refreshToken) const {
+    Q_D(const TokenManager);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->refreshes.contains(TokenManagerPrivate::refreshKey(clientId, refreshToken));
+}
+
+/*!
+    \brief Returns the time at which the access token for \a clientId and \a refreshToken expires.
+
+    Returns an invalid QDateTime if the lifetime of the access token is not known.
+*/
+QDateTime TokenManager::accessTokenExpiry(const QString &clientId, const QString &refreshToken) const {
+    Q_D(const TokenManager);
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->expiries.value(TokenManagerPrivate::refreshKey(clientId, refreshToken)).expiry;
+}
+
+/*!
+    \brief Records that the access token for \a clientId and \a refreshToken expires in \a expiresIn seconds.
+
+    The access token is renewed using \a clientSecret shortly before it expires.
+
+    \sa renewalMargin(), clearAccessTokenExpiry()
+*/
+void TokenManager::setAccessTokenExpiry(const QString &clientId, const QString &clientSecret,
+                                        const QString &refreshToken, int expiresIn) {
+    if ((refreshToken.isEmpty()) || (expiresIn <= 0)) {
+        return;
+    }
+
+    Q_D(TokenManager);
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        AccessTokenExpiry &e = d->expiries[TokenManagerPrivate::refreshKey(clientId, refreshToken)];
+        e.clientId = clientId;
+        e.clientSecret = clientSecret;
+        e.refreshToken = refreshToken;
+        e.expiry = QDateTime::currentDateTimeUtc().addSecs(expiresIn);
+        // Short-lived tokens are renewed half way through their lifetime.
+        e.renewal = e.expiry.addSecs(-qMin(d->renewalMargin, expiresIn / 2));
+        e.attempts = 0;
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::TokenManager::setAccessTokenExpiry" << clientId << expiresIn;
+#endif
+    // The timer belongs to the main thread, so it is always rescheduled there.
+    QMetaObject::invokeMethod(this, "_q_scheduleRenewal", Qt::QueuedConnection);
+}
+
+/*!
+    \brief Stops renewing the access token for \a clientId and \a refreshToken.
+
+    This should be used when the refresh token is no longer in use, for example after it has been revoked.
+*/
+void TokenManager::clearAccessTokenExpiry(const QString &clientId, const QString &refreshToken) {
+    Q_D(TokenManager);
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        if (!d->expiries.remove(TokenManagerPrivate::refreshKey(clientId, refreshToken))) {
+            return;
+        }
+    }
+
+    QMetaObject::invokeMethod(this, "_q_scheduleRenewal", Qt::QueuedConnection);
+}
+
+/*!
+    \brief Returns the number of seconds before expiry at which access tokens are renewed.
+
+    The default value is 300. Access tokens with a lifetime shorter than twice the margin are renewed half way
+    through their lifetime.
+*/
+int TokenManager::renewalMargin() {
+    TokenManagerPrivate *d = instance()->d_func();
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->renewalMargin;
+}
+
+/*!
+    \brief Sets the number of seconds before expiry at which access tokens are renewed to \a seconds.
+
+    The new margin applies to access tokens recorded after it is set.
+*/
+void TokenManager::setRenewalMargin(int seconds) {
+    TokenManagerPrivate *d = instance()->d_func();
+
+    QMutexLocker locker(&d->mutex);
+
+    d->renewalMargin = qMax(0, seconds);
+}
+
+/*!
+    \brief Returns the number of access token refreshes that have been made.
+*/
+qint64 TokenManager::refreshCount() {
+    TokenManagerPrivate *d = instance()->d_func();
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->refreshCount;
+}
+
+/*!
+    \brief Returns the number of times that a request waited for a refresh that was already in progress, instead of
+    making a new refresh.
+*/
+qint64 TokenManager::coalescedRefreshCount() {
+    TokenManagerPrivate *d = instance()->d_func();
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->coalescedCount;
+}
+
+/*!
+    \brief Returns the number of access token refreshes that were made in the background before the access token
+    expired.
+*/
+qint64 TokenManager::renewalCount() {
+    TokenManagerPrivate *d = instance()->d_func();
+
+    QMutexLocker locker(&d->mutex);
+
+    return d->renewalCount;
+}
+
+/*!
+    \brief Resets the refresh counters to zero.
+*/
+void TokenManager::resetStatistics() {
+    TokenManagerPrivate *d = instance()->d_func();
+
+    QMutexLocker locker(&d->mutex);
+
+    d->refreshCount = 0;
+    d->coalescedCount = 0;
+    d->renewalCount = 0;
+}
+
+/*!
+    \fn void TokenManager::accessTokenRefreshed(const QString &clientId, const QString &refreshToken,
+                                                const QVariant &response, int error, const QString &errorString)
+    \brief Emitted when the refresh of the access token for \a clientId and \a refreshToken is completed.
+
+    \a response is the parsed response. \a error is a Request::Error value, and is Request::NoError if a new access
+    token was issued.
+*/
+
+/*!
+    \brief Refreshes the access token for \a clientId, \a clientSecret and \a refreshToken.
+
+    If a refresh for \a clientId and \a refreshToken is already in progress, no new refresh is made.
+
+    The refresh is made using \a manager, or the shared QNetworkAccessManager for the current thread if \a manager is
+    0.
+
+    \sa accessTokenRefreshed()
+*/
+void TokenManager::refreshAccessToken(const QString &clientId, const QString &clientSecret,
+                                      const QString &refreshToken, QNetworkAccessManager *manager) {
+    Q_D(TokenManager);
+
+    const QString key = TokenManagerPrivate::refreshKey(clientId, refreshToken);
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        if (d->refreshes.contains(key)) {
+            d->coalescedCount++;
+#ifdef QYOUTUBE_DEBUG
+            qDebug() << "QYouTube::TokenManager::refreshAccessToken: Refresh already in progress" << clientId;
+#endif
+            return;
+        }
+
+        d->refreshes.insert(key);
+        d->refreshCount++;
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::TokenManager::refreshAccessToken" << clientId;
+#endif
+    if (!manager) {
+        manager = NetworkAccessManagerPool::networkAccessManager();
+    }
+
+    QNetworkRequest request(TOKEN_URL);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+    const QByteArray body("client_id=" + clientId.toUtf8() +
+                          "&client_secret=" + clientSecret.toUtf8() +
+                          "&refresh_token=" + refreshToken.toUtf8() +
+                          "&grant_type=refresh_token");
+
+    QNetworkReply *reply = manager->post(request, body);
+    ReplyTimeout::watch(reply, Request::defaultTimeout(), Request::defaultInactivityTimeout());
+    new AccessTokenRefresh(clientId, clientSecret, refreshToken, reply);
+}
+
+TokenManagerPrivate::TokenManagerPrivate(TokenManager *parent) :
+    q_ptr(parent),
+    timer(0),
+    renewalMargin(300),
+    refreshCount(0),
+    coalescedCount(0),
+    renewalCount(0)
+{
+}
+
+QString TokenManagerPrivate::refreshKey(const QString &clientId, const QString &refreshToken) {
+    return clientId + "\n" + refreshToken;
+}
+
+void TokenManagerPrivate::finishRefresh(const QString &clientId, const QString &refreshToken,
+                                        const QVariant &response, int error, const QString &errorString) {
+    Q_Q(TokenManager);
+
+    {
+        // The refresh is removed before the signal is emitted, so that a request rejected after the signal is
+        // received starts a new refresh.
+        QMutexLocker locker(&mutex);
+        refreshes.remove(refreshKey(clientId, refreshToken));
+    }
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::TokenManagerPrivate::finishRefresh" << clientId << Request::Error(error) << errorString;
+#endif
+    emit q->accessTokenRefreshed(clientId, refreshToken, response, error, errorString);
+}
+
+void TokenManagerPrivate::_q_scheduleRenewal() {
+    QDateTime next;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        foreach (const AccessTokenExpiry &e, expiries) {
+            if ((next.isNull()) || (e.renewal < next)) {
+                next = e.renewal;
+            }
+        }
+    }
+
+    if (next.isNull()) {
+        timer->stop();
+        return;
+    }
+
+    // QTimer intervals are limited to int milliseconds, so distant renewals are rescheduled when the timer fires.
+    const qint64 msecs = qBound(qint64(0), qint64(QDateTime::currentDateTimeUtc().secsTo(next)) * 1000,
+                                qint64(86400000));
+    timer->start(int(msecs));
+#ifdef QYOUTUBE_DEBUG
+    qDebug() << "QYouTube::TokenManagerPrivate::_q_scheduleRenewal" << next << msecs;
+#endif
+}
+
+void TokenManagerPrivate::_q_renewAccessTokens() {
+    Q_Q(TokenManager);
+
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    QList<AccessTokenExpiry> due;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        QMutableHashIterator<QString, AccessTokenExpiry> iterator(expiries);
+
+        while (iterator.hasNext()) {
+            iterator.next();
+            AccessTokenExpiry &e = iterator.value();
+
+            if (e.renewal > now) {
+                continue;
+            }
+
+            // An expired token is refreshed when a request using it is rejected.
+            if (e.expiry <= now) {
+                iterator.remove();
+                continue;
+            }
+
+            // The expiry is kept until the renewal succeeds and records the new expiry. Until then, the renewal is
+            // retried with an increasing delay, up to the time at which the token expires.
+            const QDateTime retry = now.addSecs(RENEWAL_RETRY_DELAY << qMin(e.attempts, 8));
+            due << e;
+            e.renewal = retry < e.expiry ? retry : e.expiry;
+            e.attempts++;
+            renewalCount++;
+        }
+    }
+
+    foreach (const AccessTokenExpiry &e, due) {
+#ifdef QYOUTUBE_DEBUG
+        qDebug() << "QYouTube::TokenManagerPrivate::_q_renewAccessTokens" << e.clientId << e.expiry;
+#endif
+        q->refreshAccessToken(e.clientId, e.clientSecret, e.refreshToken);
+    }
+
+    _q_scheduleRenewal();
+}
+
+AccessTokenRefresh::AccessTokenRefresh(const QString &id, const QString &secret, const QString &token,
+                                       QNetworkReply *r) :
+    QObject(),
+    clientId(id),
+    clientSecret(secret),
+    refreshToken(token),
+    reply(r)
+{
+    connect(reply, SIGNAL(finished()), this, SLOT(_q_onReplyFinished()));
+}
+
+void AccessTokenRefresh::_q_onReplyFinished() {
+    bool ok = true;
+    const QVariant response = QtJson::Json::parse(reply->readAll(), ok);
+    int error = replyError(reply);
+    QString errorString = replyErrorString(reply);
+    reply->deleteLater();
+    reply = 0;
+
+    if (error == QNetworkReply::NoError) {
+        if (!ok) {
+            error = Request::ParseError;
+            errorString = Request::tr("Unable to parse response");
+        }
+        else if (response.toMap().value("access_token").toString().isEmpty()) {
+            error = Request::ContentAccessDenied;
+            errorString = Request::tr("Unable to refresh access token");
+        }
+        else {
+            errorString = QString();
+            TokenManager::instance()->setAccessTokenExpiry(clientId, clientSecret, refreshToken,
+                                                           response.toMap().value("expires_in").toInt());
+        }
+    }
+
+    TokenManager::instance()->d_func()->finishRefresh(clientId, refreshToken, response, error, errorString);
+    deleteLater();
+}
+
+}
+
+#include "moc_tokenmanager.cpp"
+#include "moc_tokenmanager_p.cpp"
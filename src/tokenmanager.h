@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_TOKENMANAGER_H
+#define QYOUTUBE_TOKENMANAGER_H
+
+#include "qyoutube_global.h"
+#include <QDateTime>
+#include <QObject>
+#include <QVariant>
+
+class QNetworkAccessManager;
+
+namespace QYouTube {
+
+class TokenManagerPrivate;
+
+class QYOUTUBESHARED_EXPORT TokenManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~TokenManager();
+
+    static TokenManager* instance();
+
+    bool isRefreshing(const QString &clientId, const QString &refreshToken) const;
+
+    QDateTime accessTokenExpiry(const QString &clientId, const QString &refreshToken) const;
+    void setAccessTokenExpiry(const QString &clientId, const QString &clientSecret, const QString &refreshToken,
+                              int expiresIn);
+    void clearAccessTokenExpiry(const QString &clientId, const QString &refreshToken);
+
+    static int renewalMargin();
+    static void setRenewalMargin(int seconds);
+
+    static qint64 refreshCount();
+    static qint64 coalescedRefreshCount();
+    static qint64 renewalCount();
+    static void resetStatistics();
+
+public Q_SLOTS:
+    void refreshAccessToken(const QString &clientId, const QString &clientSecret, const QString &refreshToken,
+                            QNetworkAccessManager *manager = 0);
+
+Q_SIGNALS:
+    void accessTokenRefreshed(const QString &clientId, const QString &refreshToken, const QVariant &response,
+                              int error, const QString &errorString);
+
+private:
+    TokenManager();
+
+    QScopedPointer<TokenManagerPrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(TokenManager)
+    Q_DISABLE_COPY(TokenManager)
+
+    Q_PRIVATE_SLOT(d_func(), void _q_scheduleRenewal())
+    Q_PRIVATE_SLOT(d_func(), void _q_renewAccessTokens())
+};
+
+}
+
+#endif // QYOUTUBE_TOKENMANAGER_H
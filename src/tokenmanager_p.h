@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QYOUTUBE_TOKENMANAGER_P_H
+#define QYOUTUBE_TOKENMANAGER_P_H
+
+#include "tokenmanager.h"
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+
+class QNetworkReply;
+class QTimer;
+
+namespace QYouTube {
+
+/*!
+    \internal
+    \brief Handles the reply to a single access token refresh.
+
+    The object lives in the thread that started the refresh, and deletes itself when the reply is finished.
+*/
+class AccessTokenRefresh : public QObject
+{
+    Q_OBJECT
+
+public:
+    AccessTokenRefresh(const QString &clientId, const QString &clientSecret, const QString &refreshToken,
+                       QNetworkReply *reply);
+
+private Q_SLOTS:
+    void _q_onReplyFinished();
+
+private:
+    QString clientId;
+    QString clientSecret;
+    QString refreshToken;
+
+    QNetworkReply *reply;
+};
+
+/*!
+    \internal
+    \brief The lifetime of an access token that is renewed before it expires.
+*/
+class AccessTokenExpiry
+{
+
+public:
+    AccessTokenExpiry() :
+        attempts(0)
+    {
+    }
+
+    QString clientId;
+    QString clientSecret;
+    QString refreshToken;
+
+    QDateTime expiry;
+    QDateTime renewal;
+
+    // The number of renewals made since the expiry was recorded, none of which have yet succeeded.
+    int attempts;
+};
+
+class TokenManagerPrivate
+{
+
+public:
+    TokenManagerPrivate(TokenManager *parent);
+
+    static QString refreshKey(const QString &clientId, const QString &refreshToken);
+
+    void finishRefresh(const QString &clientId, const QString &refreshToken, const QVariant &response, int error,
+                       const QString &errorString);
+
+    void _q_scheduleRenewal();
+    void _q_renewAccessTokens();
+
+    TokenManager *q_ptr;
+
+    QTimer *timer;
+
+    mutable QMutex mutex;
+
+    QSet<QString> refreshes;
+
+    QHash<QString, AccessTokenExpiry> expiries;
+
+    int renewalMargin;
+
+    qint64 refreshCount;
+    qint64 coalescedCount;
+    qint64 renewalCount;
+
+    Q_DECLARE_PUBLIC(TokenManager)
+};
+
+}
+
+#endif // QYOUTUBE_TOKENMANAGER_P_H
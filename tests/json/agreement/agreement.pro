@@ -0,0 +1,13 @@
+TEMPLATE = app
+TARGET = json-agreement
+INSTALLS += target
+
+QT -= gui
+
+INCLUDEPATH += ../../../src
+LIBS += -L../../../lib -lqyoutube
+SOURCES += main.cpp
+
+unix {
+    target.path = /opt/qyoutube/bin
+}
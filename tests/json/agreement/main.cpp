@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "json.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QStringList>
+#include <QDebug>
+
+// Data of 64 KB or more is parsed using a structural index, which works in blocks of 64 bytes.
+static const int STRUCTURAL_THRESHOLD = 65536;
+static const int BLOCK_SIZE = 64;
+// Splitting a document at every byte takes quadratic time, so only documents up to this size are split, or fed
+// one byte at a time.
+static const int MAXIMUM_SPLIT_SIZE = 4096;
+
+static int caseCount = 0;
+static int failureCount = 0;
+
+// Values must have the same type as well as the same value, so that an integer is not accepted as a double.
+static bool identical(const QVariant &a, const QVariant &b) {
+    if (a.type() != b.type()) {
+        return false;
+    }
+
+    switch (a.type()) {
+    case QVariant::Map: {
+        const QVariantMap ma = a.toMap();
+        const QVariantMap mb = b.toMap();
+
+        if (ma.keys() != mb.keys()) {
+            return false;
+        }
+
+        QMapIterator<QString, QVariant> iterator(ma);
+
+        while (iterator.hasNext()) {
+            iterator.next();
+
+            if (!identical(iterator.value(), mb.value(iterator.key()))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+    case QVariant::List: {
+        const QVariantList la = a.toList();
+        const QVariantList lb = b.toList();
+
+        if (la.size() != lb.size()) {
+            return false;
+        }
+
+        for (int i = 0; i < la.size(); i++) {
+            if (!identical(la.at(i), lb.at(i))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+    default:
+        return a == b;
+    }
+}
+
+static void check(const char *name, const QByteArray &json, const QVariant &expected, const QVariant &value,
+                  bool ok) {
+    caseCount++;
+
+    if ((ok) && (identical(expected, value))) {
+        return;
+    }
+
+    failureCount++;
+    qWarning() << "Mismatch:" << name << "ok:" << ok << json.left(200);
+    qWarning() << "Expected:" << expected;
+    qWarning() << "Actual:" << value;
+}
+
+static QVariant parseChunks(const QByteArray &json, int chunkSize, bool &ok) {
+    QtJson::JsonStreamParser parser;
+
+    for (int i = 0; i < json.size(); i += chunkSize) {
+        parser.feed(json.constData() + i, qMin(chunkSize, json.size() - i));
+    }
+
+    return parser.finish(ok);
+}
+
+static QVariant parseSplit(const QByteArray &json, int split, bool &ok) {
+    QtJson::JsonStreamParser parser;
+    parser.feed(json.constData(), split);
+    parser.feed(json.constData() + split, json.size() - split);
+    return parser.finish(ok);
+}
+
+static QVariant parseDocument(const QByteArray &json, bool &ok) {
+    const QtJson::JsonDocument document = QtJson::JsonDocument::fromJson(json, ok);
+    return ok ? document.root().toVariant() : QVariant();
+}
+
+// Checks that every parser produces the same value for json, using Json::parse(QString) as the reference.
+static void checkParsers(const QByteArray &json) {
+    bool ok;
+    const QVariant expected = QtJson::Json::parse(QString::fromUtf8(json), ok);
+
+    if (!ok) {
+        caseCount++;
+        failureCount++;
+        qWarning() << "Json::parse(QString) failed:" << json.left(200);
+        return;
+    }
+
+    QVariant value = QtJson::Json::parse(json, ok);
+    check(json.size() < STRUCTURAL_THRESHOLD ? "Json::parse(QByteArray), stream parser"
+                                             : "Json::parse(QByteArray), structural index", json, expected, value, ok);
+
+    value = parseDocument(json, ok);
+    check("JsonDocument::toVariant()", json, expected, value, ok);
+
+    // Chunks of 61 bytes end at a different offset within each 64 byte block.
+    value = parseChunks(json, 61, ok);
+    check("JsonStreamParser, 61 byte chunks", json, expected, value, ok);
+
+    value = parseChunks(json, 16384, ok);
+    check("JsonStreamParser, 16 KB chunks", json, expected, value, ok);
+
+    if (json.size() <= MAXIMUM_SPLIT_SIZE) {
+        value = parseChunks(json, 1, ok);
+        check("JsonStreamParser, 1 byte chunks", json, expected, value, ok);
+
+        for (int split = 1; split < json.size(); split++) {
+            value = parseSplit(json, split, ok);
+            check("JsonStreamParser, split", json, expected, value, ok);
+        }
+    }
+}
+
+// Checks json as it is, and padded with whitespace so that it is parsed using the structural index.
+static void checkBothSizes(const QByteArray &json) {
+    checkParsers(json);
+
+    if (json.size() < STRUCTURAL_THRESHOLD) {
+        checkParsers(json + QByteArray(STRUCTURAL_THRESHOLD - json.size(), ' '));
+    }
+}
+
+// Escaped quotes and backslashes, placed at every offset around the boundary of a 64 byte block.
+static void checkEscapes() {
+    const char *escapes[] = {
+        "\\\"",
+        "\\\\",
+        "\\\\\\\"",
+        "\\\\\\\\\\\"",
+        "\\\\\\\\",
+        "\\\"\\\"\\\"",
+        "\\\\\\\\\\\\\\\\\\\"",
+        "\\/\\b\\f\\n\\r\\t"
+    };
+
+    for (unsigned int e = 0; e < sizeof(escapes) / sizeof(escapes[0]); e++) {
+        for (int offset = 0; offset <= 2 * BLOCK_SIZE; offset++) {
+            const QByteArray padding(offset, 'x');
+            QByteArray json("{\"a\":\"");
+            json += padding;
+            json += escapes[e];
+            json += "\",\"b\":[\"";
+            json += escapes[e];
+            json += padding;
+            json += "\",\"}\",\"]\"],\"c\\\"d\":1}";
+            checkBothSizes(json);
+        }
+    }
+}
+
+// Surrogate pairs, both escaped and as UTF-8, placed at every offset around the boundary of a 64 byte block.
+static void checkSurrogatePairs() {
+    const char *characters[] = {
+        "\\ud83c\\udfb5",
+        "\\uD83D\\uDE00",
+        "\xf0\x9f\x8e\xb5",
+        "\\u00e9\\u6771\xc3\xa9\xe6\x9d\xb1\\ud83c\\udfb5\xf0\x9f\x98\x80"
+    };
+
+    for (unsigned int c = 0; c < sizeof(characters) / sizeof(characters[0]); c++) {
+        for (int offset = 0; offset <= 2 * BLOCK_SIZE; offset++) {
+            QByteArray json("{\"");
+            json += characters[c];
+            json += "\":\"";
+            json += QByteArray(offset, 'y');
+            json += characters[c];
+            json += "\"}";
+            checkBothSizes(json);
+        }
+    }
+}
+
+// Numbers of each form, so that splitting at every byte splits each number at every position.
+static void checkNumbers() {
+    const char *numbers[] = {
+        "0", "-0", "7", "-7", "42", "2147483647", "-2147483648", "2147483648", "9007199254740993",
+        "9223372036854775807", "-9223372036854775808", "0.5", "-0.25", "3.14159265358979",
+        "1e3", "1E+3", "-1e-3", "2.5e10", "6.02214076e23", "1.7976931348623157e308", "4.9e-324", "123456789.987654321"
+    };
+
+    QByteArray all("[");
+
+    for (unsigned int i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+        checkBothSizes(QByteArray("[") + numbers[i] + "]");
+        checkBothSizes(QByteArray("{\"n\":") + numbers[i] + ",\"m\":[" + numbers[i] + "," + numbers[i] + "]}");
+
+        if (i > 0) {
+            all += ",";
+        }
+
+        all += numbers[i];
+    }
+
+    all += "]";
+    checkBothSizes(all);
+}
+
+static void checkDocuments() {
+    checkBothSizes("{}");
+    checkBothSizes("[]");
+    checkBothSizes("{\"a\":{},\"b\":[],\"c\":\"\",\"d\":null,\"e\":true,\"f\":false}");
+    checkBothSizes(" \n\t{ \"a\" : [ 1 , { \"b\" : null } , \"c\" ] , \"d\" : { } }\r\n");
+    checkBothSizes("[[[[[[[[[[[[[[[[\"deep\"]]]]]]]]]]]]]]]]");
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QStringList args = app.arguments();
+    args.removeFirst();
+
+    if (args.isEmpty()) {
+        checkDocuments();
+        checkEscapes();
+        checkSurrogatePairs();
+        checkNumbers();
+    }
+    else {
+        foreach (const QString &fileName, args) {
+            QFile file(fileName);
+
+            if (!file.open(QFile::ReadOnly)) {
+                qWarning() << "Usage: json-agreement [RESPONSEFILE...]";
+                qWarning() << "Cannot open" << fileName << file.errorString();
+                return 1;
+            }
+
+            checkBothSizes(file.readAll());
+            file.close();
+        }
+    }
+
+    qDebug() << caseCount << "cases," << failureCount << "failures";
+    return failureCount > 0 ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2015 Stuart Howarth <showarth@marxoft.co.uk>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 3 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "json.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QDebug>
+
+static const qint64 MINIMUM_TIME = 1000;
+static const int CHUNK_SIZE = 16384;
+
+typedef bool (*ParseFunction)(const QByteArray &data);
+
+// The path used before Json::parse() accepted UTF-8 data.
+static bool parseString(const QByteArray &data) {
+    bool ok;
+    QtJson::Json::parse(QString::fromUtf8(data), ok);
+    return ok;
+}
+
+static bool parseBytes(const QByteArray &data) {
+    bool ok;
+    QtJson::Json::parse(data, ok);
+    return ok;
+}
+
+// Feeds the data in chunks, as a reply does when it is parsed incrementally.
+static bool parseChunks(const QByteArray &data) {
+    QtJson::JsonStreamParser parser;
+
+    for (int i = 0; i < data.size(); i += CHUNK_SIZE) {
+        parser.feed(data.constData() + i, qMin(CHUNK_SIZE, data.size() - i));
+    }
+
+    bool ok;
+    parser.finish(ok);
+    return ok;
+}
+
+static QVariant parsedValue;
+
+// Serializes the parsed data. The rate is measured against the size of the original data.
+static bool serializeValue(const QByteArray &) {
+    bool ok;
+    QtJson::Json::serialize(parsedValue, ok);
+    return ok;
+}
+
+// Generates a response similar to a /videos list with the snippet, contentDetails and statistics parts.
+static QByteArray videosResponse(int count) {
+    QByteArray response("{\n \"kind\": \"youtube#videoListResponse\",\n \"etag\": \"\\\"q5k97EMVGxODeKcDgp8gnMu79wM/"
+                        "xqvLMnsxbTLvRHMjP4QeqpqUrgA\\\"\",\n \"pageInfo\": {\n  \"totalResults\": 1000000,\n"
+                        "  \"resultsPerPage\": 50\n },\n \"items\": [\n");
+
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            response += ",\n";
+        }
+
+        response += QString("  {\n   \"kind\": \"youtube#video\",\n   \"etag\": \"\\\"q5k97EMVGxODeKcDgp8gnMu79wM/"
+                            "Ea1QnSHdLzgI2hTCWvyHDIk1Lw%1\\\"\",\n   \"id\": \"dQw4w9WgX%2\",\n   \"snippet\": {\n"
+                            "    \"publishedAt\": \"2015-06-%3T12:00:00.000Z\",\n"
+                            "    \"channelId\": \"UCuAXFkgsw1L7xaCfnd5JJOw\",\n"
+                            "    \"title\": \"Video %1 \\u2013 Caf\\u00e9 \\u6771\\u4eac \\ud83c\\udfb5\",\n"
+                            "    \"description\": \"Line one of the description.\\nLine two, with a \\\"quote\\\" "
+                            "and a link: https:\\/\\/www.youtube.com\\/watch?v=dQw4w9WgX%2\\n\\nMore text follows "
+                            "here to make the description a realistic length for a video.\",\n"
+                            "    \"thumbnails\": {\n"
+                            "     \"default\": {\n      \"url\": \"https://i.ytimg.com/vi/dQw4w9WgX%2/default.jpg\",\n"
+                            "      \"width\": 120,\n      \"height\": 90\n     },\n"
+                            "     \"high\": {\n      \"url\": \"https://i.ytimg.com/vi/dQw4w9WgX%2/hqdefault.jpg\",\n"
+                            "      \"width\": 480,\n      \"height\": 360\n     }\n    },\n"
+                            "    \"channelTitle\": \"RickAstleyVEVO\",\n"
+                            "    \"tags\": [\"music\", \"pop\", \"80s\", \"video %1\"],\n"
+                            "    \"categoryId\": \"10\",\n    \"liveBroadcastContent\": \"none\"\n   },\n"
+                            "   \"contentDetails\": {\n    \"duration\": \"PT3M33S\",\n    \"dimension\": \"2d\",\n"
+                            "    \"definition\": \"hd\",\n    \"caption\": \"false\",\n"
+                            "    \"licensedContent\": true\n   },\n"
+                            "   \"statistics\": {\n    \"viewCount\": \"%4\",\n    \"likeCount\": \"%5\",\n"
+                            "    \"dislikeCount\": \"%6\",\n    \"favoriteCount\": \"0\",\n"
+                            "    \"commentCount\": \"%7\"\n   },\n   \"rating\": %8\n  }")
+                            .arg(i).arg(i % 10).arg(10 + i % 20).arg(qint64(i) * 1234567).arg(i * 4321)
+                            .arg(i * 123).arg(i * 45).arg(4.5 + (i % 5) / 10.0).toUtf8();
+    }
+
+    response += "\n ]\n}\n";
+    return response;
+}
+
+static void benchmark(const char *name, const QByteArray &data, ParseFunction parse) {
+    if (!parse(data)) {
+        qWarning() << name << "failed to parse the data";
+        return;
+    }
+
+    QElapsedTimer timer;
+    int iterations = 0;
+    timer.start();
+
+    do {
+        parse(data);
+        iterations++;
+    } while (timer.elapsed() < MINIMUM_TIME);
+
+    const double seconds = timer.elapsed() / 1000.0;
+    const double megabytes = double(data.size()) * iterations / (1024 * 1024);
+    qDebug() << name << "ms/MB:" << 1000 * seconds / megabytes << "GB/s:" << megabytes / seconds / 1024;
+}
+
+static void benchmarkAll(const QByteArray &data) {
+    benchmark("Recursive descent, Json::parse(QString):", data, parseString);
+    // Data of 64 KB or more is parsed using a structural index.
+    benchmark(data.size() < 65536 ? "Stream parser, Json::parse(QByteArray):"
+                                  : "Structural index, Json::parse(QByteArray):", data, parseBytes);
+    benchmark("Stream parser, 16 KB chunks:", data, parseChunks);
+    parsedValue = QtJson::Json::parse(data);
+    benchmark("Serializer, Json::serialize():", data, serializeValue);
+    qDebug() << "Pooled keys:" << QtJson::JsonKeyPool::count() << "hits:" << QtJson::JsonKeyPool::hitCount()
+             << "misses:" << QtJson::JsonKeyPool::missCount() << "bytes saved:" << QtJson::JsonKeyPool::savedBytes();
+    QtJson::JsonKeyPool::resetStatistics();
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QStringList args = app.arguments();
+    args.removeFirst();
+
+    if (args.isEmpty()) {
+        qDebug() << "No response files specified. Using generated /videos responses.";
+        // A single page of 50 items, and a large export of 5000 items.
+        for (int count = 50; count <= 5000; count *= 100) {
+            const QByteArray data = videosResponse(count);
+            qDebug() << count << "items," << data.size() << "bytes";
+            benchmarkAll(data);
+        }
+
+        return 0;
+    }
+
+    foreach (const QString &fileName, args) {
+        QFile file(fileName);
+
+        if (!file.open(QFile::ReadOnly)) {
+            qWarning() << "Usage: json-benchmark [RESPONSEFILE...]";
+            qWarning() << "Cannot open" << fileName << file.errorString();
+            return 1;
+        }
+
+        const QByteArray data = file.readAll();
+        file.close();
+        qDebug() << fileName << data.size() << "bytes";
+        benchmarkAll(data);
+    }
+
+    return 0;
+}
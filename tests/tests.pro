@@ -1,6 +1,7 @@
 TEMPLATE = subdirs
 SUBDIRS += \
     authentication \
+    json \
     resources \
     streams \
     subtitles